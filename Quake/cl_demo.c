@@ -294,6 +294,7 @@ void CL_Record_f (void)
 		Con_Printf ("ERROR: couldn't create %s\n", name);
 		return;
 	}
+	COM_AddDirectoryFile (name);
 
 	cls.forcetrack = track;
 	fprintf (cls.demofile, "%i\n", cls.forcetrack);
@@ -406,6 +407,11 @@ void CL_PlayDemo_f (void)
 
 	COM_FOpenFile (name, &cls.demofile, NULL);
 	if (!cls.demofile)
+	{	// may have been recorded since the game directories were listed
+		COM_FlushDirectoryCache ();
+		COM_FOpenFile (name, &cls.demofile, NULL);
+	}
+	if (!cls.demofile)
 	{
 		Con_Printf ("ERROR: couldn't open %s\n", name);
 		cls.demonum = -1;	// stop demo loop
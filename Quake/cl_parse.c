@@ -907,6 +907,40 @@ static void CL_KeepaliveMessage (void)
 CL_ParseServerInfo
 ==================
 */
+typedef struct
+{
+	int		models, sounds;
+	int		prefetchbytes;
+	double	total, io, upload, prefetchwait;
+} loadstats_t;
+
+static loadstats_t	cl_loadstats;
+
+/*
+==================
+CL_LoadStats_f
+
+where the time of the last precache went
+==================
+*/
+void CL_LoadStats_f (void)
+{
+	const loadstats_t *s = &cl_loadstats;
+
+	if (!s->models)
+	{
+		Con_Printf ("no level loaded yet\n");
+		return;
+	}
+
+	Con_Printf ("%i models, %i sounds, %i KB prefetched\n", s->models, s->sounds, s->prefetchbytes / 1024);
+	Con_Printf ("%8.1f ms total\n", s->total * 1000.0);
+	Con_Printf ("%8.1f ms waiting on file reads\n", s->io * 1000.0);
+	Con_Printf ("%8.1f ms uploading textures\n", s->upload * 1000.0);
+	Con_Printf ("%8.1f ms decoding\n", (s->total - s->io - s->upload - s->prefetchwait) * 1000.0);
+	Con_Printf ("%8.1f ms waiting for the prefetch\n", s->prefetchwait * 1000.0);
+}
+
 static void CL_ParseServerInfo (void)
 {
 	const char	*str;
@@ -1062,6 +1096,19 @@ static void CL_ParseServerInfo (void)
 	// copy the naked name of the map file to the cl structure -- O.S
 	COM_StripExtension (COM_SkipPath(model_precache[1]), cl.mapname, sizeof(cl.mapname));
 
+	// start reading everything that is not loaded yet in the background
+	// while the models are parsed one after another
+	double start_time = Sys_DoubleTime ();
+	double start_io = com_loadiotime;
+	double start_upload = texmgr_uploadtime;
+	for (i = 1; i < nummodels; i++)
+	{
+		if (model_precache[i][0] != '*' && Mod_FindName (model_precache[i])->needload)
+			COM_PrefetchFile (model_precache[i]);
+	}
+	for (i = 1; i < numsounds; i++)
+		COM_PrefetchFile (va ("sound/%s", sound_precache[i]));
+
 	for (i = 1; i < nummodels; i++)
 	{
 		cl.model_precache[i] = Mod_ForName (model_precache[i], false);
@@ -1082,6 +1129,15 @@ static void CL_ParseServerInfo (void)
 
 	R_NewMap ();
 
+	double prefetch_time = Sys_DoubleTime ();
+	cl_loadstats.prefetchbytes = COM_FinishPrefetch ();
+	cl_loadstats.prefetchwait = Sys_DoubleTime () - prefetch_time;
+	cl_loadstats.models = nummodels - 1;
+	cl_loadstats.sounds = numsounds - 1;
+	cl_loadstats.total = Sys_DoubleTime () - start_time;
+	cl_loadstats.io = com_loadiotime - start_io;
+	cl_loadstats.upload = texmgr_uploadtime - start_upload;
+
 	//johnfitz -- clear out string; we don't consider identical
 	//messages to be duplicates if the map has changed in between
 	con_lastcenterstring[0] = 0;
@@ -391,6 +391,7 @@ void CL_TimeDemo_f (void);
 // cl_parse.c
 //
 void CL_ParseServerMessage (void);
+void CL_LoadStats_f (void);
 void CL_RegisterParticles(void);
 void CL_NewTranslation (int slot);
 
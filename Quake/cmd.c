@@ -37,10 +37,23 @@ typedef struct cmdalias_s
 	struct cmdalias_s	*next;
 	char	name[MAX_ALIAS_NAME];
 	char	*value;
+	struct cmdalias_s	*hashnext;	// also mirrored in console.c
 } cmdalias_t;
 
 cmdalias_t	*cmd_alias;
 
+// the command and alias lists are kept for listing and completion, lookups go
+// through these hashes. They ignore case, so both the q_strcasecmp lookups of
+// Cmd_ExecuteString and the exact ones find their names in a single bucket.
+#define	CMD_HASH_SIZE	512
+#define	ALIAS_HASH_SIZE	256
+
+static cmd_function_t	*cmd_hash[CMD_HASH_SIZE];
+static cmdalias_t		*alias_hash[ALIAS_HASH_SIZE];
+
+#define	CMD_HASH(name)		(COM_HashStringCaseless (name) & (CMD_HASH_SIZE - 1))
+#define	ALIAS_HASH(name)	(COM_HashStringCaseless (name) & (ALIAS_HASH_SIZE - 1))
+
 qboolean	cmd_wait;
 
 //=============================================================================
@@ -287,6 +300,11 @@ void Cmd_Exec_f (void)
 
 	mark = Hunk_LowMark ();
 	f = (char *)COM_LoadHunkFile (Cmd_Argv(1), NULL);
+	if (!f)
+	{	// may have been created since the game directories were listed
+		COM_FlushDirectoryCache ();
+		f = (char *)COM_LoadHunkFile (Cmd_Argv(1), NULL);
+	}
 	if (!f && !strcmp(Cmd_Argv(1), "default.cfg")) {
 		f = default_cfg;	/* see above.. */
 	}
@@ -347,7 +365,7 @@ void Cmd_Alias_f (void)
 			Con_SafePrintf ("no alias commands found\n");
 		break;
 	case 2: //output current alias string
-		for (a = cmd_alias ; a ; a=a->next)
+		for (a = alias_hash[ALIAS_HASH (Cmd_Argv(1))] ; a ; a=a->hashnext)
 			if (!strcmp(Cmd_Argv(1), a->name))
 				Con_Printf ("   %s: %s", a->name, a->value);
 		break;
@@ -360,7 +378,7 @@ void Cmd_Alias_f (void)
 		}
 
 		// if the alias allready exists, reuse it
-		for (a = cmd_alias ; a ; a=a->next)
+		for (a = alias_hash[ALIAS_HASH (s)] ; a ; a=a->hashnext)
 		{
 			if (!strcmp(s, a->name))
 			{
@@ -374,6 +392,8 @@ void Cmd_Alias_f (void)
 			a = (cmdalias_t *) Z_Malloc (sizeof(cmdalias_t));
 			a->next = cmd_alias;
 			cmd_alias = a;
+			a->hashnext = alias_hash[ALIAS_HASH (s)];
+			alias_hash[ALIAS_HASH (s)] = a;
 		}
 		strcpy (a->name, s);
 
@@ -405,7 +425,7 @@ Cmd_Unalias_f -- johnfitz
 */
 void Cmd_Unalias_f (void)
 {
-	cmdalias_t	*a, *prev;
+	cmdalias_t	*a, **link;
 
 	switch (Cmd_Argc())
 	{
@@ -414,21 +434,19 @@ void Cmd_Unalias_f (void)
 		Con_Printf("unalias <name> : delete alias\n");
 		break;
 	case 2:
-		prev = NULL;
-		for (a = cmd_alias; a; a = a->next)
+		for (link = &alias_hash[ALIAS_HASH (Cmd_Argv(1))]; (a = *link); link = &a->hashnext)
 		{
 			if (!strcmp(Cmd_Argv(1), a->name))
 			{
-				if (prev)
-					prev->next = a->next;
-				else
-					cmd_alias  = a->next;
+				*link = a->hashnext;
+				for (link = &cmd_alias; *link != a; link = &(*link)->next)
+					;
+				*link = a->next;
 
 				Z_Free (a->value);
 				Z_Free (a);
 				return;
 			}
-			prev = a;
 		}
 		Con_Printf ("No alias named %s\n", Cmd_Argv(1));
 		break;
@@ -438,7 +456,7 @@ void Cmd_Unalias_f (void)
 qboolean Cmd_AliasExists (const char *aliasname)
 {
 	cmdalias_t *a;
-	for (a=cmd_alias ; a ; a=a->next)
+	for (a=alias_hash[ALIAS_HASH (aliasname)] ; a ; a=a->hashnext)
 	{
 		if (!q_strcasecmp (aliasname, a->name))
 			return true;
@@ -462,6 +480,7 @@ void Cmd_Unaliasall_f (void)
 		Z_Free(cmd_alias);
 		cmd_alias = blah;
 	}
+	memset (alias_hash, 0, sizeof(alias_hash));
 }
 
 /*
@@ -705,6 +724,7 @@ cmd_function_t *Cmd_AddCommand2 (const char *cmd_name, xcommand_t function, cmd_
 {
 	cmd_function_t	*cmd;
 	cmd_function_t	*cursor,*prev; //johnfitz -- sorted list insert
+	cmd_function_t	**link;
 
 // fail if the command is a variable name
 	if (Cvar_VariableString(cmd_name)[0])
@@ -714,7 +734,7 @@ cmd_function_t *Cmd_AddCommand2 (const char *cmd_name, xcommand_t function, cmd_
 	}
 
 // fail if the command already exists
-	for (cmd=cmd_functions ; cmd ; cmd=cmd->next)
+	for (cmd=cmd_hash[CMD_HASH (cmd_name)] ; cmd ; cmd=cmd->hashnext)
 	{
 		if (!Q_strcmp (cmd_name, cmd->name) && cmd->srctype == srctype)
 		{
@@ -759,18 +779,28 @@ cmd_function_t *Cmd_AddCommand2 (const char *cmd_name, xcommand_t function, cmd_
 	}
 	//johnfitz
 
+	// same order within the bucket, so case insensitive matches still resolve
+	// to the first one in the list
+	for (link = &cmd_hash[CMD_HASH (cmd->name)]; *link && strcmp(cmd->name, (*link)->name) > 0; link = &(*link)->hashnext)
+		;
+	cmd->hashnext = *link;
+	*link = cmd;
+
 	if (cmd->dynamic)
 		return cmd;
 	return NULL;
 }
 void Cmd_RemoveCommand (cmd_function_t *cmd)
 {
-	cmd_function_t **link;
+	cmd_function_t **link, **hashlink;
 	for (link = &cmd_functions; *link; link = &(*link)->next)
 	{
 		if (*link == cmd)
 		{
 			*link = cmd->next;
+			for (hashlink = &cmd_hash[CMD_HASH (cmd->name)]; *hashlink != cmd; hashlink = &(*hashlink)->hashnext)
+				;
+			*hashlink = cmd->hashnext;
 			free(cmd);
 			return;
 		}
@@ -787,7 +817,7 @@ qboolean	Cmd_Exists (const char *cmd_name)
 {
 	cmd_function_t	*cmd;
 
-	for (cmd=cmd_functions ; cmd ; cmd=cmd->next)
+	for (cmd=cmd_hash[CMD_HASH (cmd_name)] ; cmd ; cmd=cmd->hashnext)
 	{
 		if (!Q_strcmp (cmd_name,cmd->name))
 		{
@@ -830,7 +860,6 @@ const char *Cmd_CompleteCommand (const char *partial)
 Cmd_ExecuteString
 
 A complete command line has been parsed, so try to execute it
-FIXME: lookupnoadd the token to speed search?
 ============
 */
 qboolean	Cmd_ExecuteString (const char *text, cmd_source_t src)
@@ -846,7 +875,7 @@ qboolean	Cmd_ExecuteString (const char *text, cmd_source_t src)
 		return true;		// no tokens
 
 // check functions
-	for (cmd=cmd_functions ; cmd ; cmd=cmd->next)
+	for (cmd=cmd_hash[CMD_HASH (cmd_argv[0])] ; cmd ; cmd=cmd->hashnext)
 	{
 		if (!q_strcasecmp (cmd_argv[0],cmd->name))
 		{
@@ -870,7 +899,7 @@ qboolean	Cmd_ExecuteString (const char *text, cmd_source_t src)
 		return false;
 
 // check alias
-	for (a=cmd_alias ; a ; a=a->next)
+	for (a=alias_hash[ALIAS_HASH (cmd_argv[0])] ; a ; a=a->hashnext)
 	{
 		if (!q_strcasecmp (cmd_argv[0], a->name))
 		{
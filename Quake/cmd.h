@@ -95,6 +95,7 @@ typedef struct cmd_function_s
 	xcommand_t		function;
 	cmd_source_t	srctype;
 	qboolean		dynamic;
+	struct cmd_function_s	*hashnext;
 } cmd_function_t;
 
 void	Cmd_Init (void);
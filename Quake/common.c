@@ -25,6 +25,12 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "quakedef.h"
 #include "q_ctype.h"
 #include <errno.h>
+#ifndef _WIN32
+#include <dirent.h>
+#include <sys/stat.h>
+#else
+#include <windows.h>
+#endif
 
 #include "miniz.h"
 
@@ -1549,13 +1555,14 @@ being registered.
 */
 static void COM_CheckRegistered (void)
 {
-	int		h;
+	FILE	*f;
 	unsigned short	check[128];
 	int		i;
 
-	COM_OpenFile("gfx/pop.lmp", &h, NULL);
+	// not COM_OpenFile: a pop.lmp in a pk3 has no handle to read through
+	COM_FOpenFile("gfx/pop.lmp", &f, NULL);
 
-	if (h == -1)
+	if (!f)
 	{
 		Cvar_SetROM ("registered", "0");
 		Con_Printf ("Playing shareware version.\n");
@@ -1568,8 +1575,9 @@ static void COM_CheckRegistered (void)
 		return;
 	}
 
-	Sys_FileRead (h, check, sizeof(check));
-	COM_CloseFile (h);
+	memset (check, 0, sizeof(check));
+	fread (check, 1, sizeof(check), f);
+	fclose (f);
 
 	for (i = 0; i < 128; i++)
 	{
@@ -1829,6 +1837,8 @@ void COM_WriteFile (const char *filename, const void *data, int len)
 	Sys_Printf ("COM_WriteFile: %s\n", name);
 	Sys_FileWrite (handle, data, len);
 	Sys_FileClose (handle);
+
+	COM_AddDirectoryFile (name);
 }
 
 /*
@@ -1868,6 +1878,643 @@ long COM_filelength (FILE *f)
 	return end;
 }
 
+/*
+=================
+COM_ReadMappedZip
+
+mz_zip_archive read callback for a memory mapped pk3
+=================
+*/
+static size_t COM_ReadMappedZip (void *opaque, mz_uint64 ofs, void *buf, size_t n)
+{
+	const pack_t *pack = (const pack_t *) opaque;
+
+	if (ofs >= pack->mappedsize)
+		return 0;
+	n = q_min (n, (size_t)(pack->mappedsize - ofs));
+	memcpy (buf, pack->mapped + ofs, n);
+	return n;
+}
+
+/*
+=================
+COM_LoadZipFile
+
+Takes an explicit (not game tree related) path to a pk3 file.
+
+Maps the archive and reads its central directory once.  Files are served
+from the mapping: stored ones directly, deflated ones are inflated when
+they are loaded.
+=================
+*/
+static pack_t *COM_LoadZipFile (const char *zipfile)
+{
+	mz_zip_archive	archive;
+	mz_zip_archive_file_stat	stat;
+	pack_t		*pack;
+	packfile_t	*newfiles;
+	byte		*mapped, *header;
+	size_t		mappedsize;
+	mz_uint64	datapos;
+	int			i, numfiles, numzipfiles;
+
+	mapped = (byte *) Sys_MapFile (zipfile, &mappedsize);
+	if (!mapped)
+		return NULL;
+
+	pack = (pack_t *) Z_Malloc (sizeof (pack_t));
+	q_strlcpy (pack->filename, zipfile, sizeof(pack->filename));
+	pack->handle = -1;
+	pack->mapped = mapped;
+	pack->mappedsize = mappedsize;
+
+	memset (&archive, 0, sizeof(archive));
+	archive.m_pRead = COM_ReadMappedZip;
+	archive.m_pIO_opaque = pack;
+	if (!mz_zip_reader_init (&archive, mappedsize, 0))
+	{
+		Sys_Printf ("WARNING: %s is not a valid pk3 file, ignored\n", zipfile);
+		Sys_UnmapFile (mapped, mappedsize);
+		Z_Free (pack);
+		return NULL;
+	}
+
+	numzipfiles = archive.m_total_files;	// mz_zip_reader_get_num_files is compiled out of our miniz
+	newfiles = (packfile_t *) malloc (q_max (numzipfiles, 1) * sizeof(packfile_t));
+	if (!newfiles)
+		Sys_Error ("COM_LoadZipFile: out of memory");
+
+	for (i = 0, numfiles = 0; i < numzipfiles; i++)
+	{
+		if (!mz_zip_reader_file_stat (&archive, i, &stat) || stat.m_is_directory)
+			continue;
+		if (!stat.m_is_supported || stat.m_is_encrypted || (stat.m_method != 0 && stat.m_method != MZ_DEFLATED)
+			|| stat.m_uncomp_size > INT_MAX || stat.m_comp_size > INT_MAX)
+		{
+			Sys_Printf ("WARNING: %s in %s is not supported, ignored\n", stat.m_filename, zipfile);
+			continue;
+		}
+		if (strlen (stat.m_filename) >= sizeof(newfiles[0].name))
+		{
+			Sys_Printf ("WARNING: %s in %s has a too long name, ignored\n", stat.m_filename, zipfile);
+			continue;
+		}
+
+		// the data follows the local header, whose extra field may differ from the central one
+		if (stat.m_local_header_ofs + 30 > mappedsize)
+			continue;
+		header = mapped + stat.m_local_header_ofs;
+		datapos = stat.m_local_header_ofs + 30 + (header[26] | (header[27] << 8)) + (header[28] | (header[29] << 8));
+		if (datapos + stat.m_comp_size > mappedsize || datapos > INT_MAX)
+			continue;
+
+		q_strlcpy (newfiles[numfiles].name, stat.m_filename, sizeof(newfiles[numfiles].name));
+		newfiles[numfiles].filepos = (int)datapos;
+		newfiles[numfiles].filelen = (int)stat.m_uncomp_size;
+		newfiles[numfiles].packedlen = stat.m_method ? (int)stat.m_comp_size : 0;
+		numfiles++;
+	}
+	mz_zip_reader_end (&archive);
+
+	com_modified = true;	// not the original file
+
+	pack->numfiles = numfiles;
+	pack->files = newfiles;
+
+	return pack;
+}
+
+/*
+=================
+COM_FreePackFile
+=================
+*/
+static void COM_FreePackFile (pack_t *pack)
+{
+	if (pack->mapped)
+	{
+		Sys_UnmapFile (pack->mapped, pack->mappedsize);
+		free (pack->files);
+	}
+	else
+	{
+		Sys_FileClose (pack->handle);
+		Z_Free (pack->files);
+	}
+	Z_Free (pack);
+}
+
+/*
+=================
+COM_InflatePackFile
+
+inflates a deflated pk3 entry into dest, which holds filelen bytes
+=================
+*/
+static qboolean COM_InflatePackFile (const pack_t *pack, const packfile_t *file, byte *dest)
+{
+	tinfl_decompressor	inflator;
+	size_t		in_size = file->packedlen;
+	size_t		out_size = file->filelen;
+	tinfl_status	status;
+
+	tinfl_init (&inflator);
+	status = tinfl_decompress (&inflator, pack->mapped + file->filepos, &in_size, dest, dest, &out_size, TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF);
+
+	return status == TINFL_STATUS_DONE && out_size == (size_t)file->filelen;
+}
+
+/*
+=================
+COM_ReadPackFile
+
+copies a pk3 entry into dest, which holds filelen bytes
+=================
+*/
+static void COM_ReadPackFile (const pack_t *pack, const packfile_t *file, byte *dest)
+{
+	if (!file->packedlen)
+		memcpy (dest, pack->mapped + file->filepos, file->filelen);
+	else if (!COM_InflatePackFile (pack, file, dest))
+		Sys_Error ("Corrupt file %s in %s", file->name, pack->filename);
+}
+
+/*
+===========================================================================
+
+FILE INDEX
+
+One hash table over the files of all search paths, so COM_FindFile does not
+have to strcmp its way through every pak of every game directory.  Entries
+remember the position of their search path and lookups return the matching
+entry of the earliest one, which is the same file the search path walk
+finds.  Directories are listed once and served from that listing until
+COM_FlushDirectoryCache, files the engine writes are added to the listing.
+
+===========================================================================
+*/
+
+#define MAX_DIRECTORY_DEPTH	16
+
+typedef struct
+{
+	const char		*name;		// NULL for an empty slot
+	unsigned int	hash;
+	int				rank;		// position of search in com_searchpaths
+	int				file;		// index into search->pack->files, -1 for directory files
+	searchpath_t	*search;
+} fileindex_t;
+
+static fileindex_t	*com_fileindex;
+static int			com_fileindex_size;	// power of two
+static qboolean		com_fileindex_valid;
+static qboolean		com_fileindex_registered;
+
+/*
+============
+COM_HashFileName
+
+case insensitive, so directory entries on case insensitive file systems
+land in the same bucket as every spelling of their name
+============
+*/
+static unsigned int COM_HashFileName (const char *name)
+{
+	unsigned int hash = 0x811c9dc5u;
+	while (*name)
+	{
+		hash ^= (unsigned char)q_tolower (*name++);
+		hash *= 0x01000193u;
+	}
+	return hash;
+}
+
+/*
+============
+COM_FileIndexMatches
+============
+*/
+static qboolean COM_FileIndexMatches (const fileindex_t *entry, const char *name)
+{
+#ifdef _WIN32
+	if (entry->file == -1)
+		return !q_strcasecmp (entry->name, name);
+#endif
+	return !strcmp (entry->name, name);
+}
+
+/*
+============
+COM_ScanDirectory_r
+============
+*/
+static void COM_ScanDirectory_r (const char *base, const char *relative, int depth, char **list, int *size, int *maxsize, int *count)
+{
+	char	path[MAX_OSPATH];
+	char	name[MAX_OSPATH];
+	int		len;
+	qboolean	isdir;
+#ifdef _WIN32
+	WIN32_FIND_DATA	fdat;
+	HANDLE		fhnd;
+
+	if (q_snprintf (path, sizeof(path), "%s/%s*", base, relative) >= (int)sizeof(path))
+		return;
+	fhnd = FindFirstFile (path, &fdat);
+	if (fhnd == INVALID_HANDLE_VALUE)
+		return;
+	do
+	{
+		if (!strcmp (fdat.cFileName, ".") || !strcmp (fdat.cFileName, ".."))
+			continue;
+		isdir = (fdat.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+		len = q_snprintf (name, sizeof(name), "%s%s", relative, fdat.cFileName);
+#else
+	DIR		*dir_p;
+	struct dirent	*dir_t;
+	struct stat	st;
+
+	if (q_snprintf (path, sizeof(path), "%s/%s", base, relative) >= (int)sizeof(path))
+		return;
+	dir_p = opendir (path);
+	if (dir_p == NULL)
+		return;
+	while ((dir_t = readdir (dir_p)) != NULL)
+	{
+		if (!strcmp (dir_t->d_name, ".") || !strcmp (dir_t->d_name, ".."))
+			continue;
+		len = q_snprintf (name, sizeof(name), "%s%s", relative, dir_t->d_name);
+		if (dir_t->d_type != DT_UNKNOWN && dir_t->d_type != DT_LNK)
+			isdir = (dir_t->d_type == DT_DIR);
+		else
+		{
+			q_snprintf (path, sizeof(path), "%s/%s", base, name);
+			isdir = !stat (path, &st) && S_ISDIR (st.st_mode);
+		}
+#endif
+		if (len >= (int)sizeof(name) - 1)
+			continue;
+
+		if (isdir)
+		{
+			if (depth < MAX_DIRECTORY_DEPTH)
+			{
+				name[len] = '/';
+				name[len + 1] = 0;
+				COM_ScanDirectory_r (base, name, depth + 1, list, size, maxsize, count);
+			}
+			continue;
+		}
+
+		if (*size + len + 1 > *maxsize)
+		{
+			*maxsize = q_max (*maxsize * 2, *size + len + 1 + 4096);
+			*list = (char *) realloc (*list, *maxsize);
+			if (!*list)
+				Sys_Error ("COM_ScanDirectory: out of memory");
+		}
+		memcpy (*list + *size, name, len + 1);
+		*size += len + 1;
+		(*count)++;
+#ifdef _WIN32
+	} while (FindNextFile (fhnd, &fdat));
+	FindClose (fhnd);
+#else
+	}
+	closedir (dir_p);
+#endif
+}
+
+/*
+============
+COM_ScanDirectory
+
+lists all files below a directory search path
+============
+*/
+static void COM_ScanDirectory (searchpath_t *search)
+{
+	int size = 0, maxsize = 0, count = 0;
+	char *list = NULL;
+
+	COM_ScanDirectory_r (search->filename, "", 0, &list, &size, &maxsize, &count);
+	search->dirfiles = list;
+	search->numdirfiles = count;
+}
+
+/*
+============
+COM_AddFileIndex
+============
+*/
+static void COM_AddFileIndex (const char *name, searchpath_t *search, int rank, int file)
+{
+	unsigned int	hash = COM_HashFileName (name);
+	unsigned int	mask = com_fileindex_size - 1;
+	unsigned int	pos;
+	fileindex_t		*entry;
+
+	for (pos = hash & mask; com_fileindex[pos].name; pos = (pos + 1) & mask)
+	{
+		entry = &com_fileindex[pos];
+		// an earlier entry with the same name shadows this one for every lookup,
+		// unless this one matches case insensitively and the earlier one does not
+		if (entry->hash == hash && !strcmp (entry->name, name) && (entry->file == -1 || file != -1))
+			return;
+	}
+
+	entry = &com_fileindex[pos];
+	entry->name = name;
+	entry->hash = hash;
+	entry->rank = rank;
+	entry->file = file;
+	entry->search = search;
+}
+
+/*
+============
+COM_BuildFileIndex
+============
+*/
+static void COM_BuildFileIndex (void)
+{
+	searchpath_t	*search;
+	const char		*name;
+	int				count = 0, rank, i;
+
+	com_fileindex_registered = (registered.value != 0);
+
+	for (search = com_searchpaths; search; search = search->next)
+	{
+		if (search->pack)
+			count += search->pack->numfiles;
+		else
+		{
+			if (search->numdirfiles < 0)
+				COM_ScanDirectory (search);
+			count += search->numdirfiles;
+		}
+	}
+
+	if (com_fileindex_size < count * 2)
+	{
+		free (com_fileindex);
+		for (com_fileindex_size = 1024; com_fileindex_size < count * 2; com_fileindex_size *= 2)
+			;
+		com_fileindex = (fileindex_t *) malloc (com_fileindex_size * sizeof(fileindex_t));
+		if (!com_fileindex)
+			Sys_Error ("COM_BuildFileIndex: out of memory");
+	}
+	memset (com_fileindex, 0, com_fileindex_size * sizeof(fileindex_t));
+
+	for (search = com_searchpaths, rank = 0; search; search = search->next, rank++)
+	{
+		if (search->pack)
+		{
+			for (i = 0; i < search->pack->numfiles; i++)
+				COM_AddFileIndex (search->pack->files[i].name, search, rank, i);
+		}
+		else
+		{
+			for (i = 0, name = search->dirfiles; i < search->numdirfiles; i++, name += strlen (name) + 1)
+			{
+				/* if not a registered version, don't ever go beyond base */
+				if (!com_fileindex_registered && strchr (name, '/'))
+					continue;
+				COM_AddFileIndex (name, search, rank, -1);
+			}
+		}
+	}
+
+	com_fileindex_valid = true;
+}
+
+/*
+============
+COM_FindFileIndex
+============
+*/
+static const fileindex_t *COM_FindFileIndex (const char *filename)
+{
+	unsigned int		hash, mask, pos;
+	const fileindex_t	*entry, *best = NULL;
+
+	if (!com_fileindex_valid || com_fileindex_registered != (registered.value != 0))
+		COM_BuildFileIndex ();
+
+	hash = COM_HashFileName (filename);
+	mask = com_fileindex_size - 1;
+	for (pos = hash & mask; com_fileindex[pos].name; pos = (pos + 1) & mask)
+	{
+		entry = &com_fileindex[pos];
+		if (entry->hash == hash && (!best || entry->rank < best->rank) && COM_FileIndexMatches (entry, filename))
+			best = entry;
+	}
+
+	return best;
+}
+
+/*
+============
+COM_InvalidateFileIndex
+
+the search paths changed
+============
+*/
+static void COM_InvalidateFileIndex (void)
+{
+	com_fileindex_valid = false;
+}
+
+/*
+============
+COM_FlushDirectoryCache
+
+drops the directory listings, so files created since they were taken are found
+============
+*/
+void COM_FlushDirectoryCache (void)
+{
+	searchpath_t *search;
+
+	for (search = com_searchpaths; search; search = search->next)
+	{
+		if (search->pack)
+			continue;
+		free (search->dirfiles);
+		search->dirfiles = NULL;
+		search->numdirfiles = -1;
+	}
+
+	com_fileindex_valid = false;
+}
+
+/*
+============
+COM_AddDirectoryFile
+
+adds a file the engine just created at the OS path 'path' to the listings of
+the game directories it is in, so it is found without a rescan
+============
+*/
+void COM_AddDirectoryFile (const char *path)
+{
+	searchpath_t	*search;
+	const char		*name;
+	char			*list;
+	int				i, len, size;
+
+	for (search = com_searchpaths; search; search = search->next)
+	{
+		if (search->pack || search->numdirfiles < 0)
+			continue;
+		len = strlen (search->filename);
+		if (strncmp (path, search->filename, len) || path[len] != '/')
+			continue;
+		path += len + 1;
+
+		for (i = 0, name = search->dirfiles; i < search->numdirfiles; i++, name += strlen (name) + 1)
+			if (!strcmp (name, path))
+				break;
+		if (i == search->numdirfiles)
+		{
+			size = name - search->dirfiles;
+			list = (char *) realloc (search->dirfiles, size + strlen (path) + 1);
+			if (!list)
+				Sys_Error ("COM_AddDirectoryFile: out of memory");
+			strcpy (list + size, path);
+			search->dirfiles = list;
+			search->numdirfiles++;
+			com_fileindex_valid = false;
+		}
+		path -= len + 1;
+	}
+}
+
+/*
+===========================================================================
+
+PREFETCH
+
+Reads files on the job threads so they are in the OS file cache when the
+main thread gets to load them.  The search path lookup happens on the main
+thread, the jobs only see an OS path and a byte range.
+
+===========================================================================
+*/
+
+#define PREFETCH_CHUNK	16384
+
+typedef struct
+{
+	char	path[MAX_OSPATH];
+	long	offset;
+	int		length;		// -1 for the whole file
+} prefetchfile_t;
+
+static job_handle_t	com_prefetchfence;
+static qboolean		com_prefetching;
+static SDL_atomic_t	com_prefetchbytes;
+
+double	com_loadiotime;
+
+/*
+============
+COM_PrefetchJob
+============
+*/
+static void COM_PrefetchJob (void *payload)
+{
+	prefetchfile_t	*file = *(prefetchfile_t **) payload;
+	byte	buffer[PREFETCH_CHUNK];
+	int		remaining = (file->length < 0) ? INT_MAX : file->length;
+	int		read, total = 0;
+	FILE	*f;
+
+	f = fopen (file->path, "rb");
+	if (f)
+	{
+		if (!fseek (f, file->offset, SEEK_SET))
+		{
+			while (remaining > 0 && (read = fread (buffer, 1, q_min (remaining, PREFETCH_CHUNK), f)) > 0)
+			{
+				remaining -= read;
+				total += read;
+			}
+		}
+		fclose (f);
+	}
+
+	SDL_AtomicAdd (&com_prefetchbytes, total);
+	free (file);
+}
+
+/*
+============
+COM_PrefetchFile
+
+starts reading a file in the background, if it is in the search path
+============
+*/
+void COM_PrefetchFile (const char *filename)
+{
+	const fileindex_t	*entry = COM_FindFileIndex (filename);
+	const packfile_t	*packfile;
+	prefetchfile_t		*file;
+	job_handle_t		job;
+
+	if (!entry)
+		return;
+
+	file = (prefetchfile_t *) malloc (sizeof(prefetchfile_t));
+	if (!file)
+		return;
+
+	if (entry->search->pack)
+	{
+		packfile = &entry->search->pack->files[entry->file];
+		q_strlcpy (file->path, entry->search->pack->filename, sizeof(file->path));
+		file->offset = packfile->filepos;
+		file->length = packfile->packedlen ? packfile->packedlen : packfile->filelen;
+	}
+	else
+	{
+		q_snprintf (file->path, sizeof(file->path), "%s/%s", entry->search->filename, filename);
+		file->offset = 0;
+		file->length = -1;
+	}
+
+	if (!com_prefetching)
+	{
+		com_prefetchfence = Job_Allocate ();
+		com_prefetching = true;
+	}
+
+	job = Job_Allocate ();
+	Job_AssignFunc (job, COM_PrefetchJob, &file, sizeof(file));
+	Job_AddDependency (job, com_prefetchfence);
+	Job_Submit (job);
+}
+
+/*
+============
+COM_FinishPrefetch
+
+waits for all prefetches, returns the number of bytes they read
+============
+*/
+int COM_FinishPrefetch (void)
+{
+	if (com_prefetching)
+	{
+		Job_Submit (com_prefetchfence);
+		Job_Join (com_prefetchfence);
+		com_prefetching = false;
+	}
+
+	return SDL_AtomicSet (&com_prefetchbytes, 0);
+}
+
 /*
 ===========
 COM_FindFile
@@ -1881,10 +2528,11 @@ can be used for detecting a file's presence.
 static int COM_FindFile (const char *filename, int *handle, FILE **file,
 							unsigned int *path_id)
 {
+	const fileindex_t	*entry;
 	searchpath_t	*search;
 	char		netpath[MAX_OSPATH];
 	pack_t		*pak;
-	int		i, findtime;
+	int		i;
 
 	if (file && handle)
 		Sys_Error ("COM_FindFile: both handle and file set");
@@ -1892,53 +2540,70 @@ static int COM_FindFile (const char *filename, int *handle, FILE **file,
 	file_from_pak = 0;
 
 //
-// search through the path, one element at a time
+// look the file up in the index of the search path
 //
-	for (search = com_searchpaths; search; search = search->next)
+	entry = COM_FindFileIndex (filename);
+	if (entry)
 	{
-		if (search->pack)	/* look through all the pak file elements */
+		search = entry->search;
+		if (search->pack)	/* found in a pak file */
 		{
 			pak = search->pack;
-			for (i = 0; i < pak->numfiles; i++)
+			i = entry->file;
+			com_filesize = pak->files[i].filelen;
+			file_from_pak = 1;
+			if (path_id)
+				*path_id = search->path_id;
+			if (handle)
 			{
-				if (strcmp(pak->files[i].name, filename) != 0)
-					continue;
-				// found it!
-				com_filesize = pak->files[i].filelen;
-				file_from_pak = 1;
-				if (path_id)
-					*path_id = search->path_id;
-				if (handle)
-				{
-					*handle = pak->handle;
-					Sys_FileSeek (pak->handle, pak->files[i].filepos);
-					return com_filesize;
-				}
-				else if (file)
-				{ /* open a new file on the pakfile */
-					*file = fopen (pak->filename, "rb");
-					if (*file)
-						fseek (*file, pak->files[i].filepos, SEEK_SET);
+				if (pak->mapped)
+				{	/* pk3s have no shared handle: stored files get one of their own */
+					if (pak->files[i].packedlen)
+						Sys_Error ("COM_OpenFile: %s is compressed in %s, use COM_LoadFile", filename, pak->filename);
+					if (Sys_FileOpenRead (pak->filename, handle) == -1)
+					{
+						com_filesize = -1;
+						return com_filesize;
+					}
+					Sys_FileSeek (*handle, pak->files[i].filepos);
 					return com_filesize;
 				}
-				else /* for COM_FileExists() */
+				*handle = pak->handle;
+				Sys_FileSeek (pak->handle, pak->files[i].filepos);
+				return com_filesize;
+			}
+			else if (file && pak->files[i].packedlen)
+			{ /* inflate into a temporary file, FS_fread users see it at offset 0 */
+				*file = tmpfile ();
+				if (*file)
 				{
-					return com_filesize;
+					byte *data = (byte *) malloc (com_filesize + 1);
+					if (!data)
+						Sys_Error ("COM_FindFile: out of memory");
+					COM_ReadPackFile (pak, &pak->files[i], data);
+					fwrite (data, 1, com_filesize, *file);
+					free (data);
+					rewind (*file);
 				}
+				else
+					com_filesize = -1;
+				return com_filesize;
+			}
+			else if (file)
+			{ /* open a new file on the pakfile */
+				*file = fopen (pak->filename, "rb");
+				if (*file)
+					fseek (*file, pak->files[i].filepos, SEEK_SET);
+				return com_filesize;
+			}
+			else /* for COM_FileExists() */
+			{
+				return com_filesize;
 			}
 		}
-		else	/* check a file in the directory tree */
+		else	/* found in the directory tree */
 		{
-			if (!registered.value)
-			{ /* if not a registered version, don't ever go beyond base */
-				if ( strchr (filename, '/') || strchr (filename,'\\'))
-					continue;
-			}
-
 			q_snprintf (netpath, sizeof(netpath), "%s/%s",search->filename, filename);
-			findtime = Sys_FileTime (netpath);
-			if (findtime == -1)
-				continue;
 
 			if (path_id)
 				*path_id = search->path_id;
@@ -2042,7 +2707,7 @@ void COM_CloseFile (int h)
 COM_LoadFile
 
 Filename are reletive to the quake directory.
-Allways appends a 0 byte.
+Allways appends a 0 byte, except to mapped files.
 ============
 */
 #define	LOADFILE_ZONE		0
@@ -2051,13 +2716,97 @@ Allways appends a 0 byte.
 #define	LOADFILE_CACHE		3
 #define	LOADFILE_STACK		4
 #define	LOADFILE_MALLOC		5
+#define	LOADFILE_MAPPED		6	// read only view, released with COM_ReleaseMappedFile
 
 static byte	*loadbuf;
 static cache_user_t *loadcache;
 static int	loadsize;
 
+#define MAX_MAPPED_FILES	64
+
+typedef struct
+{
+	byte	*data;		// what the caller got, NULL for a free slot
+	void	*view;		// Sys_MapFile view, NULL if data was malloced
+	size_t	viewsize;
+} mappedfile_t;
+
+static mappedfile_t	com_mappedfiles[MAX_MAPPED_FILES];
+
+/*
+============
+COM_AddMappedFile
+============
+*/
+static byte *COM_AddMappedFile (byte *data, void *view, size_t viewsize)
+{
+	int i;
+
+	for (i = 0; i < MAX_MAPPED_FILES; i++)
+	{
+		if (com_mappedfiles[i].data)
+			continue;
+		com_mappedfiles[i].data = data;
+		com_mappedfiles[i].view = view;
+		com_mappedfiles[i].viewsize = viewsize;
+		return data;
+	}
+
+	Sys_Error ("COM_LoadMappedFile: more than %i files mapped", MAX_MAPPED_FILES);
+	return NULL;
+}
+
+/*
+============
+COM_MapFoundFile
+
+maps the loose file or the pak holding the file found at entry.  Every file
+gets a view of its own, so it stays valid when its pak is closed by a game
+change.  Returns NULL for deflated pk3 entries and anything that fails to map.
+============
+*/
+static byte *COM_MapFoundFile (const fileindex_t *entry, const char *path)
+{
+	const pack_t		*pak = entry->search->pack;
+	const packfile_t	*file;
+	char	netpath[MAX_OSPATH];
+	byte	*view;
+	size_t	size;
+
+	if (!pak)
+	{
+		q_snprintf (netpath, sizeof(netpath), "%s/%s", entry->search->filename, path);
+		view = (byte *) Sys_MapFile (netpath, &size);
+		if (!view)
+			return NULL;
+		if (size > INT_MAX)
+		{
+			Sys_UnmapFile (view, size);
+			return NULL;
+		}
+		com_filesize = (int)size;
+		return COM_AddMappedFile (view, view, size);
+	}
+
+	file = &pak->files[entry->file];
+	if (file->packedlen)
+		return NULL;
+
+	view = (byte *) Sys_MapFile (pak->filename, &size);
+	if (!view)
+		return NULL;
+	if ((size_t)file->filepos + file->filelen > size)
+	{
+		Sys_UnmapFile (view, size);
+		return NULL;
+	}
+	return COM_AddMappedFile (view + file->filepos, view, size);
+}
+
 byte *COM_LoadFile (const char *path, int usehunk, unsigned int *path_id)
 {
+	const fileindex_t	*entry;
+	pack_t	*zip;
 	int		h;
 	byte	*buf;
 	char	base[32];
@@ -2066,9 +2815,28 @@ byte *COM_LoadFile (const char *path, int usehunk, unsigned int *path_id)
 	buf = NULL;	// quiet compiler warning
 
 // look for it in the filesystem or pack files
-	len = COM_OpenFile (path, &h, path_id);
-	if (h == -1)
-		return NULL;
+	entry = COM_FindFileIndex (path);
+	if (usehunk == LOADFILE_MAPPED && entry)
+	{
+		COM_FindFile (path, NULL, NULL, path_id);	// sets com_filesize and file_from_pak
+		buf = COM_MapFoundFile (entry, path);
+		if (buf)
+			return buf;	// the reads happen as the caller touches it, not counted in com_loadiotime
+		// deflated or not mappable, hand out a private copy instead
+	}
+
+	zip = (entry && entry->search->pack && entry->search->pack->mapped) ? entry->search->pack : NULL;
+	if (zip)
+	{	// read straight from the mapped pk3
+		len = COM_FindFile (path, NULL, NULL, path_id);
+		h = -1;
+	}
+	else
+	{
+		len = COM_OpenFile (path, &h, path_id);
+		if (h == -1)
+			return NULL;
+	}
 
 // extract the filename base name for hunk tag
 	COM_FileBase (path, base, sizeof(base));
@@ -2094,6 +2862,7 @@ byte *COM_LoadFile (const char *path, int usehunk, unsigned int *path_id)
 			buf = (byte *) Hunk_TempAlloc (len+1);
 		break;
 	case LOADFILE_MALLOC:
+	case LOADFILE_MAPPED:
 		buf = (byte *) malloc (len+1);
 		break;
 	default:
@@ -2105,8 +2874,18 @@ byte *COM_LoadFile (const char *path, int usehunk, unsigned int *path_id)
 
 	((byte *)buf)[len] = 0;
 
-	Sys_FileRead (h, buf, len);
-	COM_CloseFile (h);
+	double time = Sys_DoubleTime ();
+	if (zip)
+		COM_ReadPackFile (zip, &zip->files[entry->file], buf);
+	else
+	{
+		Sys_FileRead (h, buf, len);
+		COM_CloseFile (h);
+	}
+	com_loadiotime += Sys_DoubleTime () - time;
+
+	if (usehunk == LOADFILE_MAPPED)
+		COM_AddMappedFile (buf, NULL, 0);
 
 	return buf;
 }
@@ -2150,6 +2929,32 @@ byte *COM_LoadMallocFile (const char *path, unsigned int *path_id)
 	return COM_LoadFile (path, LOADFILE_MALLOC, path_id);
 }
 
+// returns a read only view of the file, which must not be written to and
+// is not 0 terminated
+byte *COM_LoadMappedFile (const char *path, unsigned int *path_id)
+{
+	return COM_LoadFile (path, LOADFILE_MAPPED, path_id);
+}
+
+void COM_ReleaseMappedFile (byte *data)
+{
+	int i;
+
+	for (i = 0; i < MAX_MAPPED_FILES; i++)
+	{
+		if (com_mappedfiles[i].data != data)
+			continue;
+		if (com_mappedfiles[i].view)
+			Sys_UnmapFile (com_mappedfiles[i].view, com_mappedfiles[i].viewsize);
+		else
+			free (data);
+		com_mappedfiles[i].data = NULL;
+		return;
+	}
+
+	Sys_Error ("COM_ReleaseMappedFile: %p was not mapped", (void *)data);
+}
+
 byte *COM_LoadMallocFile_TextMode_OSPath (const char *path, long *len_out)
 {
 	FILE	*f;
@@ -2340,6 +3145,54 @@ qboolean COM_GameDirMatches(const char *tdirs)
 	return false;
 }
 
+/*
+=================
+COM_AddZipFiles
+=================
+*/
+static int COM_CompareZipNames (const void *a, const void *b)
+{
+	return q_strcasecmp (*(const char **)a, *(const char **)b);
+}
+
+static void COM_AddZipFiles (const char *dir, unsigned int path_id)
+{
+	int		size = 0, maxsize = 0, count = 0, numzips = 0, i;
+	char	*list = NULL, *name;
+	const char	**zips;
+	char	zipfile[MAX_OSPATH];
+	searchpath_t	*search;
+	pack_t	*pak;
+
+	COM_ScanDirectory_r (dir, "", MAX_DIRECTORY_DEPTH, &list, &size, &maxsize, &count);	// no subdirectories
+	if (!count)
+		return;
+
+	zips = (const char **) malloc (count * sizeof(char *));
+	if (!zips)
+		Sys_Error ("COM_AddZipFiles: out of memory");
+	for (i = 0, name = list; i < count; i++, name += strlen (name) + 1)
+		if (!q_strcasecmp (COM_FileGetExtension (name), "pk3"))
+			zips[numzips++] = name;
+	qsort (zips, numzips, sizeof(char *), COM_CompareZipNames);
+
+	for (i = 0; i < numzips; i++)
+	{
+		q_snprintf (zipfile, sizeof(zipfile), "%s/%s", dir, zips[i]);
+		pak = COM_LoadZipFile (zipfile);
+		if (!pak)
+			continue;
+		search = (searchpath_t *) Z_Malloc(sizeof(searchpath_t));
+		search->path_id = path_id;
+		search->pack = pak;
+		search->next = com_searchpaths;
+		com_searchpaths = search;
+	}
+
+	free (zips);
+	free (list);
+}
+
 /*
 =================
 COM_AddGameDirectory -- johnfitz -- modified based on topaz's tutorial
@@ -2381,6 +3234,7 @@ _add_path:
 	// add the directory to the search path
 	search = (searchpath_t *) Z_Malloc(sizeof(searchpath_t));
 	search->path_id = path_id;
+	search->numdirfiles = -1;
 	q_strlcpy (search->filename, com_gamedir, sizeof(search->filename));
 	search->next = com_searchpaths;
 	com_searchpaths = search;
@@ -2400,6 +3254,11 @@ _add_path:
 		if (!pak) break;
 	}
 
+	// then any pk3 files, in alphabetical order so later ones override earlier ones
+	COM_AddZipFiles (com_gamedir, path_id);
+
+	COM_InvalidateFileIndex ();
+
 	if (!been_here && host_parms->userdir != host_parms->basedir)
 	{
 		been_here = true;
@@ -2418,15 +3277,13 @@ void COM_ResetGameDirectories(const char *newdirs)
 	while (com_searchpaths != com_base_searchpaths)
 	{
 		if (com_searchpaths->pack)
-		{
-			Sys_FileClose (com_searchpaths->pack->handle);
-			Z_Free (com_searchpaths->pack->files);
-			Z_Free (com_searchpaths->pack);
-		}
+			COM_FreePackFile (com_searchpaths->pack);
+		free (com_searchpaths->dirfiles);
 		search = com_searchpaths->next;
 		Z_Free (com_searchpaths);
 		com_searchpaths = search;
 	}
+	COM_InvalidateFileIndex ();
 	hipnotic = false;
 	rogue = false;
 	standard_quake = true;
@@ -2918,6 +3775,24 @@ unsigned COM_HashString (const char *str)
 	return hash;
 }
 
+/*
+================
+COM_HashStringCaseless
+FNV-1a hash of str ignoring case, so that names which compare equal with
+q_strcasecmp land in the same bucket
+================
+*/
+unsigned COM_HashStringCaseless (const char *str)
+{
+	unsigned hash = 0x811c9dc5u;
+	while (*str)
+	{
+		hash ^= q_tolower (*str++);
+		hash *= 0x01000193u;
+	}
+	return hash;
+}
+
 static size_t mz_zip_file_read_func(void *opaque, mz_uint64 ofs, void *buf, size_t n)
 {
 	if (SDL_RWseek((SDL_RWops*)opaque, (Sint64)ofs, RW_SEEK_SET) < 0)
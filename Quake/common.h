@@ -208,6 +208,7 @@ char *va (const char *format, ...) FUNC_PRINTF(1,2);
 // does a varargs printf into a temp buffer
 
 unsigned COM_HashString (const char *str);
+unsigned COM_HashStringCaseless (const char *str);
 
 // localization support for 2021 rerelease version:
 void LOC_Init (void);
@@ -224,14 +225,17 @@ typedef struct
 {
 	char	name[MAX_QPATH];
 	int		filepos, filelen;
+	int		packedlen;		// size of the deflated data in a pk3, 0 if stored
 } packfile_t;
 
 typedef struct pack_s
 {
 	char	filename[MAX_OSPATH];
-	int		handle;
+	int		handle;			// -1 for pk3 files
 	int		numfiles;
 	packfile_t	*files;
+	byte	*mapped;		// whole pk3 file, NULL for id pak files
+	size_t	mappedsize;
 } pack_t;
 
 typedef struct searchpath_s
@@ -241,6 +245,8 @@ typedef struct searchpath_s
 					// <userdir>/game1 have the same id.
 	char	filename[MAX_OSPATH];
 	pack_t	*pack;			// only one of filename / pack will be used
+	int		numdirfiles;	// cached listing of a directory, -1 until scanned
+	char	*dirfiles;		// relative paths, each terminated by a 0
 	struct searchpath_s	*next;
 } searchpath_t;
 
@@ -261,6 +267,11 @@ void COM_WriteFile (const char *filename, const void *data, int len);
 int COM_OpenFile (const char *filename, int *handle, unsigned int *path_id);
 int COM_FOpenFile (const char *filename, FILE **file, unsigned int *path_id);
 qboolean COM_FileExists (const char *filename, unsigned int *path_id);
+void COM_FlushDirectoryCache (void);	// rescan the game directories on the next lookup
+void COM_AddDirectoryFile (const char *path);	// after creating a file in a game directory
+void COM_PrefetchFile (const char *filename);	// read into the OS file cache on a job thread
+int COM_FinishPrefetch (void);	// waits for the prefetches, returns the bytes read
+extern double com_loadiotime;	// seconds COM_LoadFile spent reading
 void COM_CloseFile (int h);
 
 // these procedures open a file using COM_FindFile and loads it into a proper
@@ -282,6 +293,10 @@ void COM_LoadCacheFile (const char *path, struct cache_user_s *cu,
 	// uses cache mem for allocating the buffer.
 byte *COM_LoadMallocFile (const char *path, unsigned int *path_id);
 	// allocates the buffer on the system mem (malloc).
+byte *COM_LoadMappedFile (const char *path, unsigned int *path_id);
+void COM_ReleaseMappedFile (byte *data);
+	// read only view into the file or its pak, without the 0 terminator.
+	// must be given back with COM_ReleaseMappedFile.
 
 // Opens the given path directly, ignoring search paths.
 // Returns NULL on failure, or else a '\0'-terminated malloc'ed buffer.
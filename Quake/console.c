@@ -167,6 +167,7 @@ static void Con_Dump_f (void)
 		Con_Printf ("ERROR: couldn't open file %s.\n", name);
 		return;
 	}
+	COM_AddDirectoryFile (name);
 
 	// skip initial empty lines
 	for (l = con_current - con_totallines + 1; l <= con_current; l++)
@@ -744,6 +745,7 @@ typedef struct cmdalias_s
 	struct cmdalias_s	*next;
 	char	name[MAX_ALIAS_NAME];
 	char	*value;
+	struct cmdalias_s	*hashnext;
 } cmdalias_t;
 extern	cmdalias_t	*cmd_alias;
 
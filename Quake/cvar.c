@@ -24,6 +24,11 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "quakedef.h"
 
 static cvar_t	*cvar_vars;
+
+// cvar_vars stays sorted for listing and completion, lookups go through the
+// hash. The hash ignores case, the name comparison doesn't.
+#define	CVAR_HASH_SIZE	512
+static cvar_t	*cvar_hash[CVAR_HASH_SIZE];
 static char	cvar_null_string[] = "";
 
 //==============================================================================
@@ -249,7 +254,7 @@ cvar_t *Cvar_FindVar (const char *var_name)
 {
 	cvar_t	*var;
 
-	for (var = cvar_vars ; var ; var = var->next)
+	for (var = cvar_hash[COM_HashStringCaseless (var_name) & (CVAR_HASH_SIZE - 1)] ; var ; var = var->hashnext)
 	{
 		if (!Q_strcmp(var_name, var->name))
 			return var;
@@ -534,6 +539,7 @@ void Cvar_RegisterVariable (cvar_t *variable)
 	char	value[512];
 	qboolean	set_rom;
 	cvar_t	*cursor,*prev; //johnfitz -- sorted list insert
+	unsigned int	hash;
 
 // first check to see if it has already been defined
 	if (Cvar_FindVar (variable->name))
@@ -570,6 +576,9 @@ void Cvar_RegisterVariable (cvar_t *variable)
 		prev->next = variable;
 	}
 	//johnfitz
+	hash = COM_HashStringCaseless (variable->name) & (CVAR_HASH_SIZE - 1);
+	variable->hashnext = cvar_hash[hash];
+	cvar_hash[hash] = variable;
 	variable->flags |= CVAR_REGISTERED;
 
 // copy the value off, because future sets will Z_Free it
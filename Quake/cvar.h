@@ -87,6 +87,7 @@ typedef struct cvar_s
 	const char	*default_string; //johnfitz -- remember defaults for reset function
 	cvarcallback_t	callback;
 	struct cvar_s	*next;
+	struct cvar_s	*hashnext;
 } cvar_t;
 
 void	Cvar_RegisterVariable (cvar_t *variable);
@@ -562,10 +562,10 @@ void Draw_Character (int x, int y, int num)
 
 	Draw_FillCharacterQuad(x, y, (char)num, vertices);
 
-	vulkan_globals.vk_cmd_bind_vertex_buffers(vulkan_globals.command_buffer, 0, 1, &buffer, &buffer_offset);
+	vulkan_globals.vk_cmd_bind_vertex_buffers(vulkan_recording.command_buffer, 0, 1, &buffer, &buffer_offset);
 	R_BindPipeline(VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_alphatest_pipeline[render_pass_index]);
-	vulkan_globals.vk_cmd_bind_descriptor_sets(vulkan_globals.command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_pipeline_layout.handle, 0, 1, &char_texture->descriptor_set, 0, NULL);
-	vulkan_globals.vk_cmd_draw(vulkan_globals.command_buffer, 6, 1, 0, 0);
+	vulkan_globals.vk_cmd_bind_descriptor_sets(vulkan_recording.command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_pipeline_layout.handle, 0, 1, &char_texture->descriptor_set, 0, NULL);
+	vulkan_globals.vk_cmd_draw(vulkan_recording.command_buffer, 6, 1, 0, 0);
 }
 
 /*
@@ -600,10 +600,10 @@ void Draw_String (int x, int y, const char *str)
 		x += 8;
 	}
 
-	vulkan_globals.vk_cmd_bind_vertex_buffers(vulkan_globals.command_buffer, 0, 1, &buffer, &buffer_offset);
+	vulkan_globals.vk_cmd_bind_vertex_buffers(vulkan_recording.command_buffer, 0, 1, &buffer, &buffer_offset);
 	R_BindPipeline(VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_alphatest_pipeline[render_pass_index]);
-	vulkan_globals.vk_cmd_bind_descriptor_sets(vulkan_globals.command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_pipeline_layout.handle, 0, 1, &char_texture->descriptor_set, 0, NULL);
-	vulkan_globals.vk_cmd_draw(vulkan_globals.command_buffer, num_verts, 1, 0, 0);
+	vulkan_globals.vk_cmd_bind_descriptor_sets(vulkan_recording.command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_pipeline_layout.handle, 0, 1, &char_texture->descriptor_set, 0, NULL);
+	vulkan_globals.vk_cmd_draw(vulkan_recording.command_buffer, num_verts, 1, 0, 0);
 }
 
 /*
@@ -661,13 +661,13 @@ void Draw_Pic (int x, int y, qpic_t *pic, float alpha, qboolean alpha_blend)
 	vertices[4] = corner_verts[3];
 	vertices[5] = corner_verts[0];
 
-	vkCmdBindVertexBuffers(vulkan_globals.command_buffer, 0, 1, &buffer, &buffer_offset);
+	vkCmdBindVertexBuffers(vulkan_recording.command_buffer, 0, 1, &buffer, &buffer_offset);
 	if (alpha_blend)
 		R_BindPipeline(VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_blend_pipeline[render_pass_index]);
 	else 
 		R_BindPipeline(VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_alphatest_pipeline[render_pass_index]);
-	vkCmdBindDescriptorSets(vulkan_globals.command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_pipeline_layout.handle, 0, 1, &gl.gltexture->descriptor_set, 0, NULL);
-	vkCmdDraw(vulkan_globals.command_buffer, 6, 1, 0, 0);
+	vkCmdBindDescriptorSets(vulkan_recording.command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_pipeline_layout.handle, 0, 1, &gl.gltexture->descriptor_set, 0, NULL);
+	vkCmdDraw(vulkan_recording.command_buffer, 6, 1, 0, 0);
 }
 
 void Draw_SubPic (float x, float y, float w, float h, qpic_t *pic, float s1, float t1, float s2, float t2, float * rgb, float alpha)
@@ -731,13 +731,13 @@ void Draw_SubPic (float x, float y, float w, float h, qpic_t *pic, float s1, flo
 	vertices[4] = corner_verts[3];
 	vertices[5] = corner_verts[0];
 
-	vkCmdBindVertexBuffers(vulkan_globals.command_buffer, 0, 1, &buffer, &buffer_offset);
+	vkCmdBindVertexBuffers(vulkan_recording.command_buffer, 0, 1, &buffer, &buffer_offset);
 	if (alpha_blend)
 		R_BindPipeline(VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_blend_pipeline[render_pass_index]);
 	else 
 		R_BindPipeline(VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_alphatest_pipeline[render_pass_index]);
-	vkCmdBindDescriptorSets(vulkan_globals.command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_pipeline_layout.handle, 0, 1, &gl.gltexture->descriptor_set, 0, NULL);
-	vkCmdDraw(vulkan_globals.command_buffer, 6, 1, 0, 0);
+	vkCmdBindDescriptorSets(vulkan_recording.command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_pipeline_layout.handle, 0, 1, &gl.gltexture->descriptor_set, 0, NULL);
+	vkCmdDraw(vulkan_recording.command_buffer, 6, 1, 0, 0);
 }
 
 
@@ -847,9 +847,9 @@ void Draw_TileClear (int x, int y, int w, int h)
 	vertices[5] = corner_verts[0];
 
 	R_BindPipeline(VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_blend_pipeline[render_pass_index]);
-	vkCmdBindDescriptorSets(vulkan_globals.command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_pipeline_layout.handle, 0, 1, &gl.gltexture->descriptor_set, 0, NULL);
-	vkCmdBindVertexBuffers(vulkan_globals.command_buffer, 0, 1, &buffer, &buffer_offset);
-	vkCmdDraw(vulkan_globals.command_buffer, 6, 1, 0, 0);
+	vkCmdBindDescriptorSets(vulkan_recording.command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_pipeline_layout.handle, 0, 1, &gl.gltexture->descriptor_set, 0, NULL);
+	vkCmdBindVertexBuffers(vulkan_recording.command_buffer, 0, 1, &buffer, &buffer_offset);
+	vkCmdDraw(vulkan_recording.command_buffer, 6, 1, 0, 0);
 }
 
 /*
@@ -901,9 +901,9 @@ void Draw_Fill (int x, int y, int w, int h, int c, float alpha) //johnfitz -- ad
 	vertices[4] = corner_verts[3];
 	vertices[5] = corner_verts[0];
 
-	vkCmdBindVertexBuffers(vulkan_globals.command_buffer, 0, 1, &buffer, &buffer_offset);
+	vkCmdBindVertexBuffers(vulkan_recording.command_buffer, 0, 1, &buffer, &buffer_offset);
 	R_BindPipeline(VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_notex_blend_pipeline[render_pass_index]);
-	vkCmdDraw(vulkan_globals.command_buffer, 6, 1, 0, 0);
+	vkCmdDraw(vulkan_recording.command_buffer, 6, 1, 0, 0);
 }
 
 /*
@@ -946,9 +946,9 @@ void Draw_FadeScreen (void)
 	vertices[4] = corner_verts[3];
 	vertices[5] = corner_verts[0];
 
-	vkCmdBindVertexBuffers(vulkan_globals.command_buffer, 0, 1, &buffer, &buffer_offset);
+	vkCmdBindVertexBuffers(vulkan_recording.command_buffer, 0, 1, &buffer, &buffer_offset);
 	R_BindPipeline(VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_notex_blend_pipeline[render_pass_index]);
-	vkCmdDraw(vulkan_globals.command_buffer, 6, 1, 0, 0);
+	vkCmdDraw(vulkan_recording.command_buffer, 6, 1, 0, 0);
 
 	Sbar_Changed();
 }
@@ -1000,7 +1000,7 @@ void GL_Viewport(float x, float y, float width, float height, float min_depth, f
 	viewport.minDepth = min_depth;
 	viewport.maxDepth = max_depth;
 
-	vkCmdSetViewport(vulkan_globals.command_buffer, 0, 1, &viewport);
+	vkCmdSetViewport(vulkan_recording.command_buffer, 0, 1, &viewport);
 }
 
 /*
@@ -1103,10 +1103,21 @@ GL_Set2D
 */
 qboolean GL_Set2D (void)
 {
-	currentcanvas = CANVAS_INVALID;
-	GL_SetCanvas (CANVAS_DEFAULT);
+	if (R_ExecuteSceneStages ())
+	{
+		// only vkCmdExecuteCommands is allowed in the scene subpass, set the canvas after it
+		vkCmdEndRenderPass(vulkan_recording.command_buffer);
+		R_BindPipeline(VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_blend_pipeline[render_pass_index]);
+		currentcanvas = CANVAS_INVALID;
+		GL_SetCanvas (CANVAS_DEFAULT);
+	}
+	else
+	{
+		currentcanvas = CANVAS_INVALID;
+		GL_SetCanvas (CANVAS_DEFAULT);
 
-	vkCmdEndRenderPass(vulkan_globals.command_buffer);
+		vkCmdEndRenderPass(vulkan_recording.command_buffer);
+	}
 
 	qboolean screen_effects = render_warp || (render_scale >= 2);
 	if (screen_effects)
@@ -1144,7 +1155,7 @@ qboolean GL_Set2D (void)
 		image_barriers[1].subresourceRange.baseArrayLayer = 0;
 		image_barriers[1].subresourceRange.layerCount = 1;
 
-		vkCmdPipelineBarrier(vulkan_globals.command_buffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, NULL, 0, NULL, 2, image_barriers);
+		vkCmdPipelineBarrier(vulkan_recording.command_buffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, NULL, 0, NULL, 2, image_barriers);
 		
 		GL_SetCanvas(CANVAS_NONE); // Invalidate canvas so push constants get set later
 
@@ -1160,7 +1171,7 @@ qboolean GL_Set2D (void)
 			pipeline = &vulkan_globals.screen_effects_pipeline;
 
 		R_BindPipeline(VK_PIPELINE_BIND_POINT_COMPUTE, *pipeline);
-		vkCmdBindDescriptorSets(vulkan_globals.command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline->layout.handle, 0, 1, &vulkan_globals.screen_warp_desc_set, 0, NULL);
+		vkCmdBindDescriptorSets(vulkan_recording.command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline->layout.handle, 0, 1, &vulkan_globals.screen_warp_desc_set, 0, NULL);
 
 		uint32_t screen_effect_flags = 0;
 		if (render_warp)
@@ -1179,7 +1190,7 @@ qboolean GL_Set2D (void)
 			screen_effect_flags };
 		R_PushConstants(VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(screen_effect_constants_t), &push_constants);
 
-		vkCmdDispatch(vulkan_globals.command_buffer, (vid.width + 7) / 8, (vid.height + 7) / 8, 1);
+		vkCmdDispatch(vulkan_recording.command_buffer, (vid.width + 7) / 8, (vid.height + 7) / 8, 1);
 
 		image_barriers[0].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
 		image_barriers[0].pNext = NULL;
@@ -1196,7 +1207,7 @@ qboolean GL_Set2D (void)
 		image_barriers[0].subresourceRange.baseArrayLayer = 0;
 		image_barriers[0].subresourceRange.layerCount = 1;
 
-		vkCmdPipelineBarrier(vulkan_globals.command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0, 0, NULL, 0, NULL, 1, image_barriers);
+		vkCmdPipelineBarrier(vulkan_recording.command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0, 0, NULL, 0, NULL, 1, image_barriers);
 
 		R_EndDebugUtilsLabel ();
 	}
@@ -1208,13 +1219,13 @@ qboolean GL_Set2D (void)
 		memory_barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
 		memory_barrier.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
 
-		vkCmdPipelineBarrier(vulkan_globals.command_buffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0, 1, &memory_barrier, 0, NULL, 0, NULL);
+		vkCmdPipelineBarrier(vulkan_recording.command_buffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0, 1, &memory_barrier, 0, NULL, 0, NULL);
 	}
 
 	if (GL_AcquireNextSwapChainImage() == false)
 		return false;
 
-	vkCmdBeginRenderPass(vulkan_globals.command_buffer, &vulkan_globals.ui_render_pass_begin_info, VK_SUBPASS_CONTENTS_INLINE);
+	vkCmdBeginRenderPass(vulkan_recording.command_buffer, &vulkan_globals.ui_render_pass_begin_info, VK_SUBPASS_CONTENTS_INLINE);
 	render_pass_index = 1;
 	R_BindPipeline(VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_blend_pipeline[render_pass_index]);
 
@@ -231,7 +231,7 @@ calculates fog color for this frame, taking into account fade times
 */
 float *Fog_GetColor (void)
 {
-	static float c[4];
+	static THREAD_LOCAL float c[4];	// the sky stage may be recorded by a job
 	float f;
 	int i;
 
@@ -316,7 +316,7 @@ called after drawing stuff that should be fogged
 void Fog_DisableGFog (void)
 {
 	float fog_values[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
-	assert(vulkan_globals.current_pipeline.layout.handle == vulkan_globals.basic_pipeline_layout.handle);
+	assert(vulkan_recording.current_pipeline.layout.handle == vulkan_globals.basic_pipeline_layout.handle);
 	R_PushConstants(VK_SHADER_STAGE_ALL_GRAPHICS, 16 * sizeof(float), 4 * sizeof(float), fog_values);
 }
 
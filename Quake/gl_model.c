@@ -26,6 +26,12 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "quakedef.h"
 
+#if defined(SDL_FRAMEWORK) || defined(NO_SDL_CONFIG)
+#include <SDL2/SDL.h>
+#else
+#include "SDL.h"
+#endif
+
 qmodel_t	*loadmodel;
 char	loadname[32];	// for hunk tags
 
@@ -43,10 +49,19 @@ static int	mod_novis_capacity;
 static byte	*mod_decompressed;
 static int	mod_decompressed_capacity;
 
+static byte	*mod_mappedfile;	// bsp being loaded, left mapped if a Host_Error interrupted the load
+
 #define	MAX_MOD_KNOWN	2048 /*johnfitz -- was 512 */
 qmodel_t	mod_known[MAX_MOD_KNOWN];
 int		mod_numknown;
 
+// Mod_FindName lookups: models are only ever added until Mod_ResetAll, so the
+// chains are plain indices, kept outside qmodel_t which gets copied around
+#define	MOD_HASH_SIZE	1024
+static int		mod_hash[MOD_HASH_SIZE];		// first model + 1, 0 for none
+static int		mod_hashnext[MAX_MOD_KNOWN];	// next model + 1 in the bucket
+static unsigned int	mod_namehash[MAX_MOD_KNOWN];
+
 texture_t	*r_notexture_mip; //johnfitz -- moved here from r_main.c
 texture_t	*r_notexture_mip2; //johnfitz -- used for non-lightmapped surfs with a missing texture
 
@@ -118,12 +133,15 @@ Caches the data if needed
 void *Mod_Extradata (qmodel_t *mod)
 {
 	void	*r;
+	memtag_t	tag;
 
 	r = Cache_Check (&mod->cache);
 	if (r)
 		return r;
 
+	tag = Memory_SetTag (MEMTAG_MODEL);
 	Mod_LoadModel (mod, true);
+	Memory_SetTag (tag);
 
 	if (!mod->cache.data)
 		Sys_Error ("Mod_Extradata: caching failed");
@@ -283,6 +301,7 @@ void Mod_ResetAll (void)
 		memset(mod, 0, sizeof(qmodel_t));
 	}
 	mod_numknown = 0;
+	memset (mod_hash, 0, sizeof(mod_hash));
 }
 
 /*
@@ -295,6 +314,7 @@ qmodel_t *Mod_FindName (const char *name)
 {
 	int		i;
 	qmodel_t	*mod;
+	unsigned int	hash;
 
 	if (!name[0])
 		Sys_Error ("Mod_FindName: NULL name"); //johnfitz -- was "Mod_ForName"
@@ -302,19 +322,21 @@ qmodel_t *Mod_FindName (const char *name)
 //
 // search the currently loaded models
 //
-	for (i=0 , mod=mod_known ; i<mod_numknown ; i++, mod++)
-		if (!strcmp (mod->name, name) )
-			break;
-
-	if (i == mod_numknown)
-	{
-		if (mod_numknown == MAX_MOD_KNOWN)
-			Sys_Error ("mod_numknown == MAX_MOD_KNOWN");
-		q_strlcpy (mod->name, name, MAX_QPATH);
-		mod->needload = true;
-		mod_numknown++;
-		InvalidateTraceLineCache();
-	}
+	hash = COM_HashString (name);
+	for (i = mod_hash[hash & (MOD_HASH_SIZE - 1)] - 1 ; i >= 0 ; i = mod_hashnext[i] - 1)
+		if (mod_namehash[i] == hash && !strcmp (mod_known[i].name, name))
+			return &mod_known[i];
+
+	if (mod_numknown == MAX_MOD_KNOWN)
+		Sys_Error ("mod_numknown == MAX_MOD_KNOWN");
+	i = mod_numknown++;
+	mod = &mod_known[i];
+	q_strlcpy (mod->name, name, MAX_QPATH);
+	mod->needload = true;
+	mod_namehash[i] = hash;
+	mod_hashnext[i] = mod_hash[hash & (MOD_HASH_SIZE - 1)];
+	mod_hash[hash & (MOD_HASH_SIZE - 1)] = i + 1;
+	InvalidateTraceLineCache();
 
 	return mod;
 }
@@ -364,10 +386,16 @@ qmodel_t *Mod_LoadModel (qmodel_t *mod, qboolean crash)
 
 	InvalidateTraceLineCache();
 
+	if (mod_mappedfile)
+	{
+		COM_ReleaseMappedFile (mod_mappedfile);
+		mod_mappedfile = NULL;
+	}
+
 //
 // load the file
 //
-	buf = COM_LoadStackFile (mod->name, stackbuf, sizeof(stackbuf), & mod->path_id);
+	buf = COM_LoadMappedFile (mod->name, & mod->path_id);
 	if (!buf)
 	{
 		if (crash)
@@ -375,6 +403,21 @@ qmodel_t *Mod_LoadModel (qmodel_t *mod, qboolean crash)
 		return NULL;
 	}
 
+	mod_type = (com_filesize >= 4) ? (buf[0] | (buf[1] << 8) | (buf[2] << 16) | (buf[3] << 24)) : 0;
+	if (mod_type == IDPOLYHEADER || mod_type == IDSPRITEHEADER)
+	{	// these loaders patch the file in place, so they need a copy
+		COM_ReleaseMappedFile (buf);
+		buf = COM_LoadStackFile (mod->name, stackbuf, sizeof(stackbuf), & mod->path_id);
+		if (!buf)
+		{
+			if (crash)
+				Host_Error ("Mod_LoadModel: %s not found", mod->name);
+			return NULL;
+		}
+	}
+	else	// brush models only read the file
+		mod_mappedfile = buf;
+
 //
 // allocate a new model
 //
@@ -389,7 +432,6 @@ qmodel_t *Mod_LoadModel (qmodel_t *mod, qboolean crash)
 // call the apropriate loader
 	mod->needload = false;
 
-	mod_type = (buf[0] | (buf[1] << 8) | (buf[2] << 16) | (buf[3] << 24));
 	switch (mod_type)
 	{
 	case IDPOLYHEADER:
@@ -402,6 +444,8 @@ qmodel_t *Mod_LoadModel (qmodel_t *mod, qboolean crash)
 
 	default:
 		Mod_LoadBrushModel (mod, buf);
+		COM_ReleaseMappedFile (mod_mappedfile);
+		mod_mappedfile = NULL;
 		break;
 	}
 
@@ -418,10 +462,15 @@ Loads in a model for the given name
 qmodel_t *Mod_ForName (const char *name, qboolean crash)
 {
 	qmodel_t	*mod;
+	memtag_t	tag;
 
 	mod = Mod_FindName (name);
 
-	return Mod_LoadModel (mod, crash);
+	tag = Memory_SetTag (MEMTAG_MODEL);
+	mod = Mod_LoadModel (mod, crash);
+	Memory_SetTag (tag);
+
+	return mod;
 }
 
 
@@ -808,6 +857,8 @@ void Mod_LoadLighting (lump_t *l)
 				{
 					Con_DPrintf2("%s loaded\n", litfilename);
 					loadmodel->lightdata = data + 8;
+					if (loadmodel->checksum)
+						loadmodel->checksum ^= Com_BlockChecksum (data, com_filesize);
 					return;
 				}
 				Hunk_FreeToLowMark(mark);
@@ -946,6 +997,101 @@ _load_embedded:
 	memcpy (loadmodel->entities, mod_base + l->fileofs, l->filelen);
 }
 
+/*
+==============================================================================
+
+PARALLEL LUMP LOADING
+
+Lumps that are plain per-element conversions (vertexes, edges, surfedges and
+planes) are validated and allocated on the main thread, then converted by
+indexed jobs while the textures, lighting and texinfo are loaded.
+Mod_LoadFaces joins them before it reads the geometry, and decodes the faces
+themselves in parallel as well. Anything that touches the hunk, prints or
+may error out stays on the main thread.
+
+No loader run while conversions are pending may Host_Error: the jobs write
+into hunk memory that must stay allocated until Mod_FinishLumpJobs.
+==============================================================================
+*/
+
+#define MOD_LOAD_BATCH	1024	// elements converted per job index
+
+typedef struct
+{
+	byte	*in;
+	void	*out;
+	int		count;
+	int		bsp2;
+} lumpconvert_t;
+
+static job_handle_t mod_lumpfence;
+static qboolean mod_lumpjobs;	// mod_lumpfence is allocated, 0 is a valid handle
+
+/*
+=================
+Mod_QueueLumpJob
+=================
+*/
+static void Mod_QueueLumpJob (job_indexed_func_t func, byte *in, void *out, int count, int bsp2)
+{
+	lumpconvert_t	payload;
+	job_handle_t	job;
+
+	if (count <= 0)
+		return;
+
+	payload.in = in;
+	payload.out = out;
+	payload.count = count;
+	payload.bsp2 = bsp2;
+
+	if (!mod_lumpjobs)
+	{
+		mod_lumpfence = Job_Allocate ();
+		mod_lumpjobs = true;
+	}
+	job = Job_Allocate ();
+	Job_AssignIndexedFunc (job, func, (count + MOD_LOAD_BATCH - 1) / MOD_LOAD_BATCH, &payload, sizeof(payload));
+	Job_AddDependency (job, mod_lumpfence);
+	Job_Submit (job);
+}
+
+/*
+=================
+Mod_FinishLumpJobs
+
+Waits for all queued lump conversions.
+=================
+*/
+static void Mod_FinishLumpJobs (void)
+{
+	if (!mod_lumpjobs)
+		return;
+	Job_Submit (mod_lumpfence);
+	Job_Join (mod_lumpfence);
+	mod_lumpjobs = false;
+}
+
+/*
+=================
+Mod_ConvertVertexes
+=================
+*/
+static void Mod_ConvertVertexes (int index, void *payload)
+{
+	lumpconvert_t	*lump = (lumpconvert_t *) payload;
+	int				i = index * MOD_LOAD_BATCH;
+	int				end = q_min (i + MOD_LOAD_BATCH, lump->count);
+	byte			*in = lump->in + i * sizeof(dvertex_t);
+	mvertex_t		*out = (mvertex_t *) lump->out + i;
+
+	for ( ; i<end ; i++, in += sizeof(dvertex_t), out++)
+	{
+		out->position[0] = ReadFloatUnaligned (in + offsetof(dvertex_t, point[0]));
+		out->position[1] = ReadFloatUnaligned (in + offsetof(dvertex_t, point[1]));
+		out->position[2] = ReadFloatUnaligned (in + offsetof(dvertex_t, point[2]));
+	}
+}
 
 /*
 =================
@@ -956,7 +1102,7 @@ void Mod_LoadVertexes (lump_t *l)
 {
 	byte	*in;
 	mvertex_t	*out;
-	int			i, count;
+	int			count;
 
 	in = mod_base + l->fileofs;
 	if (l->filelen % sizeof(dvertex_t))
@@ -967,38 +1113,25 @@ void Mod_LoadVertexes (lump_t *l)
 	loadmodel->vertexes = out;
 	loadmodel->numvertexes = count;
 
-	for (i=0 ; i<count ; i++, in += sizeof(dvertex_t), out++)
-	{
-		out->position[0] = ReadFloatUnaligned (in + offsetof(dvertex_t, point[0]));
-		out->position[1] = ReadFloatUnaligned (in + offsetof(dvertex_t, point[1]));
-		out->position[2] = ReadFloatUnaligned (in + offsetof(dvertex_t, point[2]));
-	}
+	Mod_QueueLumpJob (Mod_ConvertVertexes, in, out, count, false);
 }
 
 /*
 =================
-Mod_LoadEdges
+Mod_ConvertEdges
 =================
 */
-void Mod_LoadEdges (lump_t *l, int bsp2)
+static void Mod_ConvertEdges (int index, void *payload)
 {
-	medge_t *out;
-	int 	i, count;
+	lumpconvert_t	*lump = (lumpconvert_t *) payload;
+	int				i = index * MOD_LOAD_BATCH;
+	int				end = q_min (i + MOD_LOAD_BATCH, lump->count);
+	medge_t			*out = (medge_t *) lump->out + i;
+	byte			*in;
 
-	if (bsp2)
+	if (lump->bsp2)
 	{
-		byte *in = mod_base + l->fileofs;
-
-		if (l->filelen % sizeof(dledge_t))
-			Sys_Error ("MOD_LoadBmodel: funny lump size in %s",loadmodel->name);
-
-		count = l->filelen / sizeof(dledge_t);
-		out = (medge_t *) Hunk_AllocName ( (count + 1) * sizeof(*out), loadname);
-
-		loadmodel->edges = out;
-		loadmodel->numedges = count;
-
-		for (i=0 ; i<count ; i++, in += sizeof(dledge_t), out++)
+		for (in = lump->in + i * sizeof(dledge_t) ; i<end ; i++, in += sizeof(dledge_t), out++)
 		{
 			out->v[0] = ReadLongUnaligned(in + offsetof(dledge_t, v[0]));
 			out->v[1] = ReadLongUnaligned(in + offsetof(dledge_t, v[1]));
@@ -1006,18 +1139,7 @@ void Mod_LoadEdges (lump_t *l, int bsp2)
 	}
 	else
 	{
-		byte *in = mod_base + l->fileofs;
-
-		if (l->filelen % sizeof(dsedge_t))
-			Sys_Error ("MOD_LoadBmodel: funny lump size in %s",loadmodel->name);
-
-		count = l->filelen / sizeof(dsedge_t);
-		out = (medge_t *) Hunk_AllocName ( (count + 1) * sizeof(*out), loadname);
-
-		loadmodel->edges = out;
-		loadmodel->numedges = count;
-
-		for (i=0 ; i<count ; i++, in += sizeof(dsedge_t), out++)
+		for (in = lump->in + i * sizeof(dsedge_t) ; i<end ; i++, in += sizeof(dsedge_t), out++)
 		{
 			out->v[0] = (unsigned short)ReadShortUnaligned(in + offsetof(dsedge_t, v[0]));
 			out->v[1] = (unsigned short)ReadShortUnaligned(in + offsetof(dsedge_t, v[1]));
@@ -1025,6 +1147,30 @@ void Mod_LoadEdges (lump_t *l, int bsp2)
 	}
 }
 
+/*
+=================
+Mod_LoadEdges
+=================
+*/
+void Mod_LoadEdges (lump_t *l, int bsp2)
+{
+	medge_t *out;
+	byte	*in = mod_base + l->fileofs;
+	size_t	insize = bsp2 ? sizeof(dledge_t) : sizeof(dsedge_t);
+	int 	count;
+
+	if (l->filelen % insize)
+		Sys_Error ("MOD_LoadBmodel: funny lump size in %s",loadmodel->name);
+
+	count = l->filelen / insize;
+	out = (medge_t *) Hunk_AllocName ( (count + 1) * sizeof(*out), loadname);
+
+	loadmodel->edges = out;
+	loadmodel->numedges = count;
+
+	Mod_QueueLumpJob (Mod_ConvertEdges, in, out, count, bsp2);
+}
+
 /*
 =================
 Mod_LoadTexinfo
@@ -1084,10 +1230,11 @@ void Mod_LoadTexinfo (lump_t *l)
 ================
 CalcSurfaceExtents
 
-Fills in s->texturemins[] and s->extents[]
+Fills in s->texturemins[] and s->extents[], returns false if the extents
+are too large.  Called from jobs, so it must not error out itself.
 ================
 */
-void CalcSurfaceExtents (msurface_t *s)
+qboolean CalcSurfaceExtents (msurface_t *s)
 {
 	float	mins[2], maxs[2], val;
 	int		i,j, e;
@@ -1146,8 +1293,10 @@ void CalcSurfaceExtents (msurface_t *s)
 		s->extents[i] = (bmaxs[i] - bmins[i]) * 16;
 
 		if ( !(tex->flags & TEX_SPECIAL) && s->extents[i] > 2000) //johnfitz -- was 512 in glquake, 256 in winquake
-			Sys_Error ("Bad surface extents");
+			return false;
 	}
+
+	return true;
 }
 
 /*
@@ -1199,70 +1348,60 @@ void Mod_PolyForUnlitSurface (msurface_t *fa)
 	}
 }
 
+typedef struct
+{
+	byte		*in;
+	msurface_t	*out;
+	int			count;
+	qboolean	bsp2;
+	SDL_atomic_t	*badextents;
+} faceconvert_t;
+
 /*
 =================
-Mod_LoadFaces
+Mod_ConvertFaces
+
+Decodes a batch of faces and classifies them by texture.  Polys for the
+unlit surfaces live on the hunk and are built afterwards by Mod_LoadFaces.
 =================
 */
-void Mod_LoadFaces (lump_t *l, qboolean bsp2)
+static void Mod_ConvertFaces (int index, void *payload)
 {
-	byte	*ins;
-	byte	*inl;
-	msurface_t 	*out;
-	int			i, count, surfnum, lofs;
-	int			planenum, side, texinfon;
+	faceconvert_t	*faces = (faceconvert_t *) payload;
+	int				surfnum = index * MOD_LOAD_BATCH;
+	int				end = q_min (surfnum + MOD_LOAD_BATCH, faces->count);
+	msurface_t		*out = faces->out + surfnum;
+	byte			*in;
+	int				i, lofs;
+	int				planenum, side, texinfon;
 
-	if (bsp2)
-	{
-		ins = NULL;
-		inl = mod_base + l->fileofs;
-		if (l->filelen % sizeof(dlface_t))
-			Sys_Error ("MOD_LoadBmodel: funny lump size in %s",loadmodel->name);
-		count = l->filelen / sizeof(dlface_t);
-	}
-	else
-	{
-		ins = mod_base + l->fileofs;
-		inl = NULL;
-		if (l->filelen % sizeof(dsface_t))
-			Sys_Error ("MOD_LoadBmodel: funny lump size in %s",loadmodel->name);
-		count = l->filelen / sizeof(dsface_t);
-	}
-	out = (msurface_t *)Hunk_AllocName ( count*sizeof(*out), loadname);
+	in = faces->in + surfnum * (faces->bsp2 ? sizeof(dlface_t) : sizeof(dsface_t));
 
-	//johnfitz -- warn mappers about exceeding old limits
-	if (count > 32767 && !bsp2)
-		Con_DWarning ("%i faces exceeds standard limit of 32767.\n", count);
-	//johnfitz
-
-	loadmodel->surfaces = out;
-	loadmodel->numsurfaces = count;
-
-	for (surfnum=0 ; surfnum<count ; surfnum++, out++)
+	for ( ; surfnum<end ; surfnum++, out++)
 	{
-		if (bsp2)
+		if (faces->bsp2)
 		{
-			out->firstedge = ReadLongUnaligned(inl + offsetof(dlface_t, firstedge));
-			out->numedges = ReadLongUnaligned(inl + offsetof(dlface_t, numedges));
-			planenum = ReadLongUnaligned(inl + offsetof(dlface_t, planenum));
-			side = ReadLongUnaligned(inl + offsetof(dlface_t, side));
-			texinfon = ReadLongUnaligned (inl + offsetof(dlface_t, texinfo));
+			out->firstedge = ReadLongUnaligned(in + offsetof(dlface_t, firstedge));
+			out->numedges = ReadLongUnaligned(in + offsetof(dlface_t, numedges));
+			planenum = ReadLongUnaligned(in + offsetof(dlface_t, planenum));
+			side = ReadLongUnaligned(in + offsetof(dlface_t, side));
+			texinfon = ReadLongUnaligned (in + offsetof(dlface_t, texinfo));
 			for (i=0 ; i<MAXLIGHTMAPS ; i++)
-				out->styles[i] = *(inl + offsetof(dlface_t, styles[i]));
-			lofs = ReadLongUnaligned(inl + offsetof(dlface_t, lightofs));
-			inl += sizeof(dlface_t);
+				out->styles[i] = *(in + offsetof(dlface_t, styles[i]));
+			lofs = ReadLongUnaligned(in + offsetof(dlface_t, lightofs));
+			in += sizeof(dlface_t);
 		}
 		else
 		{
-			out->firstedge = ReadLongUnaligned(ins + offsetof(dsface_t, firstedge));
-			out->numedges = ReadShortUnaligned(ins + offsetof(dsface_t, numedges));
-			planenum = ReadShortUnaligned(ins + offsetof(dsface_t, planenum));
-			side = ReadShortUnaligned(ins + offsetof(dsface_t, side));
-			texinfon = ReadShortUnaligned (ins + offsetof(dsface_t, texinfo));
+			out->firstedge = ReadLongUnaligned(in + offsetof(dsface_t, firstedge));
+			out->numedges = ReadShortUnaligned(in + offsetof(dsface_t, numedges));
+			planenum = ReadShortUnaligned(in + offsetof(dsface_t, planenum));
+			side = ReadShortUnaligned(in + offsetof(dsface_t, side));
+			texinfon = ReadShortUnaligned (in + offsetof(dsface_t, texinfo));
 			for (i=0 ; i<MAXLIGHTMAPS ; i++)
-				out->styles[i] = *(ins + offsetof(dsface_t, styles[i]));
-			lofs = ReadLongUnaligned(ins + offsetof(dsface_t, lightofs));
-			ins += sizeof(dsface_t);
+				out->styles[i] = *(in + offsetof(dsface_t, styles[i]));
+			lofs = ReadLongUnaligned(in + offsetof(dsface_t, lightofs));
+			in += sizeof(dsface_t);
 		}
 
 		out->flags = 0;
@@ -1274,7 +1413,8 @@ void Mod_LoadFaces (lump_t *l, qboolean bsp2)
 
 		out->texinfo = loadmodel->texinfo + texinfon;
 
-		CalcSurfaceExtents (out);
+		if (!CalcSurfaceExtents (out))
+			SDL_AtomicSet (faces->badextents, 1);
 
 	// lighting info
 		if (loadmodel->bspversion == BSPVERSION_QUAKE64)
@@ -1289,7 +1429,6 @@ void Mod_LoadFaces (lump_t *l, qboolean bsp2)
 		if (!q_strncasecmp(out->texinfo->texture->name,"sky",3)) // sky surface //also note -- was Q_strncmp, changed to match qbsp
 		{
 			out->flags |= (SURF_DRAWSKY | SURF_DRAWTILED);
-			Mod_PolyForUnlitSurface (out); //no more subdivision
 		}
 		else if (out->texinfo->texture->name[0] == '*') // warp surface
 		{
@@ -1303,9 +1442,6 @@ void Mod_LoadFaces (lump_t *l, qboolean bsp2)
 			else if (!strncmp (out->texinfo->texture->name, "*tele", 5))
 				out->flags |= SURF_DRAWTELE;
 			else out->flags |= SURF_DRAWWATER;
-
-			Mod_PolyForUnlitSurface (out);
-			GL_SubdivideSurface (out);
 		}
 		else if (out->texinfo->texture->name[0] == '{') // ericw -- fence textures
 		{
@@ -1320,13 +1456,63 @@ void Mod_LoadFaces (lump_t *l, qboolean bsp2)
 			else // not lightmapped
 			{
 				out->flags |= (SURF_NOTEXTURE | SURF_DRAWTILED);
-				Mod_PolyForUnlitSurface (out);
 			}
 		}
 		//johnfitz
 	}
 }
 
+/*
+=================
+Mod_LoadFaces
+=================
+*/
+void Mod_LoadFaces (lump_t *l, qboolean bsp2)
+{
+	faceconvert_t	faces;
+	SDL_atomic_t	badextents;
+	msurface_t 	*out;
+	int			count, surfnum;
+
+	if (l->filelen % (bsp2 ? sizeof(dlface_t) : sizeof(dsface_t)))
+		Sys_Error ("MOD_LoadBmodel: funny lump size in %s",loadmodel->name);
+	count = l->filelen / (bsp2 ? sizeof(dlface_t) : sizeof(dsface_t));
+	out = (msurface_t *)Hunk_AllocName ( count*sizeof(*out), loadname);
+
+	//johnfitz -- warn mappers about exceeding old limits
+	if (count > 32767 && !bsp2)
+		Con_DWarning ("%i faces exceeds standard limit of 32767.\n", count);
+	//johnfitz
+
+	loadmodel->surfaces = out;
+	loadmodel->numsurfaces = count;
+
+	// faces reference the vertexes, edges, surfedges and planes
+	Mod_FinishLumpJobs ();
+
+	SDL_AtomicSet (&badextents, 0);
+	faces.in = mod_base + l->fileofs;
+	faces.out = out;
+	faces.count = count;
+	faces.bsp2 = bsp2;
+	faces.badextents = &badextents;
+	if (count > 0)
+		Jobs_ParallelFor (Mod_ConvertFaces, (count + MOD_LOAD_BATCH - 1) / MOD_LOAD_BATCH, &faces, sizeof(faces));
+
+	if (SDL_AtomicGet (&badextents))
+		Sys_Error ("Bad surface extents");
+
+	// sky, water and untextured unlit surfaces need polys (no more subdivision for sky)
+	for (surfnum=0 ; surfnum<count ; surfnum++, out++)
+	{
+		if (!(out->flags & SURF_DRAWTILED))
+			continue;
+		Mod_PolyForUnlitSurface (out);
+		if (out->flags & SURF_DRAWTURB)
+			GL_SubdivideSurface (out);
+	}
+}
+
 /*
 =================
 Mod_LoadNodes
@@ -2023,6 +2209,24 @@ void Mod_LoadMarksurfaces (lump_t *l, int bsp2)
 	}
 }
 
+/*
+=================
+Mod_ConvertSurfedges
+=================
+*/
+static void Mod_ConvertSurfedges (int index, void *payload)
+{
+	lumpconvert_t	*lump = (lumpconvert_t *) payload;
+	int				i = index * MOD_LOAD_BATCH;
+	int				end = q_min (i + MOD_LOAD_BATCH, lump->count);
+	int				*out = (int *) lump->out;
+
+	for ( ; i<end ; i++)
+	{
+		out[i] = ReadLongUnaligned(lump->in + (i * sizeof(int)));
+	}
+}
+
 /*
 =================
 Mod_LoadSurfedges
@@ -2030,7 +2234,7 @@ Mod_LoadSurfedges
 */
 void Mod_LoadSurfedges (lump_t *l)
 {
-	int		i, count;
+	int		count;
 	byte	*in;
 	int		*out;
 
@@ -2043,13 +2247,40 @@ void Mod_LoadSurfedges (lump_t *l)
 	loadmodel->surfedges = out;
 	loadmodel->numsurfedges = count;
 
-	for (i=0 ; i<count ; i++)
+	Mod_QueueLumpJob (Mod_ConvertSurfedges, in, out, count, false);
+}
+
+
+/*
+=================
+Mod_ConvertPlanes
+=================
+*/
+static void Mod_ConvertPlanes (int index, void *payload)
+{
+	lumpconvert_t	*lump = (lumpconvert_t *) payload;
+	int				i = index * MOD_LOAD_BATCH;
+	int				end = q_min (i + MOD_LOAD_BATCH, lump->count);
+	byte			*in = lump->in + i * sizeof(dplane_t);
+	mplane_t		*out = (mplane_t *) lump->out + i;
+	int				j, bits;
+
+	for ( ; i<end ; i++, in += sizeof(dplane_t), out++)
 	{
-		out[i] = ReadLongUnaligned(in + (i * sizeof(int)));
+		bits = 0;
+		for (j=0 ; j<3 ; j++)
+		{
+			out->normal[j] = ReadFloatUnaligned (in + offsetof(dplane_t, normal[j]));
+			if (out->normal[j] < 0)
+				bits |= 1<<j;
+		}
+
+		out->dist = ReadFloatUnaligned (in + offsetof(dplane_t, dist));
+		out->type = ReadLongUnaligned (in + offsetof(dplane_t, type));
+		out->signbits = bits;
 	}
 }
 
-
 /*
 =================
 Mod_LoadPlanes
@@ -2057,11 +2288,9 @@ Mod_LoadPlanes
 */
 void Mod_LoadPlanes (lump_t *l)
 {
-	int			i, j;
 	mplane_t	*out;
 	byte 		*in;
 	int			count;
-	int			bits;
 
 	in = mod_base + l->fileofs;
 	if (l->filelen % sizeof(dplane_t))
@@ -2072,20 +2301,7 @@ void Mod_LoadPlanes (lump_t *l)
 	loadmodel->planes = out;
 	loadmodel->numplanes = count;
 
-	for (i=0 ; i<count ; i++, in += sizeof(dplane_t), out++)
-	{
-		bits = 0;
-		for (j=0 ; j<3 ; j++)
-		{
-			out->normal[j] = ReadFloatUnaligned (in + offsetof(dplane_t, normal[j]));
-			if (out->normal[j] < 0)
-				bits |= 1<<j;
-		}
-
-		out->dist = ReadFloatUnaligned (in + offsetof(dplane_t, dist));
-		out->type = ReadLongUnaligned (in + offsetof(dplane_t, type));
-		out->signbits = bits;
-	}
+	Mod_QueueLumpJob (Mod_ConvertPlanes, in, out, count, false);
 }
 
 /*
@@ -2380,11 +2596,12 @@ static void Mod_LoadBrushModel (qmodel_t *mod, void *buffer)
 {
 	int			i;
 	int			bsp2;
-	dheader_t	*header;
+	dheader_t	header_swapped;	// the buffer is read only
+	dheader_t	*header = &header_swapped;
 
 	loadmodel->type = mod_brush;
 
-	header = (dheader_t *)buffer;
+	memcpy (header, buffer, sizeof(dheader_t));
 
 	mod->bspversion = LittleLong (header->version);
 
@@ -2408,7 +2625,10 @@ static void Mod_LoadBrushModel (qmodel_t *mod, void *buffer)
 	}
 
 // swap all the lumps
-	mod_base = (byte *)header;
+	mod_base = (byte *)buffer;
+	mod->checksum = 0;
+	if (!isDedicated && r_rendercache.value)	// only the render cache needs it
+		mod->checksum = Com_BlockChecksum (buffer, com_filesize);
 
 	for (i = 0; i < (int) sizeof(dheader_t) / 4; i++)
 		((int *)header)[i] = LittleLong ( ((int *)header)[i]);
@@ -169,6 +169,8 @@ typedef struct msurface_s
 	byte		styles[MAXLIGHTMAPS];
 	int			cached_light[MAXLIGHTMAPS];	// values currently used in lightmap
 	qboolean	cached_dlight;				// true if dynamic light in cache
+	unsigned int	cached_dlighthash;		// R_DlightHash of the dlights in cache
+	unsigned int	*stylecache;			// [surfsize*3] sum of the styles at cached_light, RGB32
 	byte		*samples;		// [numstyles*surfsize]
 } msurface_t;
 
@@ -487,6 +489,7 @@ typedef struct qmodel_s
 	qboolean	viswarn; // for Mod_DecompressVis()
 
 	int			bspversion;
+	unsigned int	checksum;	// of the bsp and its .lit, keys the render cache, 0 if r_rendercache was off
 	int			contentstransparent;	//spike -- added this so we can disable glitchy wateralpha where its not supported.
 
 //
@@ -515,6 +518,7 @@ void	Mod_Init (void);
 void	Mod_ClearAll (void);
 void	Mod_ResetAll (void); // for gamedir changes (Host_Game_f)
 qmodel_t *Mod_ForName (const char *name, qboolean crash);
+qmodel_t *Mod_FindName (const char *name);
 void	*Mod_Extradata (qmodel_t *mod);	// handles caching
 void	Mod_TouchModel (const char *name);
 
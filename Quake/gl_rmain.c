@@ -38,8 +38,10 @@ qboolean	render_warp;
 int			render_scale;
 
 //johnfitz -- rendering statistics
-unsigned int rs_brushpolys, rs_aliaspolys, rs_skypolys, rs_particles, rs_fogpolys;
-unsigned int rs_dynamiclightmaps, rs_brushpasses, rs_aliaspasses, rs_skypasses;
+//per thread, scene stages recorded by jobs are added to the main thread's counters
+THREAD_LOCAL unsigned int rs_brushpolys, rs_aliaspolys, rs_skypolys, rs_particles, rs_fogpolys;
+THREAD_LOCAL unsigned int rs_dynamiclightmaps, rs_brushpasses, rs_aliaspasses, rs_skypasses, rs_lightmapsurfs;
+unsigned int rs_lightmapbytes, rs_lightmapregions;
 float rs_megatexels;
 
 //
@@ -66,6 +68,8 @@ cvar_t	r_drawentities = {"r_drawentities","1",CVAR_NONE};
 cvar_t	r_drawviewmodel = {"r_drawviewmodel","1",CVAR_NONE};
 cvar_t	r_speeds = {"r_speeds","0",CVAR_NONE};
 cvar_t	r_pos = {"r_pos","0",CVAR_NONE};
+cvar_t	r_showlightmapuploads = {"r_showlightmapuploads","0",CVAR_NONE};
+cvar_t	r_rendercache = {"r_rendercache","1",CVAR_ARCHIVE};
 cvar_t	r_fullbright = {"r_fullbright","0",CVAR_NONE};
 cvar_t	r_lightmap = {"r_lightmap","0",CVAR_NONE};
 cvar_t	r_wateralpha = {"r_wateralpha","1",CVAR_ARCHIVE};
@@ -108,6 +112,8 @@ qboolean r_drawworld_cheatsafe, r_fullbright_cheatsafe, r_lightmap_cheatsafe; //
 
 cvar_t	r_scale = {"r_scale", "1", CVAR_ARCHIVE};
 
+cvar_t	r_parallel_recording = {"r_parallel_recording", "0", CVAR_ARCHIVE};
+
 
 float	gl_farclip = 16384.0f;
 
@@ -299,7 +305,7 @@ void R_SetupScene (void)
 {
 	render_pass_index = 0;
 	qboolean screen_effects = render_warp || (render_scale >= 2);
-	vkCmdBeginRenderPass(vulkan_globals.command_buffer, &vulkan_globals.main_render_pass_begin_infos[screen_effects ? 1 : 0], VK_SUBPASS_CONTENTS_INLINE);
+	vkCmdBeginRenderPass(vulkan_recording.command_buffer, &vulkan_globals.main_render_pass_begin_infos[screen_effects ? 1 : 0], VK_SUBPASS_CONTENTS_INLINE);
 
 	R_SetupMatrix ();
 }
@@ -504,8 +510,8 @@ void R_EmitWirePoint (vec3_t origin)
 	vertices[5].position[1] = origin[1];
 	vertices[5].position[2] = origin[2]+size;
 
-	vulkan_globals.vk_cmd_bind_vertex_buffers(vulkan_globals.command_buffer, 0, 1, &vertex_buffer, &vertex_buffer_offset);
-	vulkan_globals.vk_cmd_draw(vulkan_globals.command_buffer, 6, 1, 0, 0);
+	vulkan_globals.vk_cmd_bind_vertex_buffers(vulkan_recording.command_buffer, 0, 1, &vertex_buffer, &vertex_buffer_offset);
+	vulkan_globals.vk_cmd_draw(vulkan_recording.command_buffer, 6, 1, 0, 0);
 }
 
 /*
@@ -526,9 +532,9 @@ void R_EmitWireBox (vec3_t mins, vec3_t maxs, VkBuffer box_index_buffer, VkDevic
 		vertices[i].position[2] = ((i % 8) < 4) ? mins[2] : maxs[2];
 	}
 
-	vulkan_globals.vk_cmd_bind_index_buffer(vulkan_globals.command_buffer, box_index_buffer, box_index_buffer_offset, VK_INDEX_TYPE_UINT16);
-	vulkan_globals.vk_cmd_bind_vertex_buffers(vulkan_globals.command_buffer, 0, 1, &vertex_buffer, &vertex_buffer_offset);
-	vulkan_globals.vk_cmd_draw_indexed(vulkan_globals.command_buffer, 24, 1, 0, 0, 0);
+	vulkan_globals.vk_cmd_bind_index_buffer(vulkan_recording.command_buffer, box_index_buffer, box_index_buffer_offset, VK_INDEX_TYPE_UINT16);
+	vulkan_globals.vk_cmd_bind_vertex_buffers(vulkan_recording.command_buffer, 0, 1, &vertex_buffer, &vertex_buffer_offset);
+	vulkan_globals.vk_cmd_draw_indexed(vulkan_recording.command_buffer, 24, 1, 0, 0, 0);
 }
 
 static uint16_t box_indices[24] =
@@ -655,6 +661,246 @@ void R_ShowTris(void)
 	R_EndDebugUtilsLabel ();
 }
 
+/*
+=============================================================================
+
+SCENE STAGES
+
+With r_parallel_recording the scene is recorded into one secondary command
+buffer per stage. The world, sky, water and particle stages are recorded by
+jobs while the main thread records the entity stages: alias model lighting,
+model cache loads and the lightmap updates of brush entities are not thread
+safe.
+
+=============================================================================
+*/
+
+typedef struct
+{
+	unsigned int	brushpolys, aliaspolys, skypolys, particles, fogpolys;
+	unsigned int	dynamiclightmaps, brushpasses, aliaspasses, skypasses, lightmapsurfs;
+} speedcounters_t;
+
+typedef struct
+{
+	void			(*draw) (void);
+	qboolean		fog;
+	qboolean		job;
+} scenestagedef_t;
+
+typedef struct
+{
+	vulkan_recording_t	recording;
+	speedcounters_t		counters;
+} scenestage_t;
+
+static void R_DrawOpaqueEntities (void)
+{
+	R_DrawEntitiesOnList (false);
+}
+
+static void R_DrawAlphaEntities (void)
+{
+	R_DrawEntitiesOnList (true);
+}
+
+static void R_DrawAllParticles (void)
+{
+	R_DrawParticles ();
+#ifdef PSET_SCRIPT
+	PScript_DrawParticles ();
+#endif
+}
+
+static void R_DrawDebugOverlays (void)
+{
+	R_ShowTris ();
+	R_ShowBoundingBoxes ();
+}
+
+static const scenestagedef_t scene_stage_defs[SCENE_STAGE_COUNT] =
+{
+	{ R_DrawWorld,				true,	true },		// SCENE_STAGE_WORLD
+	{ R_DrawOpaqueEntities,		true,	false },	// SCENE_STAGE_ENTITIES
+	{ Sky_DrawSky,				true,	true },		// SCENE_STAGE_SKY
+	{ R_DrawWorld_Water,		true,	true },		// SCENE_STAGE_WATER
+	{ R_DrawAlphaEntities,		true,	false },	// SCENE_STAGE_ALPHA_ENTITIES
+	{ R_DrawAllParticles,		true,	true },		// SCENE_STAGE_PARTICLES
+	{ R_DrawViewModel,			false,	false },	// SCENE_STAGE_VIEWMODEL
+	{ R_DrawDebugOverlays,		false,	false },	// SCENE_STAGE_POST
+};
+
+static scenestage_t			scene_stages[SCENE_STAGE_COUNT];
+static vulkan_recording_t	scene_primary_recording;
+static qboolean				scene_stages_recording;
+
+/*
+================
+R_SwapSpeedCounters
+================
+*/
+static void R_SwapSpeedCounters (speedcounters_t *counters)
+{
+#define SWAP_COUNTER(x) { unsigned int temp = rs_##x; rs_##x = counters->x; counters->x = temp; }
+	SWAP_COUNTER (brushpolys);
+	SWAP_COUNTER (aliaspolys);
+	SWAP_COUNTER (skypolys);
+	SWAP_COUNTER (particles);
+	SWAP_COUNTER (fogpolys);
+	SWAP_COUNTER (dynamiclightmaps);
+	SWAP_COUNTER (brushpasses);
+	SWAP_COUNTER (aliaspasses);
+	SWAP_COUNTER (skypasses);
+	SWAP_COUNTER (lightmapsurfs);
+#undef SWAP_COUNTER
+}
+
+/*
+================
+R_AddSpeedCounters
+================
+*/
+static void R_AddSpeedCounters (const speedcounters_t *counters)
+{
+	rs_brushpolys += counters->brushpolys;
+	rs_aliaspolys += counters->aliaspolys;
+	rs_skypolys += counters->skypolys;
+	rs_particles += counters->particles;
+	rs_fogpolys += counters->fogpolys;
+	rs_dynamiclightmaps += counters->dynamiclightmaps;
+	rs_brushpasses += counters->brushpasses;
+	rs_aliaspasses += counters->aliaspasses;
+	rs_skypasses += counters->skypasses;
+	rs_lightmapsurfs += counters->lightmapsurfs;
+}
+
+/*
+================
+R_BeginSceneStage
+
+Runs on the main thread for every stage, secondary command buffers don't
+inherit the viewport, the matrices or the fog
+================
+*/
+static void R_BeginSceneStage (int stage, VkFramebuffer framebuffer)
+{
+	vulkan_recording.command_buffer = GL_BeginSecondaryCommandBuffer (stage, framebuffer);
+	memset (&vulkan_recording.current_pipeline, 0, sizeof (vulkan_recording.current_pipeline));
+
+	R_SetupMatrix ();
+	if (scene_stage_defs[stage].fog)
+		Fog_EnableGFog ();
+
+	scene_stages[stage].recording = vulkan_recording;
+	memset (&scene_stages[stage].counters, 0, sizeof (scene_stages[stage].counters));
+}
+
+/*
+================
+R_RecordSceneStage
+================
+*/
+static void R_RecordSceneStage (void *payload)
+{
+	scenestage_t *stage = &scene_stages[*(int *)payload];
+
+	// Job_Join may run this on the main thread, don't lose its state
+	vulkan_recording_t saved_recording = vulkan_recording;
+	vulkan_recording = stage->recording;
+
+	R_SwapSpeedCounters (&stage->counters);
+	scene_stage_defs[*(int *)payload].draw ();
+	R_SwapSpeedCounters (&stage->counters);
+
+	GL_EndSecondaryCommandBuffer (vulkan_recording.command_buffer);
+	vulkan_recording = saved_recording;
+}
+
+/*
+================
+R_RenderSceneStages
+
+Leaves SCENE_STAGE_POST open for V_PolyBlend, R_ExecuteSceneStages finishes it
+================
+*/
+static void R_RenderSceneStages (void)
+{
+	int i;
+
+	render_pass_index = 0;
+	qboolean screen_effects = render_warp || (render_scale >= 2);
+	const VkRenderPassBeginInfo *render_pass_begin_info = &vulkan_globals.main_render_pass_begin_infos[screen_effects ? 1 : 0];
+	vkCmdBeginRenderPass(vulkan_recording.command_buffer, render_pass_begin_info, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+	scene_primary_recording = vulkan_recording;
+
+	for (i = 0; i < SCENE_STAGE_COUNT; i++)
+		R_BeginSceneStage (i, render_pass_begin_info->framebuffer);
+
+#ifdef PSET_SCRIPT
+	PScript_UpdateLooks ();
+#endif
+
+	job_handle_t fence = Job_Allocate ();
+	for (i = 0; i < SCENE_STAGE_COUNT; i++)
+	{
+		if (!scene_stage_defs[i].job)
+			continue;
+
+		job_handle_t job = Job_Allocate ();
+		Job_AssignFunc (job, R_RecordSceneStage, &i, sizeof (i));
+		Job_AddDependency (job, fence);
+		Job_Submit (job);
+	}
+	Job_Submit (fence);
+
+	for (i = 0; i < SCENE_STAGE_POST; i++)
+	{
+		if (scene_stage_defs[i].job)
+			continue;
+
+		vulkan_recording = scene_stages[i].recording;
+		scene_stage_defs[i].draw ();
+		GL_EndSecondaryCommandBuffer (vulkan_recording.command_buffer);
+	}
+	vulkan_recording = scene_primary_recording;
+
+	S_ExtraUpdate (); // don't let sound get messed up if going slow
+
+	// world lightmaps are not uploaded by the jobs
+	R_UploadLightmaps ();
+
+	Job_Join (fence);
+
+	for (i = 0; i < SCENE_STAGE_COUNT; i++)
+		R_AddSpeedCounters (&scene_stages[i].counters);
+
+	vulkan_recording = scene_stages[SCENE_STAGE_POST].recording;
+	scene_stage_defs[SCENE_STAGE_POST].draw ();
+	scene_stages_recording = true;
+}
+
+/*
+================
+R_ExecuteSceneStages
+
+Ends the scene stages and executes them in the primary command buffer.
+Returns false if the scene wasn't recorded in stages.
+================
+*/
+qboolean R_ExecuteSceneStages (void)
+{
+	if (!scene_stages_recording)
+		return false;
+
+	GL_EndSecondaryCommandBuffer (vulkan_recording.command_buffer);
+	vulkan_recording = scene_primary_recording;
+	memset (&vulkan_recording.current_pipeline, 0, sizeof (vulkan_recording.current_pipeline));
+	GL_ExecuteSecondaryCommandBuffers ();
+	scene_stages_recording = false;
+
+	return true;
+}
+
 /*
 ================
 R_RenderScene
@@ -664,6 +910,13 @@ void R_RenderScene (void)
 {
 	static entity_t r_worldentity;	//so we can make sure currententity is valid
 	currententity = &r_worldentity;
+
+	if (r_parallel_recording.value)
+	{
+		R_RenderSceneStages ();
+		return;
+	}
+
 	R_SetupScene (); //johnfitz -- this does everything that should be done once per call to RenderScene
 
 	Fog_EnableGFog (); //johnfitz
@@ -742,13 +995,14 @@ void R_RenderView (void)
 	gl_farclip = R_GetFarClip ();
 
 	time1 = 0; /* avoid compiler warning */
+	rs_lightmapbytes = rs_lightmapregions = 0;
 	if (r_speeds.value)
 	{
 		time1 = Sys_DoubleTime ();
 
 		//johnfitz -- rendering statistics
 		rs_brushpolys = rs_aliaspolys = rs_skypolys = rs_particles = rs_fogpolys = rs_megatexels =
-		rs_dynamiclightmaps = rs_aliaspasses = rs_skypasses = rs_brushpasses = 0;
+		rs_dynamiclightmaps = rs_aliaspasses = rs_skypasses = rs_brushpasses = rs_lightmapsurfs = 0;
 	}
 
 	R_SetupView (); //johnfitz -- this does everything that should be done once per frame
@@ -768,15 +1022,18 @@ void R_RenderView (void)
 			(int)cl.viewangles[YAW],
 			(int)cl.viewangles[ROLL]);
 	else if (r_speeds.value == 2)
-		Con_Printf ("%6.3f ms  %4u/%4u wpoly %4u/%4u epoly %3u lmap %4u/%4u sky\n",
+		Con_Printf ("%6.3f ms  %4u/%4u wpoly %4u/%4u epoly %3u/%4u lmap %4u/%4u sky %4i/%4i KB frame\n",
 					(time2-time1)*1000.0,
 					rs_brushpolys,
 					rs_brushpasses,
 					rs_aliaspolys,
 					rs_aliaspasses,
 					rs_dynamiclightmaps,
+					rs_lightmapsurfs,
 					rs_skypolys,
-					rs_skypasses);
+					rs_skypasses,
+					Frame_Used () / 1024,
+					Frame_Peak () / 1024);
 	else if (r_speeds.value)
 		Con_Printf ("%3i ms  %4i wpoly %4i epoly %3i lmap\n",
 					(int)((time2-time1)*1000),
@@ -784,5 +1041,8 @@ void R_RenderView (void)
 					rs_aliaspolys,
 					rs_dynamiclightmaps);
 	//johnfitz
+
+	if (r_showlightmapuploads.value && rs_lightmapregions)
+		Con_Printf ("%6u bytes in %3u lightmap regions\n", rs_lightmapbytes, rs_lightmapregions);
 }
 
@@ -49,6 +49,7 @@ extern cvar_t r_showbboxes;
 extern cvar_t r_lerpmodels;
 extern cvar_t r_lerpmove;
 extern cvar_t r_nolerp_list;
+extern cvar_t r_parallel_recording;
 //johnfitz
 extern cvar_t gl_zfix; // QuakeSpasm z-fighting fix
 
@@ -58,6 +59,7 @@ extern cvar_t r_simd;
 extern gltexture_t *playertextures[MAX_SCOREBOARD]; //johnfitz
 
 vulkanglobals_t vulkan_globals;
+THREAD_LOCAL vulkan_recording_t vulkan_recording;
 
 int num_vulkan_tex_allocations = 0;
 int num_vulkan_bmodel_allocations = 0;
@@ -110,7 +112,6 @@ Dynamic vertex/index & uniform buffer
 typedef struct
 {
 	VkBuffer			buffer;
-	uint32_t			current_offset;
 	unsigned char *		data;
 } dynbuffer_t;
 
@@ -126,6 +127,79 @@ static dynbuffer_t		dyn_uniform_buffers[NUM_DYNAMIC_BUFFERS];
 static int				current_dyn_buffer_index = 0;
 static VkDescriptorSet	ubo_descriptor_sets[2];
 
+/*
+================
+Dynamic buffer chunks
+
+Every thread sub-allocates from its own chunk of the current dynamic buffers
+without locking. Chunks are carved with an atomic add on the ring offset, only
+growing the buffers takes a lock. The bytes used by each frame are tracked so
+the buffers can be grown between frames instead of in the middle of one.
+================
+*/
+#define DYNAMIC_VERTEX_CHUNK_SIZE_KB			32
+#define DYNAMIC_INDEX_CHUNK_SIZE_KB				32
+#define DYNAMIC_UNIFORM_CHUNK_SIZE_KB			8
+
+enum { DYN_BUFFER_VERTEX, DYN_BUFFER_INDEX, DYN_BUFFER_UNIFORM, NUM_DYN_BUFFER_TYPES };
+
+typedef struct
+{
+	VkBuffer			buffer;
+	unsigned char *		data;
+	VkDescriptorSet		descriptor_set;
+	uint32_t			current_offset;
+	uint32_t			end_offset;
+	int					frame;
+} dynchunk_t;
+
+static const uint32_t	dyn_chunk_sizes[NUM_DYN_BUFFER_TYPES] = { DYNAMIC_VERTEX_CHUNK_SIZE_KB * 1024, DYNAMIC_INDEX_CHUNK_SIZE_KB * 1024, DYNAMIC_UNIFORM_CHUNK_SIZE_KB * 1024 };
+static dynchunk_t		dyn_chunks[MAX_JOB_THREADS][NUM_DYN_BUFFER_TYPES];
+static int				dyn_frame = 1;		// chunks carved in older frames are stale
+static SDL_atomic_t		dyn_ring_offsets[NUM_DYN_BUFFER_TYPES];
+static SDL_atomic_t		dyn_frame_usage[NUM_DYN_BUFFER_TYPES];
+static uint32_t			dyn_high_water[NUM_DYN_BUFFER_TYPES];
+static SDL_atomic_t		dyn_generation;		// odd while the buffers are being grown
+static SDL_SpinLock		dyn_grow_lock;
+
+static void R_GrowDynamicBuffer(int type, uint32_t size);
+
+/*
+===============
+R_DynamicBufferSize
+===============
+*/
+static uint32_t R_DynamicBufferSize(int type)
+{
+	switch (type)
+	{
+	case DYN_BUFFER_VERTEX:
+		return current_dyn_vertex_buffer_size;
+	case DYN_BUFFER_INDEX:
+		return current_dyn_index_buffer_size;
+	default:
+		return current_dyn_uniform_buffer_size;
+	}
+}
+
+/*
+===============
+R_DynamicBuffer
+===============
+*/
+static dynbuffer_t * R_DynamicBuffer(int type)
+{
+	switch (type)
+	{
+	case DYN_BUFFER_VERTEX:
+		return &dyn_vertex_buffers[current_dyn_buffer_index];
+	case DYN_BUFFER_INDEX:
+		return &dyn_index_buffers[current_dyn_buffer_index];
+	default:
+		return &dyn_uniform_buffers[current_dyn_buffer_index];
+	}
+}
+
 static int					current_garbage_index = 0;
 static int					num_device_memory_garbage[GARBAGE_FRAME_COUNT];
 static int					num_buffer_garbage[GARBAGE_FRAME_COUNT];
@@ -601,12 +675,11 @@ static void R_InitDynamicVertexBuffers()
 	memset(&buffer_create_info, 0, sizeof(buffer_create_info));
 	buffer_create_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
 	buffer_create_info.size = current_dyn_vertex_buffer_size;
+	SDL_AtomicSet(&dyn_ring_offsets[DYN_BUFFER_VERTEX], 0);
 	buffer_create_info.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
 
 	for (i = 0; i < NUM_DYNAMIC_BUFFERS; ++i)
 	{
-		dyn_vertex_buffers[i].current_offset = 0;
-
 		err = vkCreateBuffer(vulkan_globals.device, &buffer_create_info, NULL, &dyn_vertex_buffers[i].buffer);
 		if (err != VK_SUCCESS)
 			Sys_Error("vkCreateBuffer failed");
@@ -665,12 +738,11 @@ static void R_InitDynamicIndexBuffers()
 	memset(&buffer_create_info, 0, sizeof(buffer_create_info));
 	buffer_create_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
 	buffer_create_info.size = current_dyn_index_buffer_size;
+	SDL_AtomicSet(&dyn_ring_offsets[DYN_BUFFER_INDEX], 0);
 	buffer_create_info.usage = VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
 
 	for (i = 0; i < NUM_DYNAMIC_BUFFERS; ++i)
 	{
-		dyn_index_buffers[i].current_offset = 0;
-
 		err = vkCreateBuffer(vulkan_globals.device, &buffer_create_info, NULL, &dyn_index_buffers[i].buffer);
 		if (err != VK_SUCCESS)
 			Sys_Error("vkCreateBuffer failed");
@@ -729,12 +801,11 @@ static void R_InitDynamicUniformBuffers()
 	memset(&buffer_create_info, 0, sizeof(buffer_create_info));
 	buffer_create_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
 	buffer_create_info.size = current_dyn_uniform_buffer_size;
+	SDL_AtomicSet(&dyn_ring_offsets[DYN_BUFFER_UNIFORM], 0);
 	buffer_create_info.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
 
 	for (i = 0; i < NUM_DYNAMIC_BUFFERS; ++i)
 	{
-		dyn_uniform_buffers[i].current_offset = 0;
-
 		err = vkCreateBuffer(vulkan_globals.device, &buffer_create_info, NULL, &dyn_uniform_buffers[i].buffer);
 		if (err != VK_SUCCESS)
 			Sys_Error("vkCreateBuffer failed");
@@ -880,11 +951,20 @@ R_SwapDynamicBuffers
 void R_SwapDynamicBuffers()
 {
 	current_dyn_buffer_index = (current_dyn_buffer_index + 1) % NUM_DYNAMIC_BUFFERS;
-	dyn_vertex_buffers[current_dyn_buffer_index].current_offset = 0;
-	dyn_index_buffers[current_dyn_buffer_index].current_offset = 0;
-	dyn_uniform_buffers[current_dyn_buffer_index].current_offset = 0;
-}
+	++dyn_frame;
 
+	for (int i = 0; i < NUM_DYN_BUFFER_TYPES; ++i)
+	{
+		SDL_AtomicSet(&dyn_ring_offsets[i], 0);
+
+		// grow now if the last frame came close to the size, not in the middle of the next one
+		const uint32_t used = (uint32_t)SDL_AtomicSet(&dyn_frame_usage[i], 0);
+		const uint32_t reserve = used + (used / 4) + ((i == DYN_BUFFER_UNIFORM) ? MAX_UNIFORM_ALLOC : 0);
+		dyn_high_water[i] = q_max(dyn_high_water[i], used);
+		if (reserve > R_DynamicBufferSize(i))
+			R_GrowDynamicBuffer(i, reserve);
+	}
+}
 /*
 ===============
 R_FlushDynamicBuffers
@@ -904,6 +984,13 @@ void R_FlushDynamicBuffers()
     ranges[2].memory = dyn_uniform_buffer_memory.handle;
     ranges[2].size = VK_WHOLE_SIZE;
 	vkFlushMappedMemoryRanges(vulkan_globals.device, 3, ranges);
+
+	// buffers that were outgrown this frame stay mapped until they are collected
+	for (int i = 0; i < num_device_memory_garbage[current_garbage_index]; ++i)
+	{
+		ranges[0].memory = device_memory_garbage[current_garbage_index][i].handle;
+		vkFlushMappedMemoryRanges(vulkan_globals.device, 1, ranges);
+	}
 }
 
 /*
@@ -987,27 +1074,154 @@ void R_CollectDynamicBufferGarbage()
 
 /*
 ===============
-R_VertexAllocate
+R_GrowDynamicVertexBuffers
+
+The old buffers are not unmapped here: other threads may still be writing to
+chunks of them. vkFreeMemory unmaps them once they are collected.
 ===============
 */
-byte * R_VertexAllocate(int size, VkBuffer * buffer, VkDeviceSize * buffer_offset)
+static void R_GrowDynamicVertexBuffers(uint32_t size)
+{
+	R_AddDynamicBufferGarbage(dyn_vertex_buffer_memory, dyn_vertex_buffers, NULL);
+	current_dyn_vertex_buffer_size = q_max(current_dyn_vertex_buffer_size * 2, (uint32_t)Q_nextPow2(size));
+	R_InitDynamicVertexBuffers();
+}
+
+/*
+===============
+R_GrowDynamicIndexBuffers
+===============
+*/
+static void R_GrowDynamicIndexBuffers(uint32_t size)
+{
+	R_AddDynamicBufferGarbage(dyn_index_buffer_memory, dyn_index_buffers, NULL);
+	current_dyn_index_buffer_size = q_max(current_dyn_index_buffer_size * 2, (uint32_t)Q_nextPow2(size));
+	R_InitDynamicIndexBuffers();
+}
+
+/*
+===============
+R_GrowDynamicUniformBuffers
+===============
+*/
+static void R_GrowDynamicUniformBuffers(uint32_t size)
 {
-	dynbuffer_t *dyn_vb = &dyn_vertex_buffers[current_dyn_buffer_index];
+	R_AddDynamicBufferGarbage(dyn_uniform_buffer_memory, dyn_uniform_buffers, ubo_descriptor_sets);
+	current_dyn_uniform_buffer_size = q_max(current_dyn_uniform_buffer_size * 2, (uint32_t)Q_nextPow2(size));
+	R_InitDynamicUniformBuffers();
+}
 
-	if ((dyn_vb->current_offset + size) > current_dyn_vertex_buffer_size)
+/*
+===============
+R_GrowDynamicBuffer
+===============
+*/
+static void R_GrowDynamicBuffer(int type, uint32_t size)
+{
+	switch (type)
 	{
-		R_AddDynamicBufferGarbage(dyn_vertex_buffer_memory, dyn_vertex_buffers, NULL);
-		current_dyn_vertex_buffer_size = q_max(current_dyn_vertex_buffer_size * 2, (uint32_t)Q_nextPow2(size));
-		vkUnmapMemory(vulkan_globals.device, dyn_vertex_buffer_memory.handle);
-		R_InitDynamicVertexBuffers();
+	case DYN_BUFFER_VERTEX:
+		R_GrowDynamicVertexBuffers(size);
+		break;
+	case DYN_BUFFER_INDEX:
+		R_GrowDynamicIndexBuffers(size);
+		break;
+	default:
+		R_GrowDynamicUniformBuffers(size);
+		break;
 	}
+}
+
+/*
+===============
+R_CarveDynamicChunk
+
+Takes a new chunk of at least size bytes off the current dynamic buffer of the
+given type. Reading the buffers is guarded by dyn_generation like a seqlock:
+if they were grown in the meantime, the chunk is carved again.
+===============
+*/
+static void R_CarveDynamicChunk(dynchunk_t * chunk, int type, uint32_t size)
+{
+	// every uniform allocation needs MAX_UNIFORM_ALLOC bytes of descriptor range behind it
+	const uint32_t tail = (type == DYN_BUFFER_UNIFORM) ? MAX_UNIFORM_ALLOC : 0;
+	const uint32_t chunk_size = q_max(dyn_chunk_sizes[type], size);
+
+	for (;;)
+	{
+		const int generation = SDL_AtomicGet(&dyn_generation);
+		if (generation & 1)
+		{
+			// wait for the growing thread
+			SDL_AtomicLock(&dyn_grow_lock);
+			SDL_AtomicUnlock(&dyn_grow_lock);
+			continue;
+		}
+
+		const uint32_t offset = (uint32_t)SDL_AtomicAdd(&dyn_ring_offsets[type], chunk_size);
+		if ((offset + chunk_size + tail) <= R_DynamicBufferSize(type))
+		{
+			dynbuffer_t *dyn_buffer = R_DynamicBuffer(type);
+			chunk->buffer = dyn_buffer->buffer;
+			chunk->data = dyn_buffer->data;
+			chunk->descriptor_set = (type == DYN_BUFFER_UNIFORM) ? ubo_descriptor_sets[current_dyn_buffer_index] : VK_NULL_HANDLE;
+			if (SDL_AtomicGet(&dyn_generation) != generation)
+				continue;
+
+			chunk->current_offset = offset;
+			chunk->end_offset = offset + chunk_size;
+			chunk->frame = dyn_frame;
+			SDL_AtomicAdd(&dyn_frame_usage[type], chunk_size);
+			return;
+		}
+
+		SDL_AtomicLock(&dyn_grow_lock);
+		if (SDL_AtomicGet(&dyn_generation) == generation)
+		{
+			// nobody else grew the buffers since we looked at them
+			SDL_AtomicIncRef(&dyn_generation);
+			R_GrowDynamicBuffer(type, chunk_size + tail);
+			SDL_AtomicIncRef(&dyn_generation);
+		}
+		SDL_AtomicUnlock(&dyn_grow_lock);
+	}
+}
+
+/*
+===============
+R_DynamicAllocate
+===============
+*/
+static byte * R_DynamicAllocate(int type, uint32_t size, VkBuffer * buffer, uint32_t * buffer_offset, VkDescriptorSet * descriptor_set)
+{
+	dynchunk_t *chunk = &dyn_chunks[Jobs_ThreadIndex()][type];
+
+	if ((chunk->frame != dyn_frame) || ((chunk->current_offset + size) > chunk->end_offset))
+		R_CarveDynamicChunk(chunk, type, size);
 
-	*buffer = dyn_vb->buffer;
-	*buffer_offset = dyn_vb->current_offset;
+	*buffer = chunk->buffer;
+	*buffer_offset = chunk->current_offset;
+	if (descriptor_set)
+		*descriptor_set = chunk->descriptor_set;
+
+	unsigned char *data = chunk->data + chunk->current_offset;
+	chunk->current_offset += size;
+
+	return data;
+}
 
-	unsigned char *data = dyn_vb->data + dyn_vb->current_offset;
-	dyn_vb->current_offset += size;
+/*
+===============
+R_VertexAllocate
 
+R_VertexAllocate, R_IndexAllocate and R_UniformAllocate may be called from any job thread
+===============
+*/
+byte * R_VertexAllocate(int size, VkBuffer * buffer, VkDeviceSize * buffer_offset)
+{
+	uint32_t chunk_offset;
+	byte * data = R_DynamicAllocate(DYN_BUFFER_VERTEX, size, buffer, &chunk_offset, NULL);
+	*buffer_offset = chunk_offset;
 	return data;
 }
 
@@ -1023,22 +1237,9 @@ byte * R_IndexAllocate(int size, VkBuffer * buffer, VkDeviceSize * buffer_offset
 	const int align_mod = size % 4;
 	const int aligned_size = ((size % 4) == 0) ? size : (size + 4 - align_mod);
 
-	dynbuffer_t *dyn_ib = &dyn_index_buffers[current_dyn_buffer_index];
-
-	if ((dyn_ib->current_offset + aligned_size) > current_dyn_index_buffer_size)
-	{
-		R_AddDynamicBufferGarbage(dyn_index_buffer_memory, dyn_index_buffers, NULL);
-		current_dyn_index_buffer_size = q_max(current_dyn_index_buffer_size * 2, (uint32_t)Q_nextPow2(size));
-		vkUnmapMemory(vulkan_globals.device, dyn_index_buffer_memory.handle);
-		R_InitDynamicIndexBuffers();
-	}
-
-	*buffer = dyn_ib->buffer;
-	*buffer_offset = dyn_ib->current_offset;
-
-	unsigned char *data = dyn_ib->data + dyn_ib->current_offset;
-	dyn_ib->current_offset += aligned_size;
-
+	uint32_t chunk_offset;
+	byte * data = R_DynamicAllocate(DYN_BUFFER_INDEX, aligned_size, buffer, &chunk_offset, NULL);
+	*buffer_offset = chunk_offset;
 	return data;
 }
 
@@ -1058,25 +1259,7 @@ byte * R_UniformAllocate(int size, VkBuffer * buffer, uint32_t * buffer_offset,
 	const int align_mod = size % 256;
 	const int aligned_size = ((size % 256) == 0) ? size : (size + 256 - align_mod);
 
-	dynbuffer_t *dyn_ub = &dyn_uniform_buffers[current_dyn_buffer_index];
-
-	if ((dyn_ub->current_offset + MAX_UNIFORM_ALLOC) > current_dyn_uniform_buffer_size)
-	{
-		R_AddDynamicBufferGarbage(dyn_uniform_buffer_memory, dyn_uniform_buffers, ubo_descriptor_sets);
-		current_dyn_uniform_buffer_size = q_max(current_dyn_uniform_buffer_size * 2, (uint32_t)Q_nextPow2(size));
-		vkUnmapMemory(vulkan_globals.device, dyn_uniform_buffer_memory.handle);
-		R_InitDynamicUniformBuffers();
-	}
-
-	*buffer = dyn_ub->buffer;
-	*buffer_offset = dyn_ub->current_offset;
-
-	unsigned char *data = dyn_ub->data + dyn_ub->current_offset;
-	dyn_ub->current_offset += aligned_size;
-
-	*descriptor_set = ubo_descriptor_sets[current_dyn_buffer_index];
-
-	return data;
+	return R_DynamicAllocate(DYN_BUFFER_UNIFORM, aligned_size, buffer, buffer_offset, descriptor_set);
 }
 
 /*
@@ -2632,6 +2815,7 @@ void R_Init (void)
 	Cmd_AddCommand ("timerefresh", R_TimeRefresh_f);
 	Cmd_AddCommand ("pointfile", R_ReadPointFile_f);
 	Cmd_AddCommand ("vkmemstats", R_VulkanMemStats_f);
+	Cmd_AddCommand ("r_lightmaptest", R_LightmapTest_f);
 
 	Cvar_RegisterVariable (&r_fullbright);
 	Cvar_RegisterVariable (&r_lightmap);
@@ -2648,6 +2832,8 @@ void R_Init (void)
 #endif
 	Cvar_RegisterVariable (&r_speeds);
 	Cvar_RegisterVariable (&r_pos);
+	Cvar_RegisterVariable (&r_showlightmapuploads);
+	Cvar_RegisterVariable (&r_rendercache);
 	Cvar_RegisterVariable (&gl_polyblend);
 	Cvar_RegisterVariable (&gl_nocolors);
 
@@ -2682,6 +2868,7 @@ void R_Init (void)
 	Cvar_SetCallback (&r_lavaalpha, R_SetLavaalpha_f);
 	Cvar_SetCallback (&r_telealpha, R_SetTelealpha_f);
 	Cvar_SetCallback (&r_slimealpha, R_SetSlimealpha_f);
+	Cvar_RegisterVariable (&r_parallel_recording);
 
 	R_InitParticles ();
 #ifdef PSET_SCRIPT
@@ -2890,6 +3077,9 @@ void R_NewMap (void)
 
 	GL_BuildLightmaps ();
 	GL_BuildBModelVertexBuffer ();
+#if defined(USE_SIMD)
+	R_InitMarkRanges ();
+#endif
 	//ericw -- no longer load alias models into a VBO here, it's done in Mod_LoadAliasModel
 
 	r_framecount = 0; //johnfitz -- paranoid?
@@ -2929,6 +3119,7 @@ void R_TimeRefresh_f (void)
 		GL_BeginRendering(&glx, &gly, &glwidth, &glheight);
 		r_refdef.viewangles[1] = i/128.0*360.0;
 		R_RenderView ();
+		R_ExecuteSceneStages ();
 		GL_EndRendering (false);
 	}
 
@@ -2982,4 +3173,8 @@ void R_VulkanMemStats_f(void)
 	Con_Printf(" Storage images: %d\n", num_vulkan_storage_images );
 	Con_Printf("Device %" SDL_PRIu64 " MiB total\n", (uint64_t)total_device_vulkan_allocation_size / 1024 / 1024);
 	Con_Printf("Host %"  SDL_PRIu64 " MiB total\n",  (uint64_t)total_host_vulkan_allocation_size   / 1024 / 1024);
+	Con_Printf("Dynamic buffers (size / high-water KB):\n");
+	Con_Printf(" Vertex: %u / %u\n", current_dyn_vertex_buffer_size / 1024, dyn_high_water[DYN_BUFFER_VERTEX] / 1024);
+	Con_Printf(" Index: %u / %u\n", current_dyn_index_buffer_size / 1024, dyn_high_water[DYN_BUFFER_INDEX] / 1024);
+	Con_Printf(" Uniform: %u / %u\n", current_dyn_uniform_buffer_size / 1024, dyn_high_water[DYN_BUFFER_UNIFORM] / 1024);
 }
@@ -31,8 +31,6 @@ float Fog_GetDensity(void);
 float *Fog_GetColor(void);
 
 extern	qmodel_t	*loadmodel;
-extern	unsigned int	rs_skypolys; //for r_speeds readout
-extern	unsigned int rs_skypasses; //for r_speeds readout
 float	skyflatcolor[3];
 float	skymins[2][6], skymaxs[2][6];
 
@@ -654,12 +652,18 @@ void Sky_ProcessEntities (float color[3])
 	entity_t	*e;
 	msurface_t	*s;
 	glpoly_t	*p;
-	int			i,j,k,mark;
+	int			i,j,k;
 	float		dot;
 	qboolean	rotated;
 	vec3_t		temp, forward, right, up;
+	vec3_t		modelorg;
 	float		*s_poly_vert;
 	float		*poly_vert;
+	union
+	{
+		glpoly_t	poly;
+		float		verts[sizeof(glpoly_t) / sizeof(float) + (MAX_CLIP_VERTS - 4) * VERTEXSIZE];
+	} translated;
 
 	if (!r_drawentities.value)
 		return;
@@ -701,8 +705,10 @@ void Sky_ProcessEntities (float color[3])
 					(!(s->flags & SURF_PLANEBACK) && (dot > BACKFACE_EPSILON)))
 				{
 					//copy the polygon and translate manually, since Sky_ProcessPoly needs it to be in world space
-					mark = Hunk_LowMark();
-					p = (glpoly_t *) Hunk_Alloc (sizeof(*s->polys)); //FIXME: don't allocate for each poly
+					//no hunk allocation: this may run on a job thread
+					if (s->polys->numverts > MAX_CLIP_VERTS)
+						continue;
+					p = &translated.poly;
 					p->numverts = s->polys->numverts;
 					for (k=0; k<p->numverts; k++)
 					{
@@ -726,7 +732,6 @@ void Sky_ProcessEntities (float color[3])
 						}
 					}
 					Sky_ProcessPoly (p, color);
-					Hunk_FreeToLowMark (mark);
 				}
 			}
 		}
@@ -805,7 +810,7 @@ void Sky_DrawSkyBox (void)
 		if (skymins[0][i] >= skymaxs[0][i] || skymins[1][i] >= skymaxs[1][i])
 			continue;
 
-		vkCmdBindDescriptorSets(vulkan_globals.command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_pipeline_layout.handle, 0, 1, &skybox_textures[skytexorder[i]]->descriptor_set, 0, NULL);
+		vkCmdBindDescriptorSets(vulkan_recording.command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_pipeline_layout.handle, 0, 1, &skybox_textures[skytexorder[i]]->descriptor_set, 0, NULL);
 
 		VkBuffer buffer;
 		VkDeviceSize buffer_offset;
@@ -822,9 +827,9 @@ void Sky_DrawSkyBox (void)
 		Sky_EmitSkyBoxVertex (vertices + 2, skymaxs[0][i], skymaxs[1][i], i);
 		Sky_EmitSkyBoxVertex (vertices + 3, skymaxs[0][i], skymins[1][i], i);
 
-		vkCmdBindVertexBuffers(vulkan_globals.command_buffer, 0, 1, &buffer, &buffer_offset);
+		vkCmdBindVertexBuffers(vulkan_recording.command_buffer, 0, 1, &buffer, &buffer_offset);
 		R_BindPipeline(VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.sky_box_pipeline);
-		vkCmdDrawIndexed(vulkan_globals.command_buffer, 6, 1, 0, 0, 0);
+		vkCmdDrawIndexed(vulkan_recording.command_buffer, 6, 1, 0, 0, 0);
 
 		rs_skypolys++;
 		rs_skypasses++;
@@ -915,8 +920,8 @@ void Sky_DrawFaceQuad (glpoly_t *p, float alpha)
 		vertices[i].color[3] = alpha * 255.0f;
 	}
 
-	vkCmdBindVertexBuffers(vulkan_globals.command_buffer, 0, 1, &vertex_buffer, &vertex_buffer_offset);
-	vkCmdDrawIndexed(vulkan_globals.command_buffer, 6, 1, 0, 0, 0);
+	vkCmdBindVertexBuffers(vulkan_recording.command_buffer, 0, 1, &vertex_buffer, &vertex_buffer_offset);
+	vkCmdDrawIndexed(vulkan_recording.command_buffer, 6, 1, 0, 0, 0);
 
 	rs_skypolys++;
 	rs_skypasses++;
@@ -1006,7 +1011,7 @@ void Sky_DrawSkyLayers (void)
 	R_PushConstants (VK_SHADER_STAGE_ALL_GRAPHICS, 20 * sizeof (float), 5 * sizeof (float), r_sky_consts);
 
 	VkDescriptorSet descriptor_sets[2] = { solidskytexture->descriptor_set, alphaskytexture->descriptor_set };
-	vkCmdBindDescriptorSets(vulkan_globals.command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.sky_layer_pipeline.layout.handle, 0, 2, descriptor_sets, 0, NULL);
+	vkCmdBindDescriptorSets(vulkan_recording.command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.sky_layer_pipeline.layout.handle, 0, 2, descriptor_sets, 0, NULL);
 
 	for (i=0 ; i<6 ; i++)
 		if (skymins[0][i] < skymaxs[0][i] && skymins[1][i] < skymaxs[1][i])
@@ -1046,7 +1051,7 @@ void Sky_DrawSky (void)
 		R_BindPipeline(VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.sky_stencil_pipeline);
 	else
 		R_BindPipeline(VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.sky_color_pipeline);
-	vkCmdBindIndexBuffer(vulkan_globals.command_buffer, vulkan_globals.fan_index_buffer, 0, VK_INDEX_TYPE_UINT16);
+	vkCmdBindIndexBuffer(vulkan_recording.command_buffer, vulkan_globals.fan_index_buffer, 0, VK_INDEX_TYPE_UINT16);
 
 	//
 	// process world and bmodels: draw flat-shaded sky surfs, and update skybounds
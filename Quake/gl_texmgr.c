@@ -39,6 +39,13 @@ extern cvar_t vid_anisotropic;
 #define	MAX_MIPS 16
 static int numgltextures;
 static gltexture_t	*active_gltextures, *free_gltextures;
+
+// active textures are also chained by owner and name, for TexMgr_FindTexture,
+// and by owner alone, for TexMgr_FreeTexturesForOwner
+#define	TEXTURE_HASH_SIZE	1024
+#define	OWNER_HASH_SIZE		256
+static gltexture_t	*texture_hash[TEXTURE_HASH_SIZE];
+static gltexture_t	*owner_hash[OWNER_HASH_SIZE];
 gltexture_t		*notexture, *nulltexture, *whitetexture, *greytexture;
 
 unsigned int d_8to24table[256];
@@ -57,6 +64,8 @@ static int num_texmgr_heaps;
 static byte *image_resize_buffer;
 static int image_resize_buffer_size;
 
+double texmgr_uploadtime;
+
 /*
 ================================================================================
 
@@ -145,6 +154,19 @@ static void TexMgr_Imagelist_f (void)
 ================================================================================
 */
 
+/*
+================
+TexMgr_OwnerHash
+================
+*/
+static unsigned int TexMgr_OwnerHash (qmodel_t *owner)
+{
+	return (unsigned int)((uintptr_t)owner >> 3) * 2654435761u;
+}
+
+#define	TEXTURE_HASH(owner, name)	((COM_HashString (name) ^ TexMgr_OwnerHash (owner)) & (TEXTURE_HASH_SIZE - 1))
+#define	OWNER_HASH(owner)			(TexMgr_OwnerHash (owner) >> 24)
+
 /*
 ================
 TexMgr_FindTexture
@@ -156,7 +178,7 @@ gltexture_t *TexMgr_FindTexture (qmodel_t *owner, const char *name)
 
 	if (name)
 	{
-		for (glt = active_gltextures; glt; glt = glt->next)
+		for (glt = texture_hash[TEXTURE_HASH (owner, name)]; glt; glt = glt->hashnext)
 		{
 			if (glt->owner == owner && !strcmp (glt->name, name))
 				return glt;
@@ -171,15 +193,36 @@ gltexture_t *TexMgr_FindTexture (qmodel_t *owner, const char *name)
 TexMgr_NewTexture
 ================
 */
-gltexture_t *TexMgr_NewTexture (void)
+gltexture_t *TexMgr_NewTexture (qmodel_t *owner, const char *name)
 {
 	gltexture_t *glt;
+	gltexture_t **head;
 
 	glt = free_gltextures;
 	free_gltextures = glt->next;
+	glt->prev = NULL;
 	glt->next = active_gltextures;
+	if (active_gltextures)
+		active_gltextures->prev = glt;
 	active_gltextures = glt;
 
+	glt->owner = owner;
+	q_strlcpy (glt->name, name, sizeof(glt->name));
+
+	head = &texture_hash[TEXTURE_HASH (owner, glt->name)];
+	glt->hashprev = NULL;
+	glt->hashnext = *head;
+	if (*head)
+		(*head)->hashprev = glt;
+	*head = glt;
+
+	head = &owner_hash[OWNER_HASH (owner)];
+	glt->ownerprev = NULL;
+	glt->ownernext = *head;
+	if (*head)
+		(*head)->ownerprev = glt;
+	*head = glt;
+
 	numgltextures++;
 	return glt;
 }
@@ -193,40 +236,46 @@ TexMgr_FreeTexture
 */
 void TexMgr_FreeTexture (gltexture_t *kill)
 {
-	gltexture_t *glt;
-
 	if (kill == NULL)
 	{
 		Con_Printf ("TexMgr_FreeTexture: NULL texture\n");
 		return;
 	}
 
-	if (active_gltextures == kill)
+	// only the head of the active list has no prev, free textures have neither
+	if (!kill->prev && active_gltextures != kill)
 	{
-		active_gltextures = kill->next;
-		kill->next = free_gltextures;
-		free_gltextures = kill;
-
-		GL_DeleteTexture(kill);
-		numgltextures--;
+		Con_Printf ("TexMgr_FreeTexture: not found\n");
 		return;
 	}
 
-	for (glt = active_gltextures; glt; glt = glt->next)
-	{
-		if (glt->next == kill)
-		{
-			glt->next = kill->next;
-			kill->next = free_gltextures;
-			free_gltextures = kill;
+	if (kill->prev)
+		kill->prev->next = kill->next;
+	else
+		active_gltextures = kill->next;
+	if (kill->next)
+		kill->next->prev = kill->prev;
 
-			GL_DeleteTexture(kill);
-			numgltextures--;
-			return;
-		}
-	}
+	if (kill->hashprev)
+		kill->hashprev->hashnext = kill->hashnext;
+	else
+		texture_hash[TEXTURE_HASH (kill->owner, kill->name)] = kill->hashnext;
+	if (kill->hashnext)
+		kill->hashnext->hashprev = kill->hashprev;
+
+	if (kill->ownerprev)
+		kill->ownerprev->ownernext = kill->ownernext;
+	else
+		owner_hash[OWNER_HASH (kill->owner)] = kill->ownernext;
+	if (kill->ownernext)
+		kill->ownernext->ownerprev = kill->ownerprev;
+
+	kill->prev = NULL;
+	kill->next = free_gltextures;
+	free_gltextures = kill;
 
-	Con_Printf ("TexMgr_FreeTexture: not found\n");
+	GL_DeleteTexture(kill);
+	numgltextures--;
 }
 
 /*
@@ -257,10 +306,10 @@ void TexMgr_FreeTexturesForOwner (qmodel_t *owner)
 {
 	gltexture_t *glt, *next;
 
-	for (glt = active_gltextures; glt; glt = next)
+	for (glt = owner_hash[OWNER_HASH (owner)]; glt; glt = next)
 	{
-		next = glt->next;
-		if (glt && glt->owner == owner)
+		next = glt->ownernext;
+		if (glt->owner == owner)
 			TexMgr_FreeTexture (glt);
 	}
 }
@@ -370,6 +419,7 @@ must be called before any texture loading
 void TexMgr_Init (void)
 {
 	int i;
+	memtag_t tag;
 	static byte notexture_data[16] = {159,91,83,255,0,0,0,255,0,0,0,255,159,91,83,255}; //black and pink checker
 	static byte nulltexture_data[16] = {127,191,255,255,0,0,0,255,0,0,0,255,127,191,255,255}; //black and blue checker
 	static byte whitetexture_data[16] = {255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255}; //white
@@ -377,8 +427,12 @@ void TexMgr_Init (void)
 	extern texture_t *r_notexture_mip, *r_notexture_mip2;
 
 	// init texture list
+	tag = Memory_SetTag (MEMTAG_TEXTURE);
 	free_gltextures = (gltexture_t *) Hunk_AllocName (MAX_GLTEXTURES * sizeof(gltexture_t), "gltextures");
+	Memory_SetTag (tag);
 	active_gltextures = NULL;
+	memset (texture_hash, 0, sizeof(texture_hash));
+	memset (owner_hash, 0, sizeof(owner_hash));
 	for (i = 0; i < MAX_GLTEXTURES - 1; i++)
 		free_gltextures[i].next = &free_gltextures[i+1];
 	free_gltextures[i].next = NULL;
@@ -905,11 +959,9 @@ gltexture_t *TexMgr_LoadImage (qmodel_t *owner, const char *name, int width, int
 			return glt;
 	}
 	else
-		glt = TexMgr_NewTexture ();
+		glt = TexMgr_NewTexture (owner, name);
 
 	// copy data
-	glt->owner = owner;
-	q_strlcpy (glt->name, name, sizeof(glt->name));
 	glt->width = width;
 	glt->height = height;
 	glt->flags = flags;
@@ -924,6 +976,7 @@ gltexture_t *TexMgr_LoadImage (qmodel_t *owner, const char *name, int width, int
 
 	//upload it
 	mark = Hunk_LowMark();
+	double time = Sys_DoubleTime ();
 
 	switch (glt->source_format)
 	{
@@ -938,6 +991,7 @@ gltexture_t *TexMgr_LoadImage (qmodel_t *owner, const char *name, int width, int
 		break;
 	}
 
+	texmgr_uploadtime += Sys_DoubleTime () - time;
 	Hunk_FreeToLowMark(mark);
 
 	return glt;
@@ -48,7 +48,9 @@ struct glheapnode_s;
 
 typedef struct gltexture_s {
 //managed by texture manager
-	struct gltexture_s	*next;
+	struct gltexture_s	*next, *prev;
+	struct gltexture_s	*hashnext, *hashprev;	// same owner and name hash
+	struct gltexture_s	*ownernext, *ownerprev;	// same owner hash
 	qmodel_t		*owner;
 //managed by image loading
 	char			name[64];
@@ -85,10 +87,12 @@ extern unsigned int d_8to24table_conchars[256];
 extern unsigned int d_8to24table_shirt[256];
 extern unsigned int d_8to24table_pants[256];
 
+extern double texmgr_uploadtime;	// seconds TexMgr_LoadImage spent converting and uploading
+
 // TEXTURE MANAGER
 
 gltexture_t *TexMgr_FindTexture (qmodel_t *owner, const char *name);
-gltexture_t *TexMgr_NewTexture (void);
+gltexture_t *TexMgr_NewTexture (qmodel_t *owner, const char *name);
 void TexMgr_FreeTexture (gltexture_t *kill);
 void TexMgr_FreeTextures (unsigned int flags, unsigned int mask);
 void TexMgr_FreeTexturesForOwner (qmodel_t *owner);
@@ -120,6 +120,8 @@ static uint32_t						current_command_buffer;
 static VkCommandPool				command_pool;
 static VkCommandPool				transient_command_pool;
 static VkCommandBuffer				command_buffers[NUM_COMMAND_BUFFERS];
+static VkCommandPool				secondary_command_pools[NUM_COMMAND_BUFFERS][SCENE_STAGE_COUNT];
+static VkCommandBuffer				secondary_command_buffers[NUM_COMMAND_BUFFERS][SCENE_STAGE_COUNT];
 static VkFence						command_buffer_fences[NUM_COMMAND_BUFFERS];
 static qboolean						command_buffer_submitted[NUM_COMMAND_BUFFERS];
 static VkFramebuffer				main_framebuffers[NUM_COLOR_BUFFERS];
@@ -1063,6 +1065,25 @@ static void GL_InitCommandBuffers( void )
 	if (err != VK_SUCCESS)
 		Sys_Error("vkAllocateCommandBuffers failed");
 
+	// Scene stages are recorded on different threads, command pools are externally synchronized
+	command_buffer_allocate_info.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+	command_buffer_allocate_info.commandBufferCount = 1;
+	command_pool_create_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+	for (i = 0; i < NUM_COMMAND_BUFFERS; ++i)
+	{
+		for (int j = 0; j < SCENE_STAGE_COUNT; ++j)
+		{
+			err = vkCreateCommandPool(vulkan_globals.device, &command_pool_create_info, NULL, &secondary_command_pools[i][j]);
+			if (err != VK_SUCCESS)
+				Sys_Error("vkCreateCommandPool failed");
+
+			command_buffer_allocate_info.commandPool = secondary_command_pools[i][j];
+			err = vkAllocateCommandBuffers(vulkan_globals.device, &command_buffer_allocate_info, &secondary_command_buffers[i][j]);
+			if (err != VK_SUCCESS)
+				Sys_Error("vkAllocateCommandBuffers failed");
+		}
+	}
+
 	VkFenceCreateInfo fence_create_info;
 	memset(&fence_create_info, 0, sizeof(fence_create_info));
 	fence_create_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
@@ -1080,6 +1101,70 @@ static void GL_InitCommandBuffers( void )
 	}
 }
 
+/*
+===============
+GL_BeginSecondaryCommandBuffer
+
+Begins the secondary command buffer of a scene stage for the current frame.
+Secondary command buffers don't inherit any state, the caller still needs to
+set the viewport.
+===============
+*/
+VkCommandBuffer GL_BeginSecondaryCommandBuffer (int stage, VkFramebuffer framebuffer)
+{
+	VkCommandBuffer command_buffer = secondary_command_buffers[current_command_buffer][stage];
+
+	VkCommandBufferInheritanceInfo inheritance_info;
+	memset(&inheritance_info, 0, sizeof(inheritance_info));
+	inheritance_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+	inheritance_info.renderPass = vulkan_globals.main_render_pass;
+	inheritance_info.subpass = 0;
+	inheritance_info.framebuffer = framebuffer;
+
+	VkCommandBufferBeginInfo command_buffer_begin_info;
+	memset(&command_buffer_begin_info, 0, sizeof(command_buffer_begin_info));
+	command_buffer_begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	command_buffer_begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+	command_buffer_begin_info.pInheritanceInfo = &inheritance_info;
+
+	VkResult err = vkBeginCommandBuffer(command_buffer, &command_buffer_begin_info);
+	if (err != VK_SUCCESS)
+		Sys_Error("vkBeginCommandBuffer failed");
+
+	VkRect2D render_area;
+	render_area.offset.x = 0;
+	render_area.offset.y = 0;
+	render_area.extent.width = vid.width;
+	render_area.extent.height = vid.height;
+	vkCmdSetScissor(command_buffer, 0, 1, &render_area);
+
+	return command_buffer;
+}
+
+/*
+===============
+GL_EndSecondaryCommandBuffer
+===============
+*/
+void GL_EndSecondaryCommandBuffer (VkCommandBuffer command_buffer)
+{
+	VkResult err = vkEndCommandBuffer(command_buffer);
+	if (err != VK_SUCCESS)
+		Sys_Error("vkEndCommandBuffer failed");
+}
+
+/*
+===============
+GL_ExecuteSecondaryCommandBuffers
+
+Executes all scene stages of the current frame in order
+===============
+*/
+void GL_ExecuteSecondaryCommandBuffers (void)
+{
+	vkCmdExecuteCommands(command_buffers[current_command_buffer], SCENE_STAGE_COUNT, secondary_command_buffers[current_command_buffer]);
+}
+
 /*
 ====================
 GL_CreateRenderPasses
@@ -2030,7 +2115,7 @@ qboolean GL_BeginRendering (int *x, int *y, int *width, int *height)
 	R_SwapDynamicBuffers();
 
 	vulkan_globals.device_idle = false;
-	memset(&vulkan_globals.current_pipeline, 0, sizeof(vulkan_globals.current_pipeline));
+	memset(&vulkan_recording.current_pipeline, 0, sizeof(vulkan_recording.current_pipeline));
 	*x = *y = 0;
 	*width = vid.width;
 	*height = vid.height;
@@ -2057,8 +2142,8 @@ qboolean GL_BeginRendering (int *x, int *y, int *width, int *height)
 	command_buffer_begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 	command_buffer_begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
-	vulkan_globals.command_buffer = command_buffers[current_command_buffer];
-	err = vkBeginCommandBuffer(vulkan_globals.command_buffer, &command_buffer_begin_info);
+	vulkan_recording.command_buffer = command_buffers[current_command_buffer];
+	err = vkBeginCommandBuffer(vulkan_recording.command_buffer, &command_buffer_begin_info);
 	if (err != VK_SUCCESS)
 		Sys_Error("vkBeginCommandBuffer failed");
 
@@ -2089,7 +2174,7 @@ qboolean GL_BeginRendering (int *x, int *y, int *width, int *height)
 		vulkan_globals.main_render_pass_begin_infos[i].pClearValues = vulkan_globals.main_clear_values;
 	}
 
-	vkCmdSetScissor(vulkan_globals.command_buffer, 0, 1, &render_area);
+	vkCmdSetScissor(vulkan_recording.command_buffer, 0, 1, &render_area);
 
 	VkViewport viewport;
 	viewport.x = 0;
@@ -2099,7 +2184,7 @@ qboolean GL_BeginRendering (int *x, int *y, int *width, int *height)
 	viewport.minDepth = 0.0f;
 	viewport.maxDepth = 1.0f;
 
-	vkCmdSetViewport(vulkan_globals.command_buffer, 0, 1, &viewport);
+	vkCmdSetViewport(vulkan_recording.command_buffer, 0, 1, &viewport);
 
 	R_BindPipeline(VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_blend_pipeline[render_pass_index]);
 	GL_SetCanvas(CANVAS_NONE);
@@ -2189,16 +2274,16 @@ void GL_EndRendering (qboolean swapchain_acquired)
 		GL_Viewport(0, 0, vid.width, vid.height, 0.0f, 1.0f);
 		float postprocess_values[2] = { vid_gamma.value, q_min(2.0f, q_max(1.0f, vid_contrast.value)) };
 
-		vkCmdNextSubpass(vulkan_globals.command_buffer, VK_SUBPASS_CONTENTS_INLINE);
+		vkCmdNextSubpass(vulkan_recording.command_buffer, VK_SUBPASS_CONTENTS_INLINE);
 		R_BindPipeline(VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.postprocess_pipeline);
-		vkCmdBindDescriptorSets(vulkan_globals.command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.postprocess_pipeline.layout.handle, 0, 1, &postprocess_descriptor_set, 0, NULL);
+		vkCmdBindDescriptorSets(vulkan_recording.command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.postprocess_pipeline.layout.handle, 0, 1, &postprocess_descriptor_set, 0, NULL);
 		R_PushConstants(VK_SHADER_STAGE_FRAGMENT_BIT, 0, 2 * sizeof(float), postprocess_values);
-		vkCmdDraw(vulkan_globals.command_buffer, 3, 1, 0, 0);
+		vkCmdDraw(vulkan_recording.command_buffer, 3, 1, 0, 0);
 
-		vkCmdEndRenderPass(vulkan_globals.command_buffer);
+		vkCmdEndRenderPass(vulkan_recording.command_buffer);
 	}
 
-	err = vkEndCommandBuffer(vulkan_globals.command_buffer);
+	err = vkEndCommandBuffer(vulkan_recording.command_buffer);
 	if (err != VK_SUCCESS)
 		Sys_Error("vkEndCommandBuffer failed");
 
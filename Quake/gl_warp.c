@@ -196,15 +196,15 @@ static void R_RasterWarpTexture(texture_t *tx, float warptess) {
 	render_pass_begin_info.renderPass = vulkan_globals.warp_render_pass;
 	render_pass_begin_info.framebuffer = tx->warpimage->frame_buffer;
 
-	vkCmdBeginRenderPass(vulkan_globals.command_buffer, &render_pass_begin_info, VK_SUBPASS_CONTENTS_INLINE);
+	vkCmdBeginRenderPass(vulkan_recording.command_buffer, &render_pass_begin_info, VK_SUBPASS_CONTENTS_INLINE);
 
 	//render warp
 	GL_SetCanvas(CANVAS_WARPIMAGE);
 	R_BindPipeline(VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.raster_tex_warp_pipeline);
 	if (!r_lightmap_cheatsafe)
-		vkCmdBindDescriptorSets(vulkan_globals.command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_pipeline_layout.handle, 0, 1, &tx->gltexture->descriptor_set, 0, NULL);
+		vkCmdBindDescriptorSets(vulkan_recording.command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_pipeline_layout.handle, 0, 1, &tx->gltexture->descriptor_set, 0, NULL);
 	else
-		vkCmdBindDescriptorSets(vulkan_globals.command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_pipeline_layout.handle, 0, 1, &whitetexture->descriptor_set, 0, NULL);
+		vkCmdBindDescriptorSets(vulkan_recording.command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_pipeline_layout.handle, 0, 1, &whitetexture->descriptor_set, 0, NULL);
 
 	int num_verts = 0;
 	for (y = 0.0; y<128.01; y += warptess) // .01 for rounding errors
@@ -242,11 +242,11 @@ static void R_RasterWarpTexture(texture_t *tx, float warptess) {
 			i += 1;
 		}
 
-		vkCmdBindVertexBuffers(vulkan_globals.command_buffer, 0, 1, &buffer, &buffer_offset);
-		vkCmdDraw(vulkan_globals.command_buffer, num_verts, 1, 0, 0);
+		vkCmdBindVertexBuffers(vulkan_recording.command_buffer, 0, 1, &buffer, &buffer_offset);
+		vkCmdDraw(vulkan_recording.command_buffer, num_verts, 1, 0, 0);
 	}
 
-	vkCmdEndRenderPass(vulkan_globals.command_buffer);
+	vkCmdEndRenderPass(vulkan_recording.command_buffer);
 }
 
 /*
@@ -261,9 +261,9 @@ static void R_ComputeWarpTexture(texture_t *tx, float warptess) {
 	VkDescriptorSet sets[2] = { tx->gltexture->descriptor_set, tx->warpimage->warp_write_descriptor_set };
 	if (r_lightmap_cheatsafe)
 		sets[0] = whitetexture->descriptor_set;
-	vkCmdBindDescriptorSets(vulkan_globals.command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, vulkan_globals.cs_tex_warp_pipeline.layout.handle, 0, 2, sets, 0, NULL);
+	vkCmdBindDescriptorSets(vulkan_recording.command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, vulkan_globals.cs_tex_warp_pipeline.layout.handle, 0, 2, sets, 0, NULL);
 	R_PushConstants(VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(float), &time);
-	vkCmdDispatch(vulkan_globals.command_buffer, WARPIMAGESIZE / 8, WARPIMAGESIZE / 8, 1);
+	vkCmdDispatch(vulkan_recording.command_buffer, WARPIMAGESIZE / 8, WARPIMAGESIZE / 8, 1);
 }
 
 /*
@@ -271,9 +271,6 @@ static void R_ComputeWarpTexture(texture_t *tx, float warptess) {
 R_UpdateWarpTextures -- johnfitz -- each frame, update warping textures
 =============
 */
-static texture_t * warp_textures[MAX_GLTEXTURES];
-static VkImageMemoryBarrier warp_image_barriers[MAX_GLTEXTURES];
-
 void R_UpdateWarpTextures (void)
 {
 	GL_SetCanvas(CANVAS_NONE); // Invalidate canvas so push constants get set later
@@ -291,6 +288,8 @@ void R_UpdateWarpTextures (void)
 
 	int num_textures = cl.worldmodel->numtextures;
 	int num_warp_textures = 0;
+	texture_t ** warp_textures = (texture_t **) Frame_Alloc (num_textures * sizeof (texture_t *));
+	VkImageMemoryBarrier * warp_image_barriers = (VkImageMemoryBarrier *) Frame_Alloc (num_textures * sizeof (VkImageMemoryBarrier));
 
 	// Count warp texture & prepare barrier from undefined to GENERL if using compute warp
 	for (i = 0; i < num_textures; ++i)
@@ -326,7 +325,7 @@ void R_UpdateWarpTextures (void)
 
 	// Transfer mips from UNDEFINED to GENERAL layout
 	if (r_waterwarpcompute.value)
-		vkCmdPipelineBarrier(vulkan_globals.command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, NULL, 0, NULL, num_warp_textures, warp_image_barriers);
+		vkCmdPipelineBarrier(vulkan_recording.command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, NULL, 0, NULL, num_warp_textures, warp_image_barriers);
 
 	// Render warp to top mips
 	for (i = 0; i < num_warp_textures; ++i)
@@ -363,7 +362,7 @@ void R_UpdateWarpTextures (void)
 	memory_barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
 
 	// Transfer all other mips from UNDEFINED to GENERAL layout
-	vkCmdPipelineBarrier(vulkan_globals.command_buffer, r_waterwarpcompute.value ? VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT : VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &memory_barrier, 0, NULL, num_warp_textures, warp_image_barriers);
+	vkCmdPipelineBarrier(vulkan_recording.command_buffer, r_waterwarpcompute.value ? VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT : VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &memory_barrier, 0, NULL, num_warp_textures, warp_image_barriers);
 
 	// Generate mip chains
 	for (mip = 1; mip < WARPIMAGEMIPS; ++mip)
@@ -390,14 +389,14 @@ void R_UpdateWarpTextures (void)
 			region.dstSubresource.layerCount = 1;
 			region.dstSubresource.mipLevel = mip;
 
-			vkCmdBlitImage(vulkan_globals.command_buffer, tx->warpimage->image, VK_IMAGE_LAYOUT_GENERAL, tx->warpimage->image, VK_IMAGE_LAYOUT_GENERAL, 1, &region, VK_FILTER_LINEAR);
+			vkCmdBlitImage(vulkan_recording.command_buffer, tx->warpimage->image, VK_IMAGE_LAYOUT_GENERAL, tx->warpimage->image, VK_IMAGE_LAYOUT_GENERAL, 1, &region, VK_FILTER_LINEAR);
 		}
 
 		if (mip < (WARPIMAGEMIPS - 1))
 		{
 			memory_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
 			memory_barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-			vkCmdPipelineBarrier(vulkan_globals.command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &memory_barrier, 0, NULL, 0, NULL);
+			vkCmdPipelineBarrier(vulkan_recording.command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &memory_barrier, 0, NULL, 0, NULL);
 		}
 	}
 
@@ -425,7 +424,7 @@ void R_UpdateWarpTextures (void)
 		tx->update_warp = false;
 	}
 
-	vkCmdPipelineBarrier(vulkan_globals.command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, NULL, 0, NULL, num_warp_textures, warp_image_barriers);
+	vkCmdPipelineBarrier(vulkan_recording.command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, NULL, 0, NULL, num_warp_textures, warp_image_barriers);
 
 	//if warp render went down into sbar territory, we need to be sure to refresh it next frame
 	if (WARPIMAGESIZE + sb_lines > glheight)
@@ -30,6 +30,9 @@ qboolean GL_BeginRendering (int *x, int *y, int *width, int *height);
 qboolean GL_AcquireNextSwapChainImage (void);
 void GL_EndRendering (qboolean swapchain_acquired);
 qboolean GL_Set2D (void);
+VkCommandBuffer GL_BeginSecondaryCommandBuffer (int stage, VkFramebuffer framebuffer);
+void GL_EndSecondaryCommandBuffer (VkCommandBuffer command_buffer);
+void GL_ExecuteSecondaryCommandBuffers (void);
 
 extern	int glx, gly, glwidth, glheight;
 
@@ -93,6 +96,7 @@ typedef struct
 #ifdef PSET_SCRIPT
 	void PScript_InitParticles (void);
 	void PScript_Shutdown (void);
+	void PScript_UpdateLooks (void);
 	void PScript_DrawParticles (void);
 	void PScript_DrawParticles_ShowTris (void);
 	struct trailstate_s;
@@ -164,8 +168,6 @@ typedef struct
 	qboolean							validation;
 	qboolean							debug_utils;
 	VkQueue								queue;
-	VkCommandBuffer						command_buffer;
-	vulkan_pipeline_t					current_pipeline;
 	VkClearValue						color_clear_value;
 	VkFormat							swap_chain_format;
 	qboolean							want_full_screen_exclusive;
@@ -285,6 +287,31 @@ typedef struct
 
 extern vulkanglobals_t vulkan_globals;
 
+// Command buffer the calling thread records into: the frame's primary buffer
+// on the main thread, a scene stage's secondary buffer while it is recorded
+typedef struct
+{
+	VkCommandBuffer						command_buffer;
+	vulkan_pipeline_t					current_pipeline;
+} vulkan_recording_t;
+
+extern THREAD_LOCAL vulkan_recording_t vulkan_recording;
+
+// Scene stages, in draw order. With r_parallel_recording each one is recorded
+// into its own secondary command buffer and executed by the primary in order.
+typedef enum
+{
+	SCENE_STAGE_WORLD,
+	SCENE_STAGE_ENTITIES,
+	SCENE_STAGE_SKY,
+	SCENE_STAGE_WATER,
+	SCENE_STAGE_ALPHA_ENTITIES,
+	SCENE_STAGE_PARTICLES,
+	SCENE_STAGE_VIEWMODEL,
+	SCENE_STAGE_POST,	// showtris, bboxes and the view blend, finished by GL_Set2D
+	SCENE_STAGE_COUNT
+} scene_stage_t;
+
 //====================================================
 
 extern	qboolean	r_cache_thrash;		// compatability
@@ -319,6 +346,8 @@ extern	cvar_t	r_drawworld;
 extern	cvar_t	r_drawviewmodel;
 extern	cvar_t	r_speeds;
 extern	cvar_t	r_pos;
+extern	cvar_t	r_showlightmapuploads;
+extern	cvar_t	r_rendercache;
 extern	cvar_t	r_waterwarp;
 extern	cvar_t	r_fullbright;
 extern	cvar_t	r_lightmap;
@@ -340,8 +369,9 @@ extern	cvar_t	gl_subdivide_size;
 #define OFFSET_DECAL 1
 
 //johnfitz -- rendering statistics
-extern unsigned int rs_brushpolys, rs_aliaspolys, rs_skypolys, rs_particles, rs_fogpolys;
-extern unsigned int rs_dynamiclightmaps, rs_brushpasses, rs_aliaspasses, rs_skypasses;
+extern THREAD_LOCAL unsigned int rs_brushpolys, rs_aliaspolys, rs_skypolys, rs_particles, rs_fogpolys;
+extern THREAD_LOCAL unsigned int rs_dynamiclightmaps, rs_brushpasses, rs_aliaspasses, rs_skypasses, rs_lightmapsurfs;
+extern unsigned int rs_lightmapbytes, rs_lightmapregions;	// main thread only, reset by R_RenderView
 extern float rs_megatexels;
 
 extern size_t total_device_vulkan_allocation_size;
@@ -383,14 +413,16 @@ extern int gl_lightmap_format, lightmap_bytes;
 #define LMBLOCK_WIDTH	1024	//FIXME: make dynamic. if we have a decent card there's no real reason not to use 4k or 16k (assuming there's no lightstyles/dynamics that need uploading...)
 #define LMBLOCK_HEIGHT	1024	//Alternatively, use texture arrays, which would avoid the need to switch textures as often.
 
+#define MAX_LIGHTMAP_DIRTY_RECTS	32	// non-overlapping regions uploaded per lightmap block
+
 typedef struct glRect_s {
 	unsigned short l,t,w,h;
 } glRect_t;
 struct lightmap_s
 {
 	gltexture_t *texture;
-	qboolean	modified;
-	glRect_t	rectchange;
+	int			numdirtyrects;
+	glRect_t	dirtyrects[MAX_LIGHTMAP_DIRTY_RECTS];
 
 	// the lightmap texture data needs to be kept in
 	// main memory so texsubimage can update properly
@@ -418,6 +450,7 @@ void R_NewGame (void);
 
 void R_AnimateLight (void);
 void R_MarkSurfaces (void);
+void R_InitMarkRanges (void);
 qboolean R_CullBox (vec3_t emins, vec3_t emaxs);
 void R_StoreEfrags (efrag_t **ppefrag);
 qboolean R_CullModelForEntity (entity_t *e);
@@ -434,6 +467,7 @@ void R_TranslateNewPlayerSkin (int playernum); //johnfitz -- this handles cases
 void R_UpdateWarpTextures (void);
 
 void R_DrawWorld (void);
+qboolean R_ExecuteSceneStages (void);
 void R_DrawAliasModel (entity_t *e);
 void R_DrawBrushModel (entity_t *e);
 void R_DrawSpriteModel (entity_t *e);
@@ -450,7 +484,11 @@ int R_LightPoint (vec3_t p, lightcache_t *cache);
 
 void GL_SubdivideSurface (msurface_t *fa);
 void R_BuildLightMap (msurface_t *surf, byte *dest, int stride);
+void R_LightmapTest_f (void);
+qboolean R_LightmapNeedsUpdate (msurface_t *fa);
+void R_QueueDynamicLightmap (msurface_t *fa);
 void R_RenderDynamicLightmaps (msurface_t *fa);
+void R_BuildQueuedLightmaps (void);
 void R_UploadLightmaps (void);
 
 void R_DrawWorld_ShowTris(void);
@@ -494,19 +532,19 @@ static inline void R_BindPipeline(VkPipelineBindPoint bind_point, vulkan_pipelin
 	static byte zeroes[MAX_PUSH_CONSTANT_SIZE];
 	assert(pipeline.handle != VK_NULL_HANDLE);
 	assert(pipeline.layout.handle != VK_NULL_HANDLE);
-	assert(vulkan_globals.current_pipeline.layout.push_constant_range.size <= MAX_PUSH_CONSTANT_SIZE);
-	if(vulkan_globals.current_pipeline.handle != pipeline.handle) {
-		vulkan_globals.vk_cmd_bind_pipeline(vulkan_globals.command_buffer, bind_point, pipeline.handle);
-		if ((vulkan_globals.current_pipeline.layout.push_constant_range.stageFlags != pipeline.layout.push_constant_range.stageFlags)
-			|| (vulkan_globals.current_pipeline.layout.push_constant_range.size != pipeline.layout.push_constant_range.size))
-			vulkan_globals.vk_cmd_push_constants(vulkan_globals.command_buffer, pipeline.layout.handle, pipeline.layout.push_constant_range.stageFlags, 0, pipeline.layout.push_constant_range.size, zeroes);
-		vulkan_globals.current_pipeline = pipeline;
+	assert(vulkan_recording.current_pipeline.layout.push_constant_range.size <= MAX_PUSH_CONSTANT_SIZE);
+	if(vulkan_recording.current_pipeline.handle != pipeline.handle) {
+		vulkan_globals.vk_cmd_bind_pipeline(vulkan_recording.command_buffer, bind_point, pipeline.handle);
+		if ((vulkan_recording.current_pipeline.layout.push_constant_range.stageFlags != pipeline.layout.push_constant_range.stageFlags)
+			|| (vulkan_recording.current_pipeline.layout.push_constant_range.size != pipeline.layout.push_constant_range.size))
+			vulkan_globals.vk_cmd_push_constants(vulkan_recording.command_buffer, pipeline.layout.handle, pipeline.layout.push_constant_range.stageFlags, 0, pipeline.layout.push_constant_range.size, zeroes);
+		vulkan_recording.current_pipeline = pipeline;
 	}
 }
 
 static inline void R_PushConstants(VkShaderStageFlags stage_flags, int offset, int size, const void * data)
 {
-	vulkan_globals.vk_cmd_push_constants(vulkan_globals.command_buffer, vulkan_globals.current_pipeline.layout.handle, stage_flags, offset, size, data);
+	vulkan_globals.vk_cmd_push_constants(vulkan_recording.command_buffer, vulkan_recording.current_pipeline.layout.handle, stage_flags, offset, size, data);
 }
 
 static inline void R_BeginDebugUtilsLabel(const char * name)
@@ -517,7 +555,7 @@ static inline void R_BeginDebugUtilsLabel(const char * name)
 	label.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_LABEL_EXT;
 	label.pLabelName = name;
 	if (vulkan_globals.vk_cmd_begin_debug_utils_label)
-		vulkan_globals.vk_cmd_begin_debug_utils_label(vulkan_globals.command_buffer, &label);
+		vulkan_globals.vk_cmd_begin_debug_utils_label(vulkan_recording.command_buffer, &label);
 #endif
 }
 
@@ -525,7 +563,7 @@ static inline void R_EndDebugUtilsLabel()
 {
 #ifdef _DEBUG
 	if (vulkan_globals.vk_cmd_end_debug_utils_label)
-		vulkan_globals.vk_cmd_end_debug_utils_label(vulkan_globals.command_buffer);
+		vulkan_globals.vk_cmd_end_debug_utils_label(vulkan_recording.command_buffer);
 #endif
 }
 
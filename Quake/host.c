@@ -181,6 +181,7 @@ void Host_Error (const char *error, ...)
 	inerror = true;
 
 	PR_SwitchQCVM(NULL);
+	Memory_SetTag (MEMTAG_MISC);	// in case a tagged load was interrupted
 
 	SCR_EndLoadingPlaque ();		// reenable screen updates
 
@@ -341,6 +342,7 @@ void Host_WriteConfiguration (void)
 			Con_Printf ("Couldn't write config.cfg.\n");
 			return;
 		}
+		COM_AddDirectoryFile (va("%s/config.cfg", com_gamedir));
 
 		//VID_SyncCvars (); //johnfitz -- write actual current mode to config file, in case cvars were messed with
 
@@ -930,6 +932,9 @@ void _Host_Frame (double time)
 					pass1+pass2+pass3, pass1, pass2, pass3);
 	}
 
+	Jobs_EndFrame ();
+	Memory_EndFrame ();
+
 	host_framecount++;
 
 }
@@ -998,6 +1003,7 @@ void Host_Init (void)
 	COM_Init ();
 	COM_InitFilesystem ();
 	Host_InitLocal ();
+	Jobs_Init ();
 	W_LoadWadFile (); //johnfitz -- filename is now hard-coded for honesty
 	if (cls.state != ca_dedicated)
 	{
@@ -1089,6 +1095,7 @@ void Host_Shutdown(void)
 	Host_WriteConfiguration ();
 
 	NET_Shutdown ();
+	Jobs_Shutdown ();
 
 	if (cls.state != ca_dedicated)
 	{
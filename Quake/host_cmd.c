@@ -926,7 +926,11 @@ static void Host_Changelevel_f (void)
 	//johnfitz -- check for client having map before anything else
 	q_snprintf (level, sizeof(level), "maps/%s.bsp", Cmd_Argv(1));
 	if (!COM_FileExists(level, NULL))
-		Host_Error ("cannot find map %s", level);
+	{	// may have been added since the game directories were listed
+		COM_FlushDirectoryCache ();
+		if (!COM_FileExists(level, NULL))
+			Host_Error ("cannot find map %s", level);
+	}
 	//johnfitz
 
 	if (cls.state != ca_dedicated)
@@ -1125,6 +1129,7 @@ static void Host_Savegame_f (void)
 		Con_Printf ("ERROR: couldn't open.\n");
 		return;
 	}
+	COM_AddDirectoryFile (name);
 
 	PR_SwitchQCVM(&sv.qcvm);
 
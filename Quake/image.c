@@ -177,6 +177,7 @@ qboolean Image_WriteTGA (const char *name, byte *data, int width, int height, in
 	Sys_FileWrite (handle, header, TARGAHEADERSIZE);
 	Sys_FileWrite (handle, data, size);
 	Sys_FileClose (handle);
+	COM_AddDirectoryFile (pathname);
 
 	return true;
 }
@@ -537,6 +538,8 @@ qboolean Image_WriteJPG (const char *name, byte *data, int width, int height, in
 	error = stbi_write_jpg (pathname, width, height, bytes_per_pixel, flipped, quality);
 	if (!upsidedown)
 		free (flipped);
+	if (error != 0)
+		COM_AddDirectoryFile (pathname);
 
 	return (error != 0);
 }
@@ -587,7 +590,8 @@ qboolean Image_WritePNG (const char *name, byte *data, int width, int height, in
 	}
 
 	error = lodepng_encode (&png, &pngsize, flipped, width, height, &state);
-	if (error == 0) lodepng_save_file (png, pngsize, pathname);
+	if (error == 0) error = lodepng_save_file (png, pngsize, pathname);
+	if (error == 0) COM_AddDirectoryFile (pathname);
 #ifdef LODEPNG_COMPILE_ERROR_TEXT
 	else Con_Printf("WritePNG: %s\n", lodepng_error_text (error));
 #endif
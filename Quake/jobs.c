@@ -0,0 +1,705 @@
+/*
+Copyright (C) 2016-2021 vkQuake developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+// jobs.c -- worker thread pool and job scheduler
+
+#include "quakedef.h"
+
+#if defined(SDL_FRAMEWORK) || defined(NO_SDL_CONFIG)
+#include <SDL2/SDL.h>
+#else
+#include "SDL.h"
+#endif
+
+#define MAX_JOBS		1024	// must be a power of two
+#define MAX_JOB_DEPENDENTS	32
+#define JOB_DEQUE_SIZE		4096	// must be a power of two
+#define JOB_JOIN_SPINS		256
+
+typedef struct job_s
+{
+	SDL_atomic_t		epoch;			// bumped every time the slot is recycled
+	SDL_atomic_t		done;
+	SDL_atomic_t		deps_remaining;		// unfinished dependencies + 1 until submitted
+	SDL_atomic_t		next_index;
+	SDL_atomic_t		indices_remaining;
+	SDL_atomic_t		entries_remaining;	// deque entries not yet retired
+	SDL_SpinLock		lock;			// guards done and the dependents list
+	int			num_dependents;
+	int			dependents[MAX_JOB_DEPENDENTS];
+	job_func_t		func;
+	job_indexed_func_t	indexed_func;
+	int			limit;
+	union
+	{
+		double	align;
+		byte	bytes[MAX_JOB_PAYLOAD];
+	} payload;
+} job_t;
+
+typedef struct
+{
+	SDL_SpinLock	lock;
+	int		top;		// thieves take from here
+	int		bottom;		// owner pushes and pops here
+	int		entries[JOB_DEQUE_SIZE];
+} jobdeque_t;
+
+typedef struct
+{
+	// written only by the owning thread, read by Jobs_EndFrame
+	double	busy_time;
+	int	jobs_run;
+	int	steals;
+
+	// previous totals, main thread only
+	double	last_busy_time;
+	int	last_jobs_run;
+	int	last_steals;
+
+	// last frame
+	float	utilisation;
+	int	frame_jobs_run;
+	int	frame_steals;
+} jobstats_t;
+
+static job_t		jobs[MAX_JOBS];
+static jobdeque_t	deques[MAX_JOB_THREADS];
+static jobstats_t	stats[MAX_JOB_THREADS];
+static SDL_Thread	*workers[MAX_JOB_THREADS];
+static int		num_threads = 1;
+
+static SDL_SpinLock	free_lock;
+static int		free_jobs[MAX_JOBS];
+static int		num_free_jobs;
+
+static SDL_sem		*work_sem;		// posted once per pushed deque entry
+static SDL_mutex	*done_mutex;
+static SDL_cond		*done_cond;		// broadcast whenever a job completes
+static SDL_atomic_t	shutting_down;
+
+static SDL_atomic_t	queue_depth;
+static SDL_atomic_t	peak_queue_depth;
+static SDL_atomic_t	jobs_submitted;
+static int		last_jobs_submitted;
+static int		frame_jobs_submitted;
+static int		frame_peak_queue_depth;
+static double		last_frame_time;
+static double		frame_duration;
+
+static THREAD_LOCAL int	thread_index;
+
+static void Job_Enqueue (int index);
+
+/*
+================================================================================
+
+	DEQUES
+
+================================================================================
+*/
+
+/*
+===============
+Deque_PushBottom
+===============
+*/
+static qboolean Deque_PushBottom (jobdeque_t *deque, int entry)
+{
+	SDL_AtomicLock (&deque->lock);
+	if (deque->bottom - deque->top >= JOB_DEQUE_SIZE)
+	{
+		SDL_AtomicUnlock (&deque->lock);
+		return false;
+	}
+	deque->entries[deque->bottom & (JOB_DEQUE_SIZE - 1)] = entry;
+	deque->bottom++;
+	SDL_AtomicUnlock (&deque->lock);
+	return true;
+}
+
+/*
+===============
+Deque_PopBottom
+===============
+*/
+static qboolean Deque_PopBottom (jobdeque_t *deque, int *entry)
+{
+	SDL_AtomicLock (&deque->lock);
+	if (deque->bottom == deque->top)
+	{
+		SDL_AtomicUnlock (&deque->lock);
+		return false;
+	}
+	deque->bottom--;
+	*entry = deque->entries[deque->bottom & (JOB_DEQUE_SIZE - 1)];
+	SDL_AtomicUnlock (&deque->lock);
+	return true;
+}
+
+/*
+===============
+Deque_StealTop
+===============
+*/
+static qboolean Deque_StealTop (jobdeque_t *deque, int *entry)
+{
+	if (!SDL_AtomicTryLock (&deque->lock))
+		return false;
+	if (deque->bottom == deque->top)
+	{
+		SDL_AtomicUnlock (&deque->lock);
+		return false;
+	}
+	*entry = deque->entries[deque->top & (JOB_DEQUE_SIZE - 1)];
+	deque->top++;
+	SDL_AtomicUnlock (&deque->lock);
+	return true;
+}
+
+/*
+================================================================================
+
+	SCHEDULER
+
+================================================================================
+*/
+
+/*
+===============
+Job_Handle
+===============
+*/
+static inline job_handle_t Job_Handle (int index)
+{
+	return ((uint64_t)(uint32_t)SDL_AtomicGet (&jobs[index].epoch) << 32) | (uint32_t)index;
+}
+
+/*
+===============
+Job_FromHandle
+
+returns NULL if the job the handle refers to has already been recycled
+===============
+*/
+static inline job_t *Job_FromHandle (job_handle_t handle)
+{
+	job_t *job = &jobs[handle & (MAX_JOBS - 1)];
+	if ((uint32_t)SDL_AtomicGet (&job->epoch) != (uint32_t)(handle >> 32))
+		return NULL;
+	return job;
+}
+
+/*
+===============
+Job_Free
+===============
+*/
+static void Job_Free (int index)
+{
+	SDL_AtomicAdd (&jobs[index].epoch, 1);
+	SDL_AtomicLock (&free_lock);
+	free_jobs[num_free_jobs++] = index;
+	SDL_AtomicUnlock (&free_lock);
+}
+
+/*
+===============
+Job_Complete
+
+marks the job done and releases everything that was waiting on it
+===============
+*/
+static void Job_Complete (int index)
+{
+	job_t	*job = &jobs[index];
+	int	dependents[MAX_JOB_DEPENDENTS];
+	int	i, num_dependents;
+
+	SDL_AtomicLock (&job->lock);
+	SDL_AtomicSet (&job->done, 1);
+	num_dependents = job->num_dependents;
+	memcpy (dependents, job->dependents, num_dependents * sizeof (int));
+	SDL_AtomicUnlock (&job->lock);
+
+	for (i = 0; i < num_dependents; i++)
+		if (SDL_AtomicAdd (&jobs[dependents[i]].deps_remaining, -1) == 1)
+			Job_Enqueue (dependents[i]);
+
+	SDL_LockMutex (done_mutex);
+	SDL_CondBroadcast (done_cond);
+	SDL_UnlockMutex (done_mutex);
+}
+
+/*
+===============
+Job_RunEntry
+
+runs as many indices of the job as this thread can claim
+===============
+*/
+static void Job_RunEntry (int index)
+{
+	job_t	*job = &jobs[index];
+	int	i, finished = 0;
+	int	mark = Scratch_Mark ();	// may be inside a Job_Join with scratch in use
+
+	while ((i = SDL_AtomicAdd (&job->next_index, 1)) < job->limit)
+	{
+		if (job->indexed_func)
+			job->indexed_func (i, job->payload.bytes);
+		else
+			job->func (job->payload.bytes);
+		Scratch_FreeToMark (mark);
+		finished++;
+	}
+
+	if (finished && SDL_AtomicAdd (&job->indices_remaining, -finished) == finished)
+		Job_Complete (index);
+
+	if (SDL_AtomicAdd (&job->entries_remaining, -1) == 1)
+		Job_Free (index);
+}
+
+/*
+===============
+Job_Enqueue
+
+all dependencies are done: push one deque entry per thread that can help
+===============
+*/
+static void Job_Enqueue (int index)
+{
+	job_t	*job = &jobs[index];
+	int	i, depth, peak, num_entries;
+
+	if (!job->func && !job->indexed_func)
+	{
+		Job_Complete (index);
+		Job_Free (index);
+		return;
+	}
+
+	num_entries = q_min (job->limit, num_threads);
+	SDL_AtomicSet (&job->entries_remaining, num_entries);
+	for (i = 0; i < num_entries; i++)
+	{
+		depth = SDL_AtomicAdd (&queue_depth, 1) + 1;
+		if (!Deque_PushBottom (&deques[thread_index], index))
+		{
+			// deque is full, don't lose the entry
+			SDL_AtomicAdd (&queue_depth, -1);
+			Job_RunEntry (index);
+			continue;
+		}
+
+		while (depth > (peak = SDL_AtomicGet (&peak_queue_depth)))
+			if (SDL_AtomicCAS (&peak_queue_depth, peak, depth))
+				break;
+		SDL_SemPost (work_sem);
+	}
+}
+
+/*
+===============
+Jobs_RunOne
+
+pops an entry from our own deque or steals one from somebody else's
+===============
+*/
+static qboolean Jobs_RunOne (void)
+{
+	int		i, entry;
+	qboolean	stolen = false;
+	double		time1;
+
+	if (!Deque_PopBottom (&deques[thread_index], &entry))
+	{
+		for (i = 1; i < num_threads; i++)
+		{
+			if (Deque_StealTop (&deques[(thread_index + i) % num_threads], &entry))
+			{
+				stolen = true;
+				break;
+			}
+		}
+		if (!stolen)
+			return false;
+	}
+	SDL_AtomicAdd (&queue_depth, -1);
+
+	time1 = Sys_DoubleTime ();
+	Job_RunEntry (entry);
+	stats[thread_index].busy_time += Sys_DoubleTime () - time1;
+	stats[thread_index].jobs_run++;
+	if (stolen)
+		stats[thread_index].steals++;
+
+	return true;
+}
+
+/*
+===============
+Jobs_Worker
+===============
+*/
+static int SDLCALL Jobs_Worker (void *data)
+{
+	thread_index = (int)(intptr_t)data;
+
+	for (;;)
+	{
+		SDL_SemWait (work_sem);
+		if (SDL_AtomicGet (&shutting_down))
+			break;
+		Jobs_RunOne ();
+	}
+
+	return 0;
+}
+
+/*
+================================================================================
+
+	API
+
+================================================================================
+*/
+
+/*
+===============
+Job_Allocate
+===============
+*/
+job_handle_t Job_Allocate (void)
+{
+	job_t	*job;
+	int	index = -1;
+
+	while (index < 0)
+	{
+		SDL_AtomicLock (&free_lock);
+		if (num_free_jobs > 0)
+			index = free_jobs[--num_free_jobs];
+		SDL_AtomicUnlock (&free_lock);
+
+		// out of slots: help drain the queues until one frees up
+		if (index < 0 && !Jobs_RunOne ())
+			SDL_Delay (0);
+	}
+
+	job = &jobs[index];
+	SDL_AtomicSet (&job->done, 0);
+	SDL_AtomicSet (&job->deps_remaining, 1);
+	SDL_AtomicSet (&job->next_index, 0);
+	SDL_AtomicSet (&job->indices_remaining, 0);
+	SDL_AtomicSet (&job->entries_remaining, 0);
+	job->num_dependents = 0;
+	job->func = NULL;
+	job->indexed_func = NULL;
+	job->limit = 0;
+
+	return Job_Handle (index);
+}
+
+/*
+===============
+Job_AssignFunc
+===============
+*/
+void Job_AssignFunc (job_handle_t handle, job_func_t func, const void *payload, size_t payload_size)
+{
+	job_t *job = &jobs[handle & (MAX_JOBS - 1)];
+
+	if (payload_size > MAX_JOB_PAYLOAD)
+		Sys_Error ("Job_AssignFunc: payload too large (%i bytes)", (int)payload_size);
+
+	job->func = func;
+	job->limit = 1;
+	SDL_AtomicSet (&job->indices_remaining, 1);
+	if (payload_size)
+		memcpy (job->payload.bytes, payload, payload_size);
+}
+
+/*
+===============
+Job_AssignIndexedFunc
+===============
+*/
+void Job_AssignIndexedFunc (job_handle_t handle, job_indexed_func_t func, int limit, const void *payload, size_t payload_size)
+{
+	job_t *job = &jobs[handle & (MAX_JOBS - 1)];
+
+	if (payload_size > MAX_JOB_PAYLOAD)
+		Sys_Error ("Job_AssignIndexedFunc: payload too large (%i bytes)", (int)payload_size);
+
+	job->indexed_func = limit > 0 ? func : NULL;
+	job->limit = q_max (limit, 0);
+	SDL_AtomicSet (&job->indices_remaining, job->limit);
+	if (payload_size)
+		memcpy (job->payload.bytes, payload, payload_size);
+}
+
+/*
+===============
+Job_AddDependency
+
+"after" will not start before "before" has finished.  Must be called
+before "after" is submitted.
+===============
+*/
+void Job_AddDependency (job_handle_t before, job_handle_t after)
+{
+	job_t	*job = Job_FromHandle (before);
+	int	after_index = after & (MAX_JOBS - 1);
+
+	if (!job)
+		return;
+
+	SDL_AtomicLock (&job->lock);
+	if (!SDL_AtomicGet (&job->done) && Job_FromHandle (before))
+	{
+		if (job->num_dependents == MAX_JOB_DEPENDENTS)
+			Sys_Error ("Job_AddDependency: too many dependents");
+		job->dependents[job->num_dependents++] = after_index;
+		SDL_AtomicAdd (&jobs[after_index].deps_remaining, 1);
+	}
+	SDL_AtomicUnlock (&job->lock);
+}
+
+/*
+===============
+Job_Submit
+===============
+*/
+void Job_Submit (job_handle_t handle)
+{
+	int index = handle & (MAX_JOBS - 1);
+
+	SDL_AtomicAdd (&jobs_submitted, 1);
+	if (SDL_AtomicAdd (&jobs[index].deps_remaining, -1) == 1)
+		Job_Enqueue (index);
+}
+
+/*
+===============
+Job_IsComplete
+===============
+*/
+qboolean Job_IsComplete (job_handle_t handle)
+{
+	job_t *job = Job_FromHandle (handle);
+	return !job || SDL_AtomicGet (&job->done);
+}
+
+/*
+===============
+Job_Join
+
+waits for the job, running pending jobs on this thread in the meantime
+===============
+*/
+void Job_Join (job_handle_t handle)
+{
+	int spins = 0;
+
+	while (!Job_IsComplete (handle))
+	{
+		if (Jobs_RunOne ())
+		{
+			spins = 0;
+			continue;
+		}
+		if (++spins < JOB_JOIN_SPINS)
+			continue;
+
+		SDL_LockMutex (done_mutex);
+		if (!Job_IsComplete (handle))
+			SDL_CondWaitTimeout (done_cond, done_mutex, 1);
+		SDL_UnlockMutex (done_mutex);
+	}
+}
+
+/*
+===============
+Jobs_ParallelFor
+===============
+*/
+void Jobs_ParallelFor (job_indexed_func_t func, int limit, const void *payload, size_t payload_size)
+{
+	job_handle_t job;
+
+	if (limit <= 0)
+		return;
+
+	job = Job_Allocate ();
+	Job_AssignIndexedFunc (job, func, limit, payload, payload_size);
+	Job_Submit (job);
+	Job_Join (job);
+}
+
+/*
+===============
+Jobs_NumThreads
+===============
+*/
+int Jobs_NumThreads (void)
+{
+	return num_threads;
+}
+
+/*
+===============
+Jobs_ThreadIndex
+===============
+*/
+int Jobs_ThreadIndex (void)
+{
+	return thread_index;
+}
+
+/*
+================================================================================
+
+	STATS
+
+================================================================================
+*/
+
+/*
+===============
+Jobs_EndFrame
+===============
+*/
+void Jobs_EndFrame (void)
+{
+	double		time = Sys_DoubleTime ();
+	jobstats_t	*s;
+	int		i, submitted;
+
+	frame_duration = time - last_frame_time;
+	last_frame_time = time;
+
+	for (i = 0; i < num_threads; i++)
+	{
+		s = &stats[i];
+		s->utilisation = frame_duration > 0 ? (s->busy_time - s->last_busy_time) / frame_duration : 0;
+		s->frame_jobs_run = s->jobs_run - s->last_jobs_run;
+		s->frame_steals = s->steals - s->last_steals;
+		s->last_busy_time = s->busy_time;
+		s->last_jobs_run = s->jobs_run;
+		s->last_steals = s->steals;
+	}
+
+	submitted = SDL_AtomicGet (&jobs_submitted);
+	frame_jobs_submitted = submitted - last_jobs_submitted;
+	last_jobs_submitted = submitted;
+	frame_peak_queue_depth = SDL_AtomicSet (&peak_queue_depth, SDL_AtomicGet (&queue_depth));
+}
+
+/*
+===============
+Jobs_Stats_f
+===============
+*/
+static void Jobs_Stats_f (void)
+{
+	int i;
+
+	Con_Printf ("%i threads, %i jobs submitted last frame (%.2f ms)\n",
+		num_threads, frame_jobs_submitted, frame_duration * 1000.0);
+	Con_Printf ("queue depth: %i now, %i peak\n",
+		SDL_AtomicGet (&queue_depth), frame_peak_queue_depth);
+	for (i = 0; i < num_threads; i++)
+	{
+		Con_Printf ("%-6s %2i: %5.1f%% busy, %4i entries, %4i stolen\n",
+			i ? "worker" : "main", i, stats[i].utilisation * 100.0f,
+			stats[i].frame_jobs_run, stats[i].frame_steals);
+	}
+}
+
+/*
+================================================================================
+
+	INIT / SHUTDOWN
+
+================================================================================
+*/
+
+/*
+===============
+Jobs_Init
+===============
+*/
+void Jobs_Init (void)
+{
+	int	i;
+	char	name[32];
+
+	Cmd_AddCommand ("jobs_stats", Jobs_Stats_f);
+
+	for (i = 0; i < MAX_JOBS; i++)
+		free_jobs[i] = MAX_JOBS - 1 - i;
+	num_free_jobs = MAX_JOBS;
+
+	work_sem = SDL_CreateSemaphore (0);
+	done_mutex = SDL_CreateMutex ();
+	done_cond = SDL_CreateCond ();
+	if (!work_sem || !done_mutex || !done_cond)
+		Sys_Error ("Jobs_Init: %s", SDL_GetError ());
+
+	// one worker per core next to the main thread
+	num_threads = host_parms->numcpus;
+	i = COM_CheckParm ("-jobthreads");
+	if (i && i < com_argc - 1)
+		num_threads = Q_atoi (com_argv[i + 1]) + 1;
+	num_threads = CLAMP (1, num_threads, MAX_JOB_THREADS);
+
+	thread_index = 0;
+	for (i = 1; i < num_threads; i++)
+	{
+		q_snprintf (name, sizeof (name), "Job worker %i", i);
+		workers[i] = SDL_CreateThread (Jobs_Worker, name, (void *)(intptr_t)i);
+		if (!workers[i])
+			Sys_Error ("Jobs_Init: %s", SDL_GetError ());
+	}
+
+	last_frame_time = Sys_DoubleTime ();
+	Con_Printf ("Job system: %i worker threads\n", num_threads - 1);
+}
+
+/*
+===============
+Jobs_Shutdown
+===============
+*/
+void Jobs_Shutdown (void)
+{
+	int i;
+
+	if (!work_sem)
+		return;
+
+	SDL_AtomicSet (&shutting_down, 1);
+	for (i = 1; i < num_threads; i++)
+		SDL_SemPost (work_sem);
+	for (i = 1; i < num_threads; i++)
+		SDL_WaitThread (workers[i], NULL);
+	num_threads = 1;
+}
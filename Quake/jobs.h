@@ -0,0 +1,79 @@
+/*
+Copyright (C) 2016-2021 vkQuake developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#ifndef _QUAKE_JOBS_H
+#define _QUAKE_JOBS_H
+
+// jobs.h -- worker thread pool and job scheduler
+
+/*
+ job system
+
+A fixed pool of worker threads is started by Jobs_Init.  Every thread (the
+main thread included) owns a deque of runnable jobs: the owner pushes and
+pops at the bottom, idle threads steal from the top of other deques.
+
+A job is allocated, given a function and an optional payload (copied into
+the job), optionally linked to other jobs with Job_AddDependency, and then
+handed to the scheduler with Job_Submit.  A job is not run before all jobs
+it depends on have finished.
+
+Indexed jobs are parallel-for loops: the function is called once for every
+index in [0, limit) from however many threads pick the job up.  Callers
+pick the granularity by choosing what an index stands for.
+
+A job without a function is a fence: it completes as soon as its
+dependencies did, so joining it waits for a whole group of jobs.
+
+Job_Join waits for a job, running other pending jobs on the calling thread
+while it does.  Every submitted job must eventually be joined, directly or
+through a fence, otherwise it may never run when there are no workers.
+
+Job functions run on arbitrary threads: they must not call Host_Error,
+touch the hunk, or print to the console.  They may use the zone, and
+Scratch_Alloc for temporaries that are released once the function returns.
+*/
+
+#define MAX_JOB_THREADS		32	// main thread included
+#define MAX_JOB_PAYLOAD		256
+
+typedef uint64_t job_handle_t;
+typedef void (*job_func_t) (void *payload);
+typedef void (*job_indexed_func_t) (int index, void *payload);
+
+void Jobs_Init (void);
+void Jobs_Shutdown (void);
+void Jobs_EndFrame (void);		// rolls the per-frame stats shown by jobs_stats
+
+int Jobs_NumThreads (void);		// workers + the main thread
+int Jobs_ThreadIndex (void);		// 0 on the main thread, 1..Jobs_NumThreads()-1 on workers
+
+job_handle_t Job_Allocate (void);
+void Job_AssignFunc (job_handle_t job, job_func_t func, const void *payload, size_t payload_size);
+void Job_AssignIndexedFunc (job_handle_t job, job_indexed_func_t func, int limit, const void *payload, size_t payload_size);
+void Job_AddDependency (job_handle_t before, job_handle_t after);
+void Job_Submit (job_handle_t job);
+qboolean Job_IsComplete (job_handle_t job);
+void Job_Join (job_handle_t job);
+
+void Jobs_ParallelFor (job_indexed_func_t func, int limit, const void *payload, size_t payload_size);
+// allocates, submits and joins a single indexed job
+
+#endif	/* _QUAKE_JOBS_H */
@@ -144,6 +144,9 @@ qboolean IsOriginWithinMinMax(vec3_t origin, vec3_t mins, vec3_t maxs);
 	#define USE_SIMD
 	#define USE_SSE2
 	#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+	#define USE_NEON	// lightmap kernels only, always available when the compiler targets it
+	#include <arm_neon.h>
 #endif
 
 /*==========================================================================*/
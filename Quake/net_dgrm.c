@@ -1637,7 +1637,9 @@ static void _Datagram_AddPossibleHost(struct qsockaddr *addr, qboolean master)
 	if (hostlist_count == hostlist_max)
 	{
 		hostlist_max = hostlist_count + 16;
+		memtag_t tag = Memory_SetTag (MEMTAG_NETWORK);
 		hostlist = Z_Realloc(hostlist, sizeof(*hostlist)*hostlist_max);
+		Memory_SetTag (tag);
 	}
 	hostlist[hostlist_count].addr = *addr;
 	hostlist[hostlist_count].requery = true;
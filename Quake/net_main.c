@@ -832,6 +832,7 @@ void NET_Init (void)
 {
 	int			i;
 	qsocket_t	*s;
+	memtag_t	tag;
 
 	i = COM_CheckParm ("-port");
 	if (!i)
@@ -856,6 +857,7 @@ void NET_Init (void)
 
 	SetNetTime();
 
+	tag = Memory_SetTag (MEMTAG_NETWORK);
 	for (i = 0; i < net_numsockets; i++)
 	{
 		s = (qsocket_t *)Hunk_AllocName(sizeof(qsocket_t), "qsocket");
@@ -866,6 +868,7 @@ void NET_Init (void)
 
 	// allocate space for network message buffer
 	SZ_Alloc (&net_message, NET_MAXMESSAGE);
+	Memory_SetTag (tag);
 
 	Cvar_RegisterVariable (&net_messagetimeout);
 	Cvar_RegisterVariable (&net_connecttimeout);
@@ -1541,6 +1541,8 @@ void PF_changeyaw (void)
 			move = -speed;
 	}
 
+	if (sv_predictingmoves)
+		SV_MoveChanged (ent);
 	ent->v.angles[1] = anglemod (current + move);
 }
 
@@ -168,6 +168,89 @@ static ddef_t *ED_FieldAtOfs (int ofs)
 	return NULL;
 }
 
+/*
+============
+PR_HashInit
+============
+*/
+static void PR_HashInit (prhash_t *hash, int count)
+{
+	int		size;
+
+	free (hash->heads);
+	for (size = 64; size < count; size <<= 1)
+		;
+	hash->mask = size - 1;
+	hash->heads = (int *) calloc (size + count, sizeof(int));
+	if (!hash->heads)
+		Sys_Error ("PR_HashInit: out of memory");
+	hash->next = hash->heads + size;
+}
+
+/*
+============
+PR_HashFree
+============
+*/
+static void PR_HashFree (prhash_t *hash)
+{
+	free (hash->heads);
+	hash->heads = hash->next = NULL;
+}
+
+/*
+============
+PR_HashFields
+
+also called again once the engine has added its fields. defs go in last
+to first, so the first def of a name is found first as with the old scans
+============
+*/
+static void PR_HashFields (void)
+{
+	prhash_t	*hash = &qcvm->fieldhash;
+	int			i, b;
+
+	PR_HashInit (hash, qcvm->progs->numfielddefs);
+	for (i = qcvm->progs->numfielddefs - 1; i >= 0; i--)
+	{
+		b = COM_HashString (PR_GetString(qcvm->fielddefs[i].s_name)) & hash->mask;
+		hash->next[i] = hash->heads[b];
+		hash->heads[b] = i + 1;
+	}
+}
+
+/*
+============
+PR_HashDefs
+============
+*/
+static void PR_HashDefs (void)
+{
+	prhash_t	*hash;
+	int			i, b;
+
+	PR_HashFields ();
+
+	hash = &qcvm->globalhash;
+	PR_HashInit (hash, qcvm->progs->numglobaldefs);
+	for (i = qcvm->progs->numglobaldefs - 1; i >= 0; i--)
+	{
+		b = COM_HashString (PR_GetString(qcvm->globaldefs[i].s_name)) & hash->mask;
+		hash->next[i] = hash->heads[b];
+		hash->heads[b] = i + 1;
+	}
+
+	hash = &qcvm->functionhash;
+	PR_HashInit (hash, qcvm->progs->numfunctions);
+	for (i = qcvm->progs->numfunctions - 1; i >= 0; i--)
+	{
+		b = COM_HashString (PR_GetString(qcvm->functions[i].s_name)) & hash->mask;
+		hash->next[i] = hash->heads[b];
+		hash->heads[b] = i + 1;
+	}
+}
+
 /*
 ============
 ED_FindField
@@ -175,12 +258,13 @@ ED_FindField
 */
 ddef_t *ED_FindField (const char *name)
 {
+	prhash_t	*hash = &qcvm->fieldhash;
 	ddef_t		*def;
 	int			i;
 
-	for (i = 0; i < qcvm->progs->numfielddefs; i++)
+	for (i = hash->heads[COM_HashString (name) & hash->mask]; i; i = hash->next[i - 1])
 	{
-		def = &qcvm->fielddefs[i];
+		def = &qcvm->fielddefs[i - 1];
 		if ( !strcmp(PR_GetString(def->s_name), name) )
 			return def;
 	}
@@ -204,12 +288,13 @@ ED_FindGlobal
 */
 ddef_t *ED_FindGlobal (const char *name)
 {
+	prhash_t	*hash = &qcvm->globalhash;
 	ddef_t		*def;
 	int			i;
 
-	for (i = 0; i < qcvm->progs->numglobaldefs; i++)
+	for (i = hash->heads[COM_HashString (name) & hash->mask]; i; i = hash->next[i - 1])
 	{
-		def = &qcvm->globaldefs[i];
+		def = &qcvm->globaldefs[i - 1];
 		if ( !strcmp(PR_GetString(def->s_name), name) )
 			return def;
 	}
@@ -224,12 +309,13 @@ ED_FindFunction
 */
 dfunction_t *ED_FindFunction (const char *fn_name)
 {
+	prhash_t		*hash = &qcvm->functionhash;
 	dfunction_t		*func;
 	int				i;
 
-	for (i = 0; i < qcvm->progs->numfunctions; i++)
+	for (i = hash->heads[COM_HashString (fn_name) & hash->mask]; i; i = hash->next[i - 1])
 	{
-		func = &qcvm->functions[i];
+		func = &qcvm->functions[i - 1];
 		if ( !strcmp(PR_GetString(func->s_name), fn_name) )
 			return func;
 	}
@@ -742,6 +828,7 @@ static void ED_RezoneString (string_t *ref, const char *str)
 	char *buf;
 	size_t len = strlen(str)+1;
 	size_t id;
+	memtag_t tag;
 
 	if (*ref)
 	{	//if the reference is already a zoned string then free it first.
@@ -757,6 +844,7 @@ static void ED_RezoneString (string_t *ref, const char *str)
 //			Con_Warning("ED_RezoneString: string wasn't strzoned\n");	//warnings would trigger from the default cvar value that autocvars are initialised with
 	}
 
+	tag = Memory_SetTag (MEMTAG_PROGS);
 	buf = Z_Malloc(len);
 	memcpy(buf, str, len);
 	id = -1-(*ref = PR_SetEngineString(buf));
@@ -767,6 +855,7 @@ static void ED_RezoneString (string_t *ref, const char *str)
 		qcvm->knownzone = Z_Realloc(qcvm->knownzone, (qcvm->knownzonesize+7)>>3);
 	}
 	qcvm->knownzone[id>>3] |= 1u<<(id&7);
+	Memory_SetTag (tag);
 }
 
 /*
@@ -1109,6 +1198,11 @@ void PR_ClearProgs(qcvm_t *vm)
 	if (qcvm->fielddefs != (ddef_t *)((byte *)qcvm->progs + qcvm->progs->ofs_fielddefs))
 		free(qcvm->fielddefs);
 	free(qcvm->progs);	// spike -- pr_progs switched to use malloc (so menuqc doesn't end up stuck on the early hunk nor wiped on every map change)
+	free(qcvm->decoded);
+	PR_HashFree (&qcvm->fieldhash);
+	PR_HashFree (&qcvm->globalhash);
+	PR_HashFree (&qcvm->functionhash);
+	PR_ProfileClear ();
 	memset(qcvm, 0, sizeof(*qcvm));
 
 	qcvm = NULL;
@@ -1194,6 +1288,7 @@ static void PR_MergeEngineFieldDefs (void)
 			}
 		}
 		qcvm->progs->entityfields = maxofs;
+		PR_HashFields ();
 	}
 }
 
@@ -1349,6 +1444,8 @@ qboolean PR_LoadProgs (const char *filename, qboolean fatal, unsigned int needcr
 	memcpy(qcvm->builtins, builtins, numbuiltins*sizeof(qcvm->builtins[0]));
 	qcvm->numbuiltins = numbuiltins;
 
+	PR_HashDefs();
+
 	//spike: detect extended fields from progs
 	PR_MergeEngineFieldDefs();
 #define QCEXTFIELD(n,t) qcvm->extfields.n = ED_FindFieldOffset(#n);
@@ -1367,6 +1464,7 @@ qboolean PR_LoadProgs (const char *filename, qboolean fatal, unsigned int needcr
 	PR_SetEngineString("");
 	PR_EnableExtensions(qcvm->globaldefs);
 	PR_PatchRereleaseBuiltins();
+	PR_DecodeStatements();
 
 	return true;
 }
@@ -1383,6 +1481,8 @@ void PR_Init (void)
 	Cmd_AddCommand ("edicts", ED_PrintEdicts);
 	Cmd_AddCommand ("edictcount", ED_Count);
 	Cmd_AddCommand ("profile", PR_Profile_f);
+	Cvar_RegisterVariable (&pr_profile);
+	Cvar_RegisterVariable (&pr_optimize);
 	Cmd_AddCommand ("pr_dumpplatform", PR_DumpPlatform_f);
 	Cvar_RegisterVariable (&nomonsters);
 	Cvar_RegisterVariable (&gamecfg);
@@ -1426,9 +1526,13 @@ int NUM_FOR_EDICT(edict_t *e)
 
 static void PR_AllocStringSlots (void)
 {
+	memtag_t	tag;
+
 	qcvm->maxknownstrings += PR_STRING_ALLOCSLOTS;
 	Con_DPrintf2("PR_AllocStringSlots: realloc'ing for %d slots\n", qcvm->maxknownstrings);
+	tag = Memory_SetTag (MEMTAG_PROGS);
 	qcvm->knownstrings = (const char **) Z_Realloc ((void *)qcvm->knownstrings, qcvm->maxknownstrings * sizeof(char *));
+	Memory_SetTag (tag);
 }
 
 const char *PR_GetString (int num)
@@ -1506,6 +1610,7 @@ int PR_SetEngineString (const char *s)
 int PR_AllocString (int size, char **ptr)
 {
 	int		i;
+	memtag_t	tag;
 
 	if (!size)
 		return 0;
@@ -1520,7 +1625,9 @@ int PR_AllocString (int size, char **ptr)
 			PR_AllocStringSlots();
 		qcvm->numknownstrings++;
 //	}
+	tag = Memory_SetTag (MEMTAG_PROGS);
 	qcvm->knownstrings[i] = (char *)Hunk_AllocName(size, "string");
+	Memory_SetTag (tag);
 	if (ptr)
 		*ptr = (char *) qcvm->knownstrings[i];
 	return -1 - i;
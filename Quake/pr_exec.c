@@ -21,6 +21,9 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "quakedef.h"
 
+cvar_t	pr_profile = {"pr_profile", "0", CVAR_NONE};	// run progs in the slower loop that counts statements per function
+cvar_t	pr_optimize = {"pr_optimize", "1", CVAR_NONE};	// fuse statements when progs are loaded
+
 static const char *pr_opnames[] =
 {
 	"DONE",
@@ -188,45 +191,378 @@ static void PR_StackTrace (void)
 }
 
 
+/*
+==============================================================================
+
+						PROFILER
+
+While pr_profile is set the progs run in PR_ExecuteChecked and every QC
+function and builtin call is timed into a calling context tree, one node per
+distinct call stack with its calls, statements, and the time spent in the
+function itself (self) and with its callees (total). Per function figures
+and the collapsed stacks that flamegraph tools read are derived from the
+tree when asked for.
+==============================================================================
+*/
+#define	PR_MAXPROFNODES		65536
+#define	PR_MAXPROFDEPTH		(MAX_STACK_DEPTH * 2)	// QC calls with builtins between them
+
+typedef struct
+{
+	int		func;
+	int		parent, child, sibling;	// 0 for none, node 0 is the root
+	int		calls, statements;
+	double	self, total;
+} prprofnode_t;
+
+typedef struct prprofile_s
+{
+	prprofnode_t	*nodes;
+	int			numnodes, maxnodes;
+	qboolean	truncated;			// ran out of nodes, the rest went to their callers
+
+	int			depth;				// stack[0] is the root
+	int			stack[PR_MAXPROFDEPTH];
+	double		start[PR_MAXPROFDEPTH];
+	double		children[PR_MAXPROFDEPTH];	// time spent in callees so far
+} prprofile_t;
+
+typedef struct
+{
+	int		func;
+	int		calls, statements, totalstatements;
+	double	self, total;
+} prfuncprof_t;
+
+/*
+====================
+PR_ProfileClear
+====================
+*/
+void PR_ProfileClear (void)
+{
+	if (!qcvm->profile)
+		return;
+	free (qcvm->profile->nodes);
+	free (qcvm->profile);
+	qcvm->profile = NULL;
+	qcvm->profiling = false;
+}
+
+/*
+====================
+PR_ProfileBegin
+
+called as the engine enters the progs, latches pr_profile for the whole call
+====================
+*/
+static void PR_ProfileBegin (void)
+{
+	prprofile_t	*p;
+
+	qcvm->profiling = (pr_profile.value != 0);
+	if (!qcvm->profiling)
+		return;
+
+	if (!qcvm->profile)
+	{
+		p = (prprofile_t *) calloc (1, sizeof(prprofile_t));
+		if (p)
+			p->nodes = (prprofnode_t *) calloc (1024, sizeof(prprofnode_t));
+		if (!p || !p->nodes)
+			Sys_Error ("PR_ProfileBegin: out of memory");
+		p->maxnodes = 1024;
+		p->numnodes = 1;
+		qcvm->profile = p;
+	}
+	qcvm->profile->depth = 0;	// an error may have left calls open
+}
+
+/*
+====================
+PR_ProfileEnter
+====================
+*/
+static void PR_ProfileEnter (dfunction_t *f)
+{
+	prprofile_t	*p = qcvm->profile;
+	int			parent, func, n;
+
+	if (++p->depth >= PR_MAXPROFDEPTH)
+		return;
+
+	parent = p->stack[p->depth - 1];
+	func = f - qcvm->functions;
+	for (n = p->nodes[parent].child; n; n = p->nodes[n].sibling)
+	{
+		if (p->nodes[n].func == func)
+			break;
+	}
+
+	if (!n)
+	{
+		if (p->numnodes == p->maxnodes && p->maxnodes < PR_MAXPROFNODES)
+		{
+			prprofnode_t *nodes = (prprofnode_t *) realloc (p->nodes, 2 * p->maxnodes * sizeof(prprofnode_t));
+			if (nodes)
+			{
+				p->nodes = nodes;
+				p->maxnodes *= 2;
+			}
+		}
+		if (p->numnodes < p->maxnodes)
+		{
+			n = p->numnodes++;
+			memset (&p->nodes[n], 0, sizeof(prprofnode_t));
+			p->nodes[n].func = func;
+			p->nodes[n].parent = parent;
+			p->nodes[n].sibling = p->nodes[parent].child;
+			p->nodes[parent].child = n;
+		}
+		else
+		{
+			p->truncated = true;
+			n = parent;
+		}
+	}
+
+	p->stack[p->depth] = n;
+	p->nodes[n].calls++;
+	p->children[p->depth] = 0;
+	p->start[p->depth] = Sys_DoubleTime ();
+}
+
+/*
+====================
+PR_ProfileLeave
+====================
+*/
+static void PR_ProfileLeave (void)
+{
+	prprofile_t		*p = qcvm->profile;
+	prprofnode_t	*node;
+	double			elapsed;
+
+	if (p->depth <= 0)
+		return;
+	if (p->depth >= PR_MAXPROFDEPTH)
+	{
+		p->depth--;
+		return;
+	}
+
+	elapsed = Sys_DoubleTime () - p->start[p->depth];
+	node = &p->nodes[p->stack[p->depth]];
+	node->total += elapsed;
+	node->self += elapsed - p->children[p->depth];
+	p->depth--;
+	p->children[p->depth] += elapsed;
+}
+
+/*
+====================
+PR_ProfileStatements
+
+counts statements run by the function on top of the stack
+====================
+*/
+static void PR_ProfileStatements (int count)
+{
+	prprofile_t	*p = qcvm->profile;
+
+	if (p->depth < PR_MAXPROFDEPTH)
+		p->nodes[p->stack[p->depth]].statements += count;
+}
+
+/*
+====================
+PR_ProfileFunctions
+
+sums the tree up per function, returns the number of functions called. a
+node adds to its function's totals only when it is not inside another call
+of the same function, so recursion is not counted twice
+====================
+*/
+static int PR_ProfileFunctions (prfuncprof_t *funcs)
+{
+	prprofile_t		*p = qcvm->profile;
+	prprofnode_t	*node;
+	prfuncprof_t	*fp;
+	int				*totalstatements;
+	int				i, n, num;
+
+	totalstatements = (int *) Scratch_Alloc (p->numnodes * sizeof(int));
+	for (i = 0; i < p->numnodes; i++)
+		totalstatements[i] = p->nodes[i].statements;
+	for (i = p->numnodes - 1; i > 0; i--)	// children always come after their parent
+		totalstatements[p->nodes[i].parent] += totalstatements[i];
+
+	for (i = 0; i < qcvm->progs->numfunctions; i++)
+	{
+		memset (&funcs[i], 0, sizeof(prfuncprof_t));
+		funcs[i].func = i;
+	}
+
+	for (i = 1; i < p->numnodes; i++)
+	{
+		node = &p->nodes[i];
+		fp = &funcs[node->func];
+		fp->calls += node->calls;
+		fp->statements += node->statements;
+		fp->self += node->self;
+		for (n = node->parent; n; n = p->nodes[n].parent)
+		{
+			if (p->nodes[n].func == node->func)
+				break;
+		}
+		if (!n)
+		{
+			fp->total += node->total;
+			fp->totalstatements += totalstatements[i];
+		}
+	}
+
+	// called functions first
+	for (i = 0, num = 0; i < qcvm->progs->numfunctions; i++)
+	{
+		if (funcs[i].calls)
+			funcs[num++] = funcs[i];
+	}
+	return num;
+}
+
+static int PR_ProfileCompare (const void *a, const void *b)
+{
+	double	d = ((const prfuncprof_t *)b)->self - ((const prfuncprof_t *)a)->self;
+
+	return (d > 0) - (d < 0);
+}
+
+/*
+====================
+PR_ProfilePrint
+====================
+*/
+static void PR_ProfilePrint (void)
+{
+	prfuncprof_t	*funcs;
+	dfunction_t		*f;
+	double			total;
+	int				i, num, mark, shown;
+
+	mark = Scratch_Mark ();
+	funcs = (prfuncprof_t *) Scratch_Alloc (qcvm->progs->numfunctions * sizeof(prfuncprof_t));
+	num = PR_ProfileFunctions (funcs);
+	qsort (funcs, num, sizeof(prfuncprof_t), PR_ProfileCompare);
+
+	Con_Printf ("   calls   self ms  total ms   self st  total st  function\n");
+	for (i = 0, shown = 0, total = 0; i < num; i++)
+	{
+		f = &qcvm->functions[funcs[i].func];
+		total += funcs[i].self;
+		if (f->first_statement < 0 || shown == 20)
+			continue;
+		Con_Printf ("%8i %9.2f %9.2f %9i %9i  %s\n", funcs[i].calls, funcs[i].self * 1000, funcs[i].total * 1000,
+			funcs[i].statements, funcs[i].totalstatements, PR_GetString(f->s_name));
+		shown++;
+	}
+
+	Con_Printf ("   calls   self ms  builtin\n");
+	for (i = 0, shown = 0; i < num && shown < 10; i++)
+	{
+		f = &qcvm->functions[funcs[i].func];
+		if (f->first_statement >= 0)
+			continue;
+		Con_Printf ("%8i %9.2f  %s\n", funcs[i].calls, funcs[i].self * 1000, PR_GetString(f->s_name));
+		shown++;
+	}
+
+	Con_Printf ("%i functions, %i call stacks, %.2f ms in progs\n", num, qcvm->profile->numnodes - 1, total * 1000);
+	if (qcvm->profile->truncated)
+		Con_Printf ("call stacks past the first %i were merged into their callers\n", qcvm->profile->maxnodes);
+	Scratch_FreeToMark (mark);
+}
+
+/*
+====================
+PR_ProfileSave
+
+writes the collapsed stacks flamegraph tools read: every call stack as its
+function names joined by ';', then its self time in microseconds
+====================
+*/
+static void PR_ProfileSave (const char *filename)
+{
+	prprofile_t	*p = qcvm->profile;
+	char		name[MAX_OSPATH];
+	FILE		*f;
+	int			*chain;
+	int			i, n, depth, lines;
+	double		us;
+
+	if (strstr (filename, ".."))
+	{
+		Con_Printf ("Relative pathnames are not allowed.\n");
+		return;
+	}
+
+	q_snprintf (name, sizeof(name), "%s/%s", com_gamedir, filename);
+	COM_CreatePath (name);
+	f = fopen (name, "w");
+	if (!f)
+	{
+		Con_Printf ("ERROR: couldn't open file %s.\n", name);
+		return;
+	}
+	COM_AddDirectoryFile (name);
+
+	chain = (int *) malloc (p->numnodes * sizeof(int));
+	for (i = 1, lines = 0; chain && i < p->numnodes; i++)
+	{
+		us = p->nodes[i].self * 1000000;
+		if (us < 0.5)
+			continue;
+		for (n = i, depth = 0; n; n = p->nodes[n].parent)
+			chain[depth++] = p->nodes[n].func;
+		while (depth--)
+			fprintf (f, depth ? "%s;" : "%s", PR_GetString(qcvm->functions[chain[depth]].s_name));
+		fprintf (f, " %.0f\n", us);
+		lines++;
+	}
+	free (chain);
+	fclose (f);
+
+	Con_Printf ("Wrote %i call stacks to %s\n", lines, name);
+}
+
 /*
 ============
 PR_Profile_f
 
+profile [clear | save <file>]
 ============
 */
 void PR_Profile_f (void)
 {
-	int		i, num;
-	int		pmax;
-	dfunction_t	*f, *best;
+	int		i;
 
 	if (!sv.active)
 		return;
 
 	PR_SwitchQCVM(&sv.qcvm);
 
-	num = 0;
-	do
+	if (Cmd_Argc () >= 2 && !q_strcasecmp (Cmd_Argv (1), "clear"))
 	{
-		pmax = 0;
-		best = NULL;
+		PR_ProfileClear ();
 		for (i = 0; i < qcvm->progs->numfunctions; i++)
-		{
-			f = &qcvm->functions[i];
-			if (f->profile > pmax)
-			{
-				pmax = f->profile;
-				best = f;
-			}
-		}
-		if (best)
-		{
-			if (num < 10)
-				Con_Printf("%7i %s\n", best->profile, PR_GetString(best->s_name));
-			num++;
-			best->profile = 0;
-		}
-	} while (best);
+			qcvm->functions[i].profile = 0;
+	}
+	else if (!qcvm->profile)
+		Con_Printf ("nothing profiled, set pr_profile 1 first\n");
+	else if (Cmd_Argc () >= 2 && !q_strcasecmp (Cmd_Argv (1), "save"))
+		PR_ProfileSave ((Cmd_Argc () >= 3) ? Cmd_Argv (2) : "qcprofile.txt");
+	else
+		PR_ProfilePrint ();
 
 	PR_SwitchQCVM(NULL);
 }
@@ -311,6 +647,8 @@ static int PR_EnterFunction (dfunction_t *f)
 	}
 
 	qcvm->xfunction = f;
+	if (qcvm->profiling)
+		PR_ProfileEnter (f);
 	return f->first_statement - 1;	// offset the s++
 }
 
@@ -326,6 +664,9 @@ static int PR_LeaveFunction (void)
 	if (qcvm->depth <= 0)
 		Host_Error("prog stack underflow");
 
+	if (qcvm->profiling)
+		PR_ProfileLeave ();
+
 	// Restore locals from the stack
 	c = qcvm->xfunction->locals;
 	qcvm->localstack_used -= c;
@@ -344,41 +685,23 @@ static int PR_LeaveFunction (void)
 
 /*
 ====================
-PR_ExecuteProgram
+PR_ExecuteChecked
 
-The interpretation main loop
+The interpretation loop that traces and profiles. st is the statement
+before the first one to run.
 ====================
 */
 #define OPA ((eval_t *)&qcvm->globals[(unsigned short)st->a])
 #define OPB ((eval_t *)&qcvm->globals[(unsigned short)st->b])
 #define OPC ((eval_t *)&qcvm->globals[(unsigned short)st->c])
 
-void PR_ExecuteProgram (func_t fnum)
+static void PR_ExecuteChecked (dstatement_t *st, int exitdepth)
 {
 	eval_t		*ptr;
-	dstatement_t	*st;
-	dfunction_t	*f, *newf;
+	dfunction_t	*newf;
 	int profile, startprofile;
 	edict_t		*ed;
-	int		exitdepth;
-
-	if (!fnum || fnum >= (func_t)qcvm->progs->numfunctions)
-	{
-		if (pr_global_struct->self)
-			ED_Print (PROG_TO_EDICT(pr_global_struct->self));
-		Host_Error ("PR_ExecuteProgram: NULL function");
-	}
-
-	f = &qcvm->functions[fnum];
-
-	//FIXME: if this is a builtin, then we're going to crash.
 
-	qcvm->trace = false;
-
-// make a stack frame
-	exitdepth = qcvm->depth;
-
-	st = &qcvm->statements[PR_EnterFunction(f)];
 	startprofile = profile = 0;
 
     while (1)
@@ -554,6 +877,8 @@ void PR_ExecuteProgram (func_t fnum)
 			qcvm->xstatement = st - qcvm->statements;
 			PR_RunError("assignment to world entity");
 		}
+		if (sv_predictingmoves)
+			SV_MoveChanged (ed);
 		OPC->_int = (byte *)((int *)&ed->v + OPB->_int) - (byte *)qcvm->edicts;
 		break;
 
@@ -604,6 +929,8 @@ void PR_ExecuteProgram (func_t fnum)
 	case OP_CALL7:
 	case OP_CALL8:
 		qcvm->xfunction->profile += profile - startprofile;
+		if (qcvm->profiling)
+			PR_ProfileStatements (profile - startprofile);
 		startprofile = profile;
 		qcvm->xstatement = st - qcvm->statements;
 		qcvm->argc = st->op - OP_CALL0;
@@ -615,7 +942,14 @@ void PR_ExecuteProgram (func_t fnum)
 			int i = -newf->first_statement;
 			if (i >= qcvm->numbuiltins)
 				i = 0;	//just invoke the fixme builtin.
-			qcvm->builtins[i]();
+			if (qcvm->profiling)
+			{
+				PR_ProfileEnter (newf);
+				qcvm->builtins[i]();
+				PR_ProfileLeave ();
+			}
+			else
+				qcvm->builtins[i]();
 			break;
 		}
 		// Normal function
@@ -625,6 +959,8 @@ void PR_ExecuteProgram (func_t fnum)
 	case OP_DONE:
 	case OP_RETURN:
 		qcvm->xfunction->profile += profile - startprofile;
+		if (qcvm->profiling)
+			PR_ProfileStatements (profile - startprofile);
 		startprofile = profile;
 		qcvm->xstatement = st - qcvm->statements;
 		qcvm->globals[OFS_RETURN] = qcvm->globals[(unsigned short)st->a];
@@ -654,3 +990,840 @@ void PR_ExecuteProgram (func_t fnum)
 #undef OPB
 #undef OPC
 
+
+#if defined(__GNUC__)
+/*
+==============================================================================
+
+						THREADED INTERPRETER
+
+PR_DecodeStatements turns every statement into the address of its handler
+in PR_ExecuteThreaded plus its operands resolved into the globals, so each
+handler ends by jumping straight to the next one. There is no per statement
+trace check or profile counter. Instead, every jump, call and return adds
+the length of the straight run of statements it ends, so the runaway
+counter sees every statement executed, callees included, like the one in
+PR_ExecuteChecked. Tracing and pr_profile run in PR_ExecuteChecked.
+
+With pr_optimize, PR_OptimizeStatements then rewrites the decoded copy:
+a statement whose result only feeds the store after it becomes one
+superinstruction, and branches on constants become gotos. Decoded statement
+i still stands for statements[i], a superinstruction just also does i + 1
+and moves on to i + 2, so jumps, stack traces and the checked loop see the
+original progs.
+==============================================================================
+*/
+#define	PR_THREADED
+#define	PR_NUMOPS		(OP_BITOR + 1)
+#define	PR_RUNAWAY		0x10000000
+
+enum
+{	// handlers past the opcodes
+	PRX_BAD = PR_NUMOPS,
+	PRX_ADD_F_STORE, PRX_SUB_F_STORE, PRX_MUL_F_STORE, PRX_DIV_F_STORE,
+	PRX_ADD_V_STORE, PRX_SUB_V_STORE, PRX_MUL_V_STORE,
+	PRX_MUL_FV_STORE, PRX_MUL_VF_STORE,
+	PRX_LOAD_STORE, PRX_LOAD_V_STORE,
+	PRX_STORE_STORE, PRX_STORE_V_STORE,
+	PRX_ADDRESS_STOREP, PRX_ADDRESS_STOREP_V,
+	PRX_NUMHANDLERS
+};
+
+static const void	**pr_handlers;
+
+#define OPA (st->a)
+#define OPB (st->b)
+#define OPC (st->c)
+#define OPD (st[1].b)	// destination of the store a superinstruction includes
+#define NEXT		goto *(++st)->handler
+#define NEXT2		goto *(st += 2)->handler
+#define RUNAWAY		do { if ((runaway += st + 1 - run) > PR_RUNAWAY) goto runaway_error; } while (0)
+#define JUMP		do { RUNAWAY; st += st->jump; run = st; goto *st->handler; } while (0)
+
+/*
+====================
+PR_ExecuteThreaded
+
+The fast interpretation loop. st is the statement before the first one to
+run, a NULL st just publishes the handler addresses for PR_DecodeStatements.
+====================
+*/
+static void PR_ExecuteThreaded (prstatement_t *st, int exitdepth)
+{
+	static const void *handlers[PRX_NUMHANDLERS] =
+	{
+		[OP_DONE] = &&op_return,		[OP_RETURN] = &&op_return,
+		[OP_MUL_F] = &&op_mul_f,		[OP_MUL_V] = &&op_mul_v,
+		[OP_MUL_FV] = &&op_mul_fv,		[OP_MUL_VF] = &&op_mul_vf,
+		[OP_DIV_F] = &&op_div_f,
+		[OP_ADD_F] = &&op_add_f,		[OP_ADD_V] = &&op_add_v,
+		[OP_SUB_F] = &&op_sub_f,		[OP_SUB_V] = &&op_sub_v,
+		[OP_EQ_F] = &&op_eq_f,			[OP_EQ_V] = &&op_eq_v,
+		[OP_EQ_S] = &&op_eq_s,			[OP_EQ_E] = &&op_eq_i,
+		[OP_EQ_FNC] = &&op_eq_i,
+		[OP_NE_F] = &&op_ne_f,			[OP_NE_V] = &&op_ne_v,
+		[OP_NE_S] = &&op_ne_s,			[OP_NE_E] = &&op_ne_i,
+		[OP_NE_FNC] = &&op_ne_i,
+		[OP_LE] = &&op_le,				[OP_GE] = &&op_ge,
+		[OP_LT] = &&op_lt,				[OP_GT] = &&op_gt,
+		[OP_LOAD_F] = &&op_load,		[OP_LOAD_V] = &&op_load_v,
+		[OP_LOAD_S] = &&op_load,		[OP_LOAD_ENT] = &&op_load,
+		[OP_LOAD_FLD] = &&op_load,		[OP_LOAD_FNC] = &&op_load,
+		[OP_ADDRESS] = &&op_address,
+		[OP_STORE_F] = &&op_store,		[OP_STORE_V] = &&op_store_v,
+		[OP_STORE_S] = &&op_store,		[OP_STORE_ENT] = &&op_store,
+		[OP_STORE_FLD] = &&op_store,	[OP_STORE_FNC] = &&op_store,
+		[OP_STOREP_F] = &&op_storep,	[OP_STOREP_V] = &&op_storep_v,
+		[OP_STOREP_S] = &&op_storep,	[OP_STOREP_ENT] = &&op_storep,
+		[OP_STOREP_FLD] = &&op_storep,	[OP_STOREP_FNC] = &&op_storep,
+		[OP_NOT_F] = &&op_not_f,		[OP_NOT_V] = &&op_not_v,
+		[OP_NOT_S] = &&op_not_s,		[OP_NOT_ENT] = &&op_not_ent,
+		[OP_NOT_FNC] = &&op_not_fnc,
+		[OP_IF] = &&op_if,				[OP_IFNOT] = &&op_ifnot,
+		[OP_CALL0] = &&op_call,			[OP_CALL1] = &&op_call,
+		[OP_CALL2] = &&op_call,			[OP_CALL3] = &&op_call,
+		[OP_CALL4] = &&op_call,			[OP_CALL5] = &&op_call,
+		[OP_CALL6] = &&op_call,			[OP_CALL7] = &&op_call,
+		[OP_CALL8] = &&op_call,
+		[OP_STATE] = &&op_state,		[OP_GOTO] = &&op_goto,
+		[OP_AND] = &&op_and,			[OP_OR] = &&op_or,
+		[OP_BITAND] = &&op_bitand,		[OP_BITOR] = &&op_bitor,
+		[PRX_BAD] = &&op_bad,
+		[PRX_ADD_F_STORE] = &&op_add_f_store,	[PRX_SUB_F_STORE] = &&op_sub_f_store,
+		[PRX_MUL_F_STORE] = &&op_mul_f_store,	[PRX_DIV_F_STORE] = &&op_div_f_store,
+		[PRX_ADD_V_STORE] = &&op_add_v_store,	[PRX_SUB_V_STORE] = &&op_sub_v_store,
+		[PRX_MUL_V_STORE] = &&op_mul_v_store,
+		[PRX_MUL_FV_STORE] = &&op_mul_fv_store,	[PRX_MUL_VF_STORE] = &&op_mul_vf_store,
+		[PRX_LOAD_STORE] = &&op_load_store,		[PRX_LOAD_V_STORE] = &&op_load_v_store,
+		[PRX_STORE_STORE] = &&op_store_store,	[PRX_STORE_V_STORE] = &&op_store_v_store,
+		[PRX_ADDRESS_STOREP] = &&op_address_storep,
+		[PRX_ADDRESS_STOREP_V] = &&op_address_storep_v,
+	};
+	eval_t		*ptr;
+	dfunction_t	*newf;
+	edict_t		*ed;
+	prstatement_t	*run;	// first statement of the straight run st is in
+	int			runaway = 0;
+
+	if (!st)
+	{
+		pr_handlers = handlers;
+		return;
+	}
+
+	run = st + 1;
+	NEXT;
+
+op_add_f:
+	OPC->_float = OPA->_float + OPB->_float;
+	NEXT;
+op_add_v:
+	OPC->vector[0] = OPA->vector[0] + OPB->vector[0];
+	OPC->vector[1] = OPA->vector[1] + OPB->vector[1];
+	OPC->vector[2] = OPA->vector[2] + OPB->vector[2];
+	NEXT;
+
+op_sub_f:
+	OPC->_float = OPA->_float - OPB->_float;
+	NEXT;
+op_sub_v:
+	OPC->vector[0] = OPA->vector[0] - OPB->vector[0];
+	OPC->vector[1] = OPA->vector[1] - OPB->vector[1];
+	OPC->vector[2] = OPA->vector[2] - OPB->vector[2];
+	NEXT;
+
+op_mul_f:
+	OPC->_float = OPA->_float * OPB->_float;
+	NEXT;
+op_mul_v:
+	OPC->_float = OPA->vector[0] * OPB->vector[0] +
+		      OPA->vector[1] * OPB->vector[1] +
+		      OPA->vector[2] * OPB->vector[2];
+	NEXT;
+op_mul_fv:
+	OPC->vector[0] = OPA->_float * OPB->vector[0];
+	OPC->vector[1] = OPA->_float * OPB->vector[1];
+	OPC->vector[2] = OPA->_float * OPB->vector[2];
+	NEXT;
+op_mul_vf:
+	OPC->vector[0] = OPB->_float * OPA->vector[0];
+	OPC->vector[1] = OPB->_float * OPA->vector[1];
+	OPC->vector[2] = OPB->_float * OPA->vector[2];
+	NEXT;
+
+op_div_f:
+	OPC->_float = OPA->_float / OPB->_float;
+	NEXT;
+
+op_bitand:
+	OPC->_float = (int)OPA->_float & (int)OPB->_float;
+	NEXT;
+op_bitor:
+	OPC->_float = (int)OPA->_float | (int)OPB->_float;
+	NEXT;
+
+op_ge:
+	OPC->_float = OPA->_float >= OPB->_float;
+	NEXT;
+op_le:
+	OPC->_float = OPA->_float <= OPB->_float;
+	NEXT;
+op_gt:
+	OPC->_float = OPA->_float > OPB->_float;
+	NEXT;
+op_lt:
+	OPC->_float = OPA->_float < OPB->_float;
+	NEXT;
+op_and:
+	OPC->_float = OPA->_float && OPB->_float;
+	NEXT;
+op_or:
+	OPC->_float = OPA->_float || OPB->_float;
+	NEXT;
+
+op_not_f:
+	OPC->_float = !OPA->_float;
+	NEXT;
+op_not_v:
+	OPC->_float = !OPA->vector[0] && !OPA->vector[1] && !OPA->vector[2];
+	NEXT;
+op_not_s:
+	OPC->_float = !OPA->string || !*PR_GetString(OPA->string);
+	NEXT;
+op_not_fnc:
+	OPC->_float = !OPA->function;
+	NEXT;
+op_not_ent:
+	OPC->_float = (PROG_TO_EDICT(OPA->edict) == qcvm->edicts);
+	NEXT;
+
+op_eq_f:
+	OPC->_float = OPA->_float == OPB->_float;
+	NEXT;
+op_eq_v:
+	OPC->_float = (OPA->vector[0] == OPB->vector[0]) &&
+		      (OPA->vector[1] == OPB->vector[1]) &&
+		      (OPA->vector[2] == OPB->vector[2]);
+	NEXT;
+op_eq_s:
+	OPC->_float = !strcmp(PR_GetString(OPA->string), PR_GetString(OPB->string));
+	NEXT;
+op_eq_i:
+	OPC->_float = OPA->_int == OPB->_int;
+	NEXT;
+
+op_ne_f:
+	OPC->_float = OPA->_float != OPB->_float;
+	NEXT;
+op_ne_v:
+	OPC->_float = (OPA->vector[0] != OPB->vector[0]) ||
+		      (OPA->vector[1] != OPB->vector[1]) ||
+		      (OPA->vector[2] != OPB->vector[2]);
+	NEXT;
+op_ne_s:
+	OPC->_float = strcmp(PR_GetString(OPA->string), PR_GetString(OPB->string));
+	NEXT;
+op_ne_i:
+	OPC->_float = OPA->_int != OPB->_int;
+	NEXT;
+
+op_store:
+	OPB->_int = OPA->_int;
+	NEXT;
+op_store_v:
+	OPB->vector[0] = OPA->vector[0];
+	OPB->vector[1] = OPA->vector[1];
+	OPB->vector[2] = OPA->vector[2];
+	NEXT;
+
+op_storep:
+	ptr = (eval_t *)((byte *)qcvm->edicts + OPB->_int);
+	ptr->_int = OPA->_int;
+	NEXT;
+op_storep_v:
+	ptr = (eval_t *)((byte *)qcvm->edicts + OPB->_int);
+	ptr->vector[0] = OPA->vector[0];
+	ptr->vector[1] = OPA->vector[1];
+	ptr->vector[2] = OPA->vector[2];
+	NEXT;
+
+op_address:
+	ed = PROG_TO_EDICT(OPA->edict);
+#ifdef PARANOID
+	NUM_FOR_EDICT(ed);	// Make sure it's in range
+#endif
+	if (ed == (edict_t *)qcvm->edicts && sv.state == ss_active)
+	{
+		qcvm->xstatement = st - qcvm->decoded;
+		PR_RunError("assignment to world entity");
+	}
+	if (sv_predictingmoves)
+		SV_MoveChanged (ed);
+	OPC->_int = (byte *)((int *)&ed->v + OPB->_int) - (byte *)qcvm->edicts;
+	NEXT;
+
+op_load:
+	ed = PROG_TO_EDICT(OPA->edict);
+#ifdef PARANOID
+	NUM_FOR_EDICT(ed);	// Make sure it's in range
+#endif
+	OPC->_int = ((eval_t *)((int *)&ed->v + OPB->_int))->_int;
+	NEXT;
+op_load_v:
+	ed = PROG_TO_EDICT(OPA->edict);
+#ifdef PARANOID
+	NUM_FOR_EDICT(ed);	// Make sure it's in range
+#endif
+	ptr = (eval_t *)((int *)&ed->v + OPB->_int);
+	OPC->vector[0] = ptr->vector[0];
+	OPC->vector[1] = ptr->vector[1];
+	OPC->vector[2] = ptr->vector[2];
+	NEXT;
+
+op_ifnot:
+	if (!OPA->_int)
+		JUMP;
+	NEXT;
+op_if:
+	if (OPA->_int)
+		JUMP;
+	NEXT;
+op_goto:
+	JUMP;
+
+op_call:
+	qcvm->xstatement = st - qcvm->decoded;
+	qcvm->argc = st->op - OP_CALL0;
+	if (!OPA->function)
+		PR_RunError("NULL function");
+	newf = &qcvm->functions[OPA->function];
+	if (newf->first_statement < 0)
+	{ // Built-in function
+		int i = -newf->first_statement;
+		if (i >= qcvm->numbuiltins)
+			i = 0;	//just invoke the fixme builtin.
+		qcvm->builtins[i]();
+		if (qcvm->trace)
+		{	// traceon: finish in the loop that can print
+			PR_ExecuteChecked (&qcvm->statements[st - qcvm->decoded], exitdepth);
+			return;
+		}
+		NEXT;
+	}
+	// Normal function
+	RUNAWAY;
+	st = &qcvm->decoded[PR_EnterFunction(newf)];
+	run = st + 1;
+	NEXT;
+
+op_return:
+	qcvm->xstatement = st - qcvm->decoded;
+	qcvm->globals[OFS_RETURN] = OPA->vector[0];
+	qcvm->globals[OFS_RETURN + 1] = OPA->vector[1];
+	qcvm->globals[OFS_RETURN + 2] = OPA->vector[2];
+	RUNAWAY;
+	st = &qcvm->decoded[PR_LeaveFunction()];
+	run = st + 1;
+	if (qcvm->depth == exitdepth)
+	{ // Done
+		return;
+	}
+	NEXT;
+
+op_state:
+	ed = PROG_TO_EDICT(pr_global_struct->self);
+	ed->v.nextthink = pr_global_struct->time + 0.1;
+	ed->v.frame = OPA->_float;
+	ed->v.think = OPB->function;
+	NEXT;
+
+/* superinstructions: the statement and the store after it */
+op_add_f_store:
+	OPD->_float = OPA->_float + OPB->_float;
+	NEXT2;
+op_sub_f_store:
+	OPD->_float = OPA->_float - OPB->_float;
+	NEXT2;
+op_mul_f_store:
+	OPD->_float = OPA->_float * OPB->_float;
+	NEXT2;
+op_div_f_store:
+	OPD->_float = OPA->_float / OPB->_float;
+	NEXT2;
+op_add_v_store:
+	OPD->vector[0] = OPA->vector[0] + OPB->vector[0];
+	OPD->vector[1] = OPA->vector[1] + OPB->vector[1];
+	OPD->vector[2] = OPA->vector[2] + OPB->vector[2];
+	NEXT2;
+op_sub_v_store:
+	OPD->vector[0] = OPA->vector[0] - OPB->vector[0];
+	OPD->vector[1] = OPA->vector[1] - OPB->vector[1];
+	OPD->vector[2] = OPA->vector[2] - OPB->vector[2];
+	NEXT2;
+op_mul_v_store:
+	OPD->_float = OPA->vector[0] * OPB->vector[0] +
+		      OPA->vector[1] * OPB->vector[1] +
+		      OPA->vector[2] * OPB->vector[2];
+	NEXT2;
+op_mul_fv_store:
+	OPD->vector[0] = OPA->_float * OPB->vector[0];
+	OPD->vector[1] = OPA->_float * OPB->vector[1];
+	OPD->vector[2] = OPA->_float * OPB->vector[2];
+	NEXT2;
+op_mul_vf_store:
+	OPD->vector[0] = OPB->_float * OPA->vector[0];
+	OPD->vector[1] = OPB->_float * OPA->vector[1];
+	OPD->vector[2] = OPB->_float * OPA->vector[2];
+	NEXT2;
+
+op_load_store:
+	ed = PROG_TO_EDICT(OPA->edict);
+#ifdef PARANOID
+	NUM_FOR_EDICT(ed);	// Make sure it's in range
+#endif
+	OPD->_int = ((eval_t *)((int *)&ed->v + OPB->_int))->_int;
+	NEXT2;
+op_load_v_store:
+	ed = PROG_TO_EDICT(OPA->edict);
+#ifdef PARANOID
+	NUM_FOR_EDICT(ed);	// Make sure it's in range
+#endif
+	ptr = (eval_t *)((int *)&ed->v + OPB->_int);
+	OPD->vector[0] = ptr->vector[0];
+	OPD->vector[1] = ptr->vector[1];
+	OPD->vector[2] = ptr->vector[2];
+	NEXT2;
+
+op_store_store:
+	OPD->_int = OPA->_int;
+	NEXT2;
+op_store_v_store:
+	OPD->vector[0] = OPA->vector[0];
+	OPD->vector[1] = OPA->vector[1];
+	OPD->vector[2] = OPA->vector[2];
+	NEXT2;
+
+op_address_storep:
+	ed = PROG_TO_EDICT(OPA->edict);
+#ifdef PARANOID
+	NUM_FOR_EDICT(ed);	// Make sure it's in range
+#endif
+	if (ed == (edict_t *)qcvm->edicts && sv.state == ss_active)
+	{
+		qcvm->xstatement = st - qcvm->decoded;
+		PR_RunError("assignment to world entity");
+	}
+	if (sv_predictingmoves)
+		SV_MoveChanged (ed);
+	ptr = (eval_t *)((int *)&ed->v + OPB->_int);
+	ptr->_int = st[1].a->_int;
+	NEXT2;
+op_address_storep_v:
+	ed = PROG_TO_EDICT(OPA->edict);
+#ifdef PARANOID
+	NUM_FOR_EDICT(ed);	// Make sure it's in range
+#endif
+	if (ed == (edict_t *)qcvm->edicts && sv.state == ss_active)
+	{
+		qcvm->xstatement = st - qcvm->decoded;
+		PR_RunError("assignment to world entity");
+	}
+	if (sv_predictingmoves)
+		SV_MoveChanged (ed);
+	ptr = (eval_t *)((int *)&ed->v + OPB->_int);
+	ptr->vector[0] = st[1].a->vector[0];
+	ptr->vector[1] = st[1].a->vector[1];
+	ptr->vector[2] = st[1].a->vector[2];
+	NEXT2;
+
+op_bad:
+	qcvm->xstatement = st - qcvm->decoded;
+	PR_RunError("Bad opcode %i", st->op);
+
+runaway_error:
+	qcvm->xstatement = st - qcvm->decoded;
+	PR_RunError("runaway loop error");
+}
+#undef OPA
+#undef OPB
+#undef OPC
+#undef OPD
+#undef NEXT
+#undef NEXT2
+#undef RUNAWAY
+#undef JUMP
+
+/*
+==============================================================================
+
+						STATEMENT OPTIMIZATION
+
+==============================================================================
+*/
+#define	PR_OVERLAP(o1, s1, o2, s2)	((o1) < (o2) + (s2) && (o2) < (o1) + (s1))
+#define	PR_DEADSCAN		32	// statements to look ahead for the next write of a temporary
+
+typedef struct
+{
+	int		ofs[4], size[4];	// globals read
+	int		numreads;
+	int		wofs, wsize;		// globals written, wsize 0 for none
+} propuse_t;
+
+/*
+====================
+PR_OperandUse
+
+what s reads from and writes to the globals, false for the statements that
+leave the straight line: jumps, calls and returns
+====================
+*/
+static qboolean PR_OperandUse (dstatement_t *s, propuse_t *use)
+{
+	int		a, b, w;	// sizes read through a and b, written through out
+	short	out;
+
+	use->numreads = 0;
+	switch (s->op)
+	{
+	case OP_ADD_V:	case OP_SUB_V:
+		a = 3; b = 3; w = 3; out = s->c;
+		break;
+	case OP_MUL_V:	case OP_EQ_V:	case OP_NE_V:
+		a = 3; b = 3; w = 1; out = s->c;
+		break;
+	case OP_MUL_FV:
+		a = 1; b = 3; w = 3; out = s->c;
+		break;
+	case OP_MUL_VF:
+		a = 3; b = 1; w = 3; out = s->c;
+		break;
+	case OP_MUL_F:	case OP_DIV_F:	case OP_ADD_F:	case OP_SUB_F:
+	case OP_EQ_F:	case OP_EQ_S:	case OP_EQ_E:	case OP_EQ_FNC:
+	case OP_NE_F:	case OP_NE_S:	case OP_NE_E:	case OP_NE_FNC:
+	case OP_LE:		case OP_GE:		case OP_LT:		case OP_GT:
+	case OP_AND:	case OP_OR:		case OP_BITAND:	case OP_BITOR:
+	case OP_LOAD_F:	case OP_LOAD_S:	case OP_LOAD_ENT:	case OP_LOAD_FLD:	case OP_LOAD_FNC:
+	case OP_ADDRESS:
+		a = 1; b = 1; w = 1; out = s->c;
+		break;
+	case OP_LOAD_V:
+		a = 1; b = 1; w = 3; out = s->c;
+		break;
+	case OP_NOT_F:	case OP_NOT_S:	case OP_NOT_ENT:	case OP_NOT_FNC:
+		a = 1; b = 0; w = 1; out = s->c;
+		break;
+	case OP_NOT_V:
+		a = 3; b = 0; w = 1; out = s->c;
+		break;
+	case OP_STORE_F:	case OP_STORE_S:	case OP_STORE_ENT:	case OP_STORE_FLD:	case OP_STORE_FNC:
+		a = 1; b = 0; w = 1; out = s->b;
+		break;
+	case OP_STORE_V:
+		a = 3; b = 0; w = 3; out = s->b;
+		break;
+	case OP_STOREP_F:	case OP_STOREP_S:	case OP_STOREP_ENT:	case OP_STOREP_FLD:	case OP_STOREP_FNC:
+	case OP_STATE:	// pointers and STATE write to edicts, never globals
+		a = 1; b = 1; w = 0; out = 0;
+		break;
+	case OP_STOREP_V:
+		a = 3; b = 1; w = 0; out = 0;
+		break;
+	default:
+		return false;
+	}
+
+	use->ofs[use->numreads] = (unsigned short)s->a;
+	use->size[use->numreads++] = a;
+	if (b)
+	{
+		use->ofs[use->numreads] = (unsigned short)s->b;
+		use->size[use->numreads++] = b;
+	}
+	if (s->op == OP_STATE)
+	{	// also reads self and time behind the progs' back
+		use->ofs[use->numreads] = offsetof(globalvars_t, self) / sizeof(float);
+		use->size[use->numreads++] = 1;
+		use->ofs[use->numreads] = offsetof(globalvars_t, time) / sizeof(float);
+		use->size[use->numreads++] = 1;
+	}
+	use->wofs = (unsigned short)out;
+	use->wsize = w;
+	return true;
+}
+
+/*
+====================
+PR_TempDead
+
+true when the globals [ofs, ofs + size) are written before anything reads
+them again, going on from statement start without leaving the straight line
+====================
+*/
+static qboolean PR_TempDead (int start, int ofs, int size)
+{
+	propuse_t	use;
+	int			i, j, end;
+
+	end = q_min(qcvm->progs->numstatements, start + PR_DEADSCAN);
+	for (i = start; i < end; i++)
+	{
+		if (!PR_OperandUse (&qcvm->statements[i], &use))
+			return false;	// a jump or call might lead to a read
+		for (j = 0; j < use.numreads; j++)
+		{
+			if (PR_OVERLAP(use.ofs[j], use.size[j], ofs, size))
+				return false;
+		}
+		if (use.wofs <= ofs && ofs + size <= use.wofs + use.wsize)
+			return true;
+	}
+	return false;
+}
+
+/*
+====================
+PR_FindConstants
+
+flags the globals no statement, function call or engine code ever writes
+====================
+*/
+static byte *PR_FindConstants (void)
+{
+	byte		*isconst;
+	ddef_t		*def;
+	dfunction_t	*f;
+	propuse_t	use;
+	int			i, n, ofs, size;
+
+	n = qcvm->progs->numglobals;
+	isconst = (byte *) Scratch_Alloc (n);
+	memset (isconst, 1, n);
+
+	// engine globals, return value and parms
+	memset (isconst, 0, q_min(n, (int)(sizeof(globalvars_t) / 4)));
+
+	// anything with a name may be set by the engine or a savegame
+	for (i = 0, def = qcvm->globaldefs; i < qcvm->progs->numglobaldefs; i++, def++)
+	{
+		if (!strcmp (PR_GetString (def->s_name), "IMMEDIATE"))
+			continue;
+		ofs = def->ofs;
+		size = ((def->type & ~DEF_SAVEGLOBAL) == ev_vector) ? 3 : 1;
+		if (ofs < n)
+			memset (isconst + ofs, 0, q_min(size, n - ofs));
+	}
+
+	// parms and locals, filled on every call
+	for (i = 0, f = qcvm->functions; i < qcvm->progs->numfunctions; i++, f++)
+	{
+		if (f->first_statement <= 0 || f->parm_start < 0 || f->parm_start >= n || f->locals <= 0)
+			continue;
+		memset (isconst + f->parm_start, 0, q_min(f->locals, n - f->parm_start));
+	}
+
+	for (i = 0; i < qcvm->progs->numstatements; i++)
+	{
+		if (PR_OperandUse (&qcvm->statements[i], &use) && use.wsize && use.wofs < n)
+			memset (isconst + use.wofs, 0, q_min(use.wsize, n - use.wofs));
+	}
+
+	return isconst;
+}
+
+/*
+====================
+PR_FuseStatement
+
+the superinstruction that does statement i and i + 1, 0 if there is none:
+a statement and the store of its result, or an OP_ADDRESS and the store
+through that pointer, when nothing reads the temporary in between afterwards
+====================
+*/
+static int PR_FuseStatement (int i)
+{
+	dstatement_t	*s, *next;
+	propuse_t	use;
+	int			fused, tmp, size, dst, j;
+
+	s = &qcvm->statements[i];
+	next = s + 1;
+
+	if (s->op == OP_ADDRESS)
+	{
+		if (next->op < OP_STOREP_F || next->op > OP_STOREP_FNC || next->b != s->c)
+			return 0;
+		size = (next->op == OP_STOREP_V) ? 3 : 1;
+		tmp = (unsigned short)s->c;
+		if (PR_OVERLAP((unsigned short)next->a, size, tmp, 1) || !PR_TempDead (i + 2, tmp, 1))
+			return 0;
+		return (size == 3) ? PRX_ADDRESS_STOREP_V : PRX_ADDRESS_STOREP;
+	}
+
+	switch (s->op)
+	{
+	case OP_ADD_F:		fused = PRX_ADD_F_STORE; break;
+	case OP_SUB_F:		fused = PRX_SUB_F_STORE; break;
+	case OP_MUL_F:		fused = PRX_MUL_F_STORE; break;
+	case OP_DIV_F:		fused = PRX_DIV_F_STORE; break;
+	case OP_ADD_V:		fused = PRX_ADD_V_STORE; break;
+	case OP_SUB_V:		fused = PRX_SUB_V_STORE; break;
+	case OP_MUL_V:		fused = PRX_MUL_V_STORE; break;
+	case OP_MUL_FV:		fused = PRX_MUL_FV_STORE; break;
+	case OP_MUL_VF:		fused = PRX_MUL_VF_STORE; break;
+	case OP_LOAD_F:	case OP_LOAD_S:	case OP_LOAD_ENT:	case OP_LOAD_FLD:	case OP_LOAD_FNC:
+		fused = PRX_LOAD_STORE; break;
+	case OP_LOAD_V:		fused = PRX_LOAD_V_STORE; break;
+	case OP_STORE_F:	case OP_STORE_S:	case OP_STORE_ENT:	case OP_STORE_FLD:	case OP_STORE_FNC:
+		fused = PRX_STORE_STORE; break;
+	case OP_STORE_V:	fused = PRX_STORE_V_STORE; break;
+	default:
+		return 0;
+	}
+
+	PR_OperandUse (s, &use);
+	tmp = use.wofs;
+	size = use.wsize;
+	if (size == 3 ? next->op != OP_STORE_V : (next->op < OP_STORE_F || next->op > OP_STORE_FNC || next->op == OP_STORE_V))
+		return 0;
+	if ((unsigned short)next->a != tmp)
+		return 0;
+	dst = (unsigned short)next->b;
+	if (PR_OVERLAP(dst, size, tmp, size))
+		return 0;
+	// vectors are written a component at a time, so the destination may only
+	// be one of the sources as a whole
+	if (size == 3)
+	{
+		for (j = 0; j < use.numreads; j++)
+		{
+			if (PR_OVERLAP(dst, 3, use.ofs[j], use.size[j]) && (dst != use.ofs[j] || use.size[j] != 3))
+				return 0;
+		}
+	}
+	if (!PR_TempDead (i + 2, tmp, size))
+		return 0;
+	return fused;
+}
+
+/*
+====================
+PR_OptimizeStatements
+
+rewrites the decoded statements into superinstructions and constant branches
+====================
+*/
+static void PR_OptimizeStatements (void)
+{
+	dstatement_t	*s;
+	prstatement_t	*out;
+	byte		*isconst;
+	int			i, n, mark, fused, numfused = 0, numfolded = 0;
+
+	mark = Scratch_Mark ();
+	isconst = PR_FindConstants ();
+
+	n = qcvm->progs->numstatements;
+	for (i = 0, s = qcvm->statements, out = qcvm->decoded; i < n; i++, s++, out++)
+	{
+		if ((s->op == OP_IF || s->op == OP_IFNOT) && (unsigned short)s->a < qcvm->progs->numglobals && isconst[(unsigned short)s->a])
+		{
+			out->handler = pr_handlers[OP_GOTO];
+			if ((s->op == OP_IF) != (out->a->_int != 0))
+				out->jump = 1;	// never taken, go to the next statement
+			numfolded++;
+		}
+		else if (i + 1 < n && (fused = PR_FuseStatement (i)))
+		{
+			out->handler = pr_handlers[fused];
+			numfused++;
+		}
+	}
+
+	Scratch_FreeToMark (mark);
+	Con_DPrintf ("%i superinstructions, %i constant branches\n", numfused, numfolded);
+}
+#endif	/* __GNUC__ */
+
+/*
+====================
+PR_DecodeStatements
+
+prepares the loaded progs for PR_ExecuteThreaded, called once the
+statements are final
+====================
+*/
+void PR_DecodeStatements (void)
+{
+#ifdef PR_THREADED
+	dstatement_t	*in;
+	prstatement_t	*out;
+	int		i, op;
+
+	if (!pr_handlers)
+		PR_ExecuteThreaded (NULL, 0);
+
+	free (qcvm->decoded);
+	qcvm->decoded = (prstatement_t *) malloc (qcvm->progs->numstatements * sizeof(prstatement_t));
+	if (!qcvm->decoded)
+		return;	// PR_ExecuteChecked works without
+
+	for (i = 0, in = qcvm->statements, out = qcvm->decoded; i < qcvm->progs->numstatements; i++, in++, out++)
+	{
+		op = in->op;
+		out->handler = pr_handlers[(op < PR_NUMOPS) ? op : PRX_BAD];
+		out->op = op;
+		out->a = (eval_t *)&qcvm->globals[(unsigned short)in->a];
+		out->b = (eval_t *)&qcvm->globals[(unsigned short)in->b];
+		out->c = (eval_t *)&qcvm->globals[(unsigned short)in->c];
+		if (op == OP_GOTO)
+			out->jump = in->a;
+		else if (op == OP_IF || op == OP_IFNOT)
+			out->jump = in->b;
+		else
+			out->jump = 0;
+	}
+
+	if (pr_optimize.value)
+		PR_OptimizeStatements ();
+#endif
+}
+
+/*
+====================
+PR_ExecuteProgram
+====================
+*/
+void PR_ExecuteProgram (func_t fnum)
+{
+	dfunction_t	*f;
+	int		exitdepth, s;
+
+	if (!fnum || fnum >= (func_t)qcvm->progs->numfunctions)
+	{
+		if (pr_global_struct->self)
+			ED_Print (PROG_TO_EDICT(pr_global_struct->self));
+		Host_Error ("PR_ExecuteProgram: NULL function");
+	}
+
+	f = &qcvm->functions[fnum];
+
+	//FIXME: if this is a builtin, then we're going to crash.
+
+	qcvm->trace = false;
+
+// make a stack frame
+	exitdepth = qcvm->depth;
+	if (!exitdepth)
+		PR_ProfileBegin ();
+	s = PR_EnterFunction(f);
+
+#ifdef PR_THREADED
+	if (qcvm->decoded && !qcvm->profiling)
+	{
+		PR_ExecuteThreaded (&qcvm->decoded[s], exitdepth);
+		return;
+	}
+#endif
+	PR_ExecuteChecked (&qcvm->statements[s], exitdepth);
+}
@@ -483,6 +483,7 @@ static void PF_strzone(void)
 	size_t l[8];
 	int i;
 	size_t id;
+	memtag_t tag;
 
 	for (i = 0; i < qcvm->argc; i++)
 	{
@@ -492,6 +493,7 @@ static void PF_strzone(void)
 	}
 	len++; /*for the null*/
 
+	tag = Memory_SetTag (MEMTAG_PROGS);
 	buf = Z_Malloc(len);
 	G_INT(OFS_RETURN) = PR_SetEngineString(buf);
 	id = -1-G_INT(OFS_RETURN);
@@ -500,6 +502,7 @@ static void PF_strzone(void)
 		qcvm->knownzonesize = (id+32)&~7;
 		qcvm->knownzone = Z_Realloc(qcvm->knownzone, (qcvm->knownzonesize+7)>>3);
 	}
+	Memory_SetTag (tag);
 	qcvm->knownzone[id>>3] |= 1u<<(id&7);
 
 	for (i = 0; i < qcvm->argc; i++)
@@ -2873,6 +2876,7 @@ static void PF_buf_copy(void)
 	unsigned int buffrom = G_FLOAT(OFS_PARM0)-BUFSTRBASE;
 	unsigned int bufto = G_FLOAT(OFS_PARM1)-BUFSTRBASE;
 	unsigned int i;
+	memtag_t tag;
 
 	if (bufto == buffrom)	//err...
 		return;
@@ -2892,10 +2896,12 @@ static void PF_buf_copy(void)
 	Z_Free(strbuflist[bufto].strings);
 
 	//copy new data over.
+	tag = Memory_SetTag (MEMTAG_PROGS);
 	strbuflist[bufto].used = strbuflist[bufto].allocated = strbuflist[buffrom].used;
 	strbuflist[bufto].strings = Z_Malloc(strbuflist[buffrom].used * sizeof(char*));
 	for (i = 0; i < strbuflist[buffrom].used; i++)
 		strbuflist[bufto].strings[i] = strbuflist[buffrom].strings[i]?Z_StrDup(strbuflist[buffrom].strings[i]):NULL;
+	Memory_SetTag (tag);
 }
 static int PF_buf_sort_sortprefixlen;
 static int PF_buf_sort_ascending(const void *a, const void *b)
@@ -3042,12 +3048,14 @@ static void PF_bufstr_set(void)
 	unsigned int index = G_FLOAT(OFS_PARM1);
 	const char *string = G_STRING(OFS_PARM2);
 	unsigned int oldcount;
+	memtag_t tag;
 
 	if ((unsigned int)bufno >= NUMSTRINGBUFS)
 		return;
 	if (!strbuflist[bufno].owningvm)
 		return;
 
+	tag = Memory_SetTag (MEMTAG_PROGS);
 	if (index >= strbuflist[bufno].allocated)
 	{
 		oldcount = strbuflist[bufno].allocated;
@@ -3059,6 +3067,7 @@ static void PF_bufstr_set(void)
 		Z_Free(strbuflist[bufno].strings[index]);
 	strbuflist[bufno].strings[index] = Z_Malloc(strlen(string)+1);
 	strcpy(strbuflist[bufno].strings[index], string);
+	Memory_SetTag (tag);
 
 	if (index >= strbuflist[bufno].used)
 		strbuflist[bufno].used = index+1;
@@ -3067,6 +3076,7 @@ static void PF_bufstr_set(void)
 static int PF_bufstr_add_internal(unsigned int bufno, const char *string, int appendonend)
 {
 	unsigned int index;
+	memtag_t tag;
 	if (appendonend)
 	{
 		//add on end
@@ -3081,6 +3091,7 @@ static int PF_bufstr_add_internal(unsigned int bufno, const char *string, int ap
 	}
 
 	//expand it if needed
+	tag = Memory_SetTag (MEMTAG_PROGS);
 	if (index >= strbuflist[bufno].allocated)
 	{
 		unsigned int oldcount;
@@ -3095,6 +3106,7 @@ static int PF_bufstr_add_internal(unsigned int bufno, const char *string, int ap
 		Z_Free(strbuflist[bufno].strings[index]);
 	strbuflist[bufno].strings[index] = Z_Malloc(strlen(string)+1);
 	strcpy(strbuflist[bufno].strings[index], string);
+	Memory_SetTag (tag);
 
 	if (index >= strbuflist[bufno].used)
 		strbuflist[bufno].used = index+1;
@@ -3184,6 +3196,8 @@ static void PF_copyentity(void)
 	edict_t *dst = (qcvm->argc<2)?ED_Alloc():G_EDICT(OFS_PARM1);
 	if (src->free || dst->free)
 		Con_Printf("PF_copyentity: entity is free\n");
+	if (sv_predictingmoves)
+		SV_MoveChanged (dst);
 	memcpy(&dst->v, &src->v, qcvm->edict_size - sizeof(entvars_t));
 	dst->alpha = src->alpha;
 	dst->sendinterval = src->sendinterval;
@@ -3396,6 +3410,8 @@ static void PF_putentfldstr(void)
 	unsigned int fldidx = G_FLOAT(OFS_PARM0);
 	edict_t *ent = G_EDICT(OFS_PARM1);
 	const char *value = G_STRING(OFS_PARM2);
+	if (sv_predictingmoves)
+		SV_MoveChanged (ent);
 	if (fldidx < (unsigned int)qcvm->progs->numfielddefs)
 		G_FLOAT(OFS_RETURN) = ED_ParseEpair ((void *)&ent->v, qcvm->fielddefs+fldidx, value, true);
 	else
@@ -3420,6 +3436,8 @@ static void PF_parseentitydata(void)
 		end = COM_Parse(data+offset);
 		if (!strcmp(com_token, "{"))
 		{
+			if (sv_predictingmoves)
+				SV_MoveChanged (ed);
 			end = ED_ParseEdict(end, ed);
 			G_FLOAT(OFS_RETURN) = end - data;
 		}
@@ -4322,13 +4340,13 @@ static void DrawQC_CharacterQuad (float x, float y, int num, float w, float h, f
 	vertices[4] = corner_verts[3];
 	vertices[5] = corner_verts[0];
 
-	vulkan_globals.vk_cmd_bind_vertex_buffers(vulkan_globals.command_buffer, 0, 1, &buffer, &buffer_offset);
+	vulkan_globals.vk_cmd_bind_vertex_buffers(vulkan_recording.command_buffer, 0, 1, &buffer, &buffer_offset);
 	if (alpha_blend)
 		R_BindPipeline(VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_blend_pipeline[render_pass_index]);
 	else 
 		R_BindPipeline(VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_alphatest_pipeline[render_pass_index]);
-	vulkan_globals.vk_cmd_bind_descriptor_sets(vulkan_globals.command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_pipeline_layout.handle, 0, 1, &char_texture->descriptor_set, 0, NULL);
-	vulkan_globals.vk_cmd_draw(vulkan_globals.command_buffer, 6, 1, 0, 0);
+	vulkan_globals.vk_cmd_bind_descriptor_sets(vulkan_recording.command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_pipeline_layout.handle, 0, 1, &char_texture->descriptor_set, 0, NULL);
+	vulkan_globals.vk_cmd_draw(vulkan_recording.command_buffer, 6, 1, 0, 0);
 }
 static void PF_cl_drawcharacter(void)
 {
@@ -4427,7 +4445,7 @@ static void PF_cl_drawsetclip(void)
 	render_area.offset.y = y;
 	render_area.extent.width = w;
 	render_area.extent.height = h;
-	vkCmdSetScissor(vulkan_globals.command_buffer, 0, 1, &render_area);
+	vkCmdSetScissor(vulkan_recording.command_buffer, 0, 1, &render_area);
 }
 static void PF_cl_drawresetclip(void)
 {
@@ -4436,7 +4454,7 @@ static void PF_cl_drawresetclip(void)
 	render_area.offset.y = 0;
 	render_area.extent.width = vid.width;
 	render_area.extent.height = vid.height;
-	vkCmdSetScissor(vulkan_globals.command_buffer, 0, 1, &render_area);
+	vkCmdSetScissor(vulkan_recording.command_buffer, 0, 1, &render_area);
 }
 
 static void PF_cl_precachepic(void)
@@ -4539,10 +4557,10 @@ static void PF_cl_drawfill(void)
 	vertices[4] = corner_verts[3];
 	vertices[5] = corner_verts[0];
 
-	vulkan_globals.vk_cmd_bind_vertex_buffers(vulkan_globals.command_buffer, 0, 1, &buffer, &buffer_offset);
+	vulkan_globals.vk_cmd_bind_vertex_buffers(vulkan_recording.command_buffer, 0, 1, &buffer, &buffer_offset);
 	R_BindPipeline(VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_notex_blend_pipeline[render_pass_index]);
-	vulkan_globals.vk_cmd_bind_descriptor_sets(vulkan_globals.command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_pipeline_layout.handle, 0, 1, &char_texture->descriptor_set, 0, NULL);
-	vulkan_globals.vk_cmd_draw(vulkan_globals.command_buffer, 6, 1, 0, 0);
+	vulkan_globals.vk_cmd_bind_descriptor_sets(vulkan_recording.command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_pipeline_layout.handle, 0, 1, &char_texture->descriptor_set, 0, NULL);
+	vulkan_globals.vk_cmd_draw(vulkan_recording.command_buffer, 6, 1, 0, 0);
 }
 
 static void PF_cl_registercommand(void)
@@ -5251,6 +5269,7 @@ void PR_DumpPlatform_f(void)
 		Con_Printf("%s: Couldn't write %s\n", Cmd_Argv(0), name);
 		return;
 	}
+	COM_AddDirectoryFile (name);
 	Con_Printf("%s: Writing %s\n", Cmd_Argv(0), name);
 
 	fprintf(f,
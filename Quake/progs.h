@@ -62,9 +62,27 @@ typedef struct edict_s
 typedef void (*builtin_t) (void);
 typedef struct qcvm_s qcvm_t;
 
+typedef struct prstatement_s
+{
+	const void	*handler;	// where the threaded interpreter runs it
+	eval_t		*a, *b, *c;	// operands resolved into the globals
+	int			op;
+	int			jump;		// IF, IFNOT and GOTO offset
+} prstatement_t;
+
+typedef struct prhash_s
+{	// def names for ED_FindField, ED_FindGlobal and ED_FindFunction
+	int			mask;
+	int			*heads;		// index + 1 of the first def in each bucket, 0 for none
+	int			*next;		// index + 1 of the next def in the same bucket
+} prhash_t;
+
 void PR_Init (void);
 
 void PR_ExecuteProgram (func_t fnum);
+void PR_DecodeStatements (void);
+extern cvar_t pr_profile;
+extern cvar_t pr_optimize;
 void PR_ClearProgs(qcvm_t *vm);
 qboolean PR_LoadProgs (const char *filename, qboolean fatal, unsigned int needcrc, builtin_t *builtins, size_t numbuiltins);
 
@@ -93,6 +111,7 @@ int PR_AllocString (int bufferlength, char **ptr);
 void PR_ClearEngineString(int num);
 
 void PR_Profile_f (void);
+void PR_ProfileClear (void);
 
 edict_t *ED_Alloc (void);
 void ED_Free (edict_t *ed);
@@ -297,8 +316,10 @@ struct qcvm_s
 	dprograms_t	*progs;
 	dfunction_t	*functions;
 	dstatement_t	*statements;
+	prstatement_t	*decoded;	/* statements for the threaded interpreter, or NULL */
 	float		*globals;	/* same as pr_global_struct */
 	ddef_t		*fielddefs;	//yay reflection.
+	prhash_t	fieldhash, globalhash, functionhash;
 
 	int			edict_size;	/* in bytes */
 
@@ -308,6 +329,8 @@ struct qcvm_s
 	int			argc;
 
 	qboolean	trace;
+	qboolean	profiling;			// pr_profile, latched when the engine calls in
+	struct prprofile_s *profile;	// calling context tree, NULL until profiled
 	dfunction_t	*xfunction;
 	int			xstatement;
 
@@ -228,6 +228,12 @@ typedef ptrdiff_t	ssize_t;
 #define FUNC_NOCLONE
 #endif
 
+#if defined(_MSC_VER)
+#define THREAD_LOCAL	__declspec(thread)
+#else
+#define THREAD_LOCAL	__thread
+#endif
+
 #if defined(_MSC_VER) && !defined(__cplusplus)
 #define inline __inline
 #endif	/* _MSC_VER */
@@ -144,14 +144,14 @@ static void GL_DrawAliasFrame (aliashdr_t *paliashdr, lerpdata_t lerpdata, gltex
 	ubo->entalpha = entity_alpha;
 
 	VkDescriptorSet descriptor_sets[3] = { tx->descriptor_set, (fb != NULL) ? fb->descriptor_set : tx->descriptor_set, ubo_set };
-	vulkan_globals.vk_cmd_bind_descriptor_sets(vulkan_globals.command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.alias_pipeline.layout.handle, 0, 3, descriptor_sets, 1, &uniform_offset);
+	vulkan_globals.vk_cmd_bind_descriptor_sets(vulkan_recording.command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.alias_pipeline.layout.handle, 0, 3, descriptor_sets, 1, &uniform_offset);
 
 	VkBuffer vertex_buffers[3] = { currententity->model->vertex_buffer, currententity->model->vertex_buffer, currententity->model->vertex_buffer };
 	VkDeviceSize vertex_offsets[3] = { (unsigned)currententity->model->vbostofs, GLARB_GetXYZOffset (paliashdr, lerpdata.pose1), GLARB_GetXYZOffset (paliashdr, lerpdata.pose2) };
-	vulkan_globals.vk_cmd_bind_vertex_buffers(vulkan_globals.command_buffer, 0, 3, vertex_buffers, vertex_offsets);
-	vulkan_globals.vk_cmd_bind_index_buffer(vulkan_globals.command_buffer, currententity->model->index_buffer, 0, VK_INDEX_TYPE_UINT16);
+	vulkan_globals.vk_cmd_bind_vertex_buffers(vulkan_recording.command_buffer, 0, 3, vertex_buffers, vertex_offsets);
+	vulkan_globals.vk_cmd_bind_index_buffer(vulkan_recording.command_buffer, currententity->model->index_buffer, 0, VK_INDEX_TYPE_UINT16);
 
-	vulkan_globals.vk_cmd_draw_indexed(vulkan_globals.command_buffer, paliashdr->numindexes, 1, 0, 0, 0);
+	vulkan_globals.vk_cmd_draw_indexed(vulkan_recording.command_buffer, paliashdr->numindexes, 1, 0, 0, 0);
 
 	rs_aliaspasses += paliashdr->numtris;
 }
@@ -597,14 +597,14 @@ void R_DrawAliasModel_ShowTris (entity_t *e)
 	ubo->flags = 0;
 
 	VkDescriptorSet descriptor_sets[3] = { nulltexture->descriptor_set, nulltexture->descriptor_set, ubo_set };
-	vulkan_globals.vk_cmd_bind_descriptor_sets(vulkan_globals.command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.alias_pipeline.layout.handle, 0, 3, descriptor_sets, 1, &uniform_offset);
+	vulkan_globals.vk_cmd_bind_descriptor_sets(vulkan_recording.command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.alias_pipeline.layout.handle, 0, 3, descriptor_sets, 1, &uniform_offset);
 
 	VkBuffer vertex_buffers[3] = { currententity->model->vertex_buffer, currententity->model->vertex_buffer, currententity->model->vertex_buffer };
 	VkDeviceSize vertex_offsets[3] = { (unsigned)currententity->model->vbostofs, GLARB_GetXYZOffset (paliashdr, lerpdata.pose1), GLARB_GetXYZOffset (paliashdr, lerpdata.pose2) };
-	vulkan_globals.vk_cmd_bind_vertex_buffers(vulkan_globals.command_buffer, 0, 3, vertex_buffers, vertex_offsets);
-	vulkan_globals.vk_cmd_bind_index_buffer(vulkan_globals.command_buffer, currententity->model->index_buffer, 0, VK_INDEX_TYPE_UINT16);
+	vulkan_globals.vk_cmd_bind_vertex_buffers(vulkan_recording.command_buffer, 0, 3, vertex_buffers, vertex_offsets);
+	vulkan_globals.vk_cmd_bind_index_buffer(vulkan_recording.command_buffer, currententity->model->index_buffer, 0, VK_INDEX_TYPE_UINT16);
 
-	vulkan_globals.vk_cmd_draw_indexed(vulkan_globals.command_buffer, paliashdr->numindexes, 1, 0, 0, 0);
+	vulkan_globals.vk_cmd_draw_indexed(vulkan_recording.command_buffer, paliashdr->numindexes, 1, 0, 0, 0);
 
 	R_RestoreAliasMVP (e);
 }
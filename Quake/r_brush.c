@@ -24,6 +24,11 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 // r_brush.c: brush model rendering. renamed from r_surf.c
 
 #include "quakedef.h"
+#if defined(SDL_FRAMEWORK) || defined(NO_SDL_CONFIG)
+#include <SDL2/SDL.h>
+#else
+#include "SDL.h"
+#endif
 
 extern cvar_t gl_fullbrights, r_drawflat; //johnfitz
 
@@ -36,8 +41,6 @@ int					lightmap_count;
 int					last_lightmap_allocated;
 int					allocated[LMBLOCK_WIDTH];
 
-unsigned	blocklights[LMBLOCK_WIDTH*LMBLOCK_HEIGHT*3 + 1]; //johnfitz -- was 18*18, added lit support (*3) and loosened surface extents maximum (LMBLOCK_WIDTH*LMBLOCK_HEIGHT)
-
 static vulkan_memory_t	bmodel_memory;
 VkBuffer				bmodel_vertex_buffer;
 
@@ -127,13 +130,13 @@ void DrawGLPoly (glpoly_t *p, float color[3], float alpha)
 			indices[current_index++] = 1 + i;
 			indices[current_index++] = 2 + i;
 		}
-		vulkan_globals.vk_cmd_bind_index_buffer(vulkan_globals.command_buffer, index_buffer, index_buffer_offset, VK_INDEX_TYPE_UINT16);
+		vulkan_globals.vk_cmd_bind_index_buffer(vulkan_recording.command_buffer, index_buffer, index_buffer_offset, VK_INDEX_TYPE_UINT16);
 	}
 	else
-		vulkan_globals.vk_cmd_bind_index_buffer(vulkan_globals.command_buffer, vulkan_globals.fan_index_buffer, 0, VK_INDEX_TYPE_UINT16);
+		vulkan_globals.vk_cmd_bind_index_buffer(vulkan_recording.command_buffer, vulkan_globals.fan_index_buffer, 0, VK_INDEX_TYPE_UINT16);
 
-	vulkan_globals.vk_cmd_bind_vertex_buffers(vulkan_globals.command_buffer, 0, 1, &vertex_buffer, &vertex_buffer_offset);
-	vulkan_globals.vk_cmd_draw_indexed(vulkan_globals.command_buffer, numindices, 1, 0, 0, 0);
+	vulkan_globals.vk_cmd_bind_vertex_buffers(vulkan_recording.command_buffer, 0, 1, &vertex_buffer, &vertex_buffer_offset);
+	vulkan_globals.vk_cmd_draw_indexed(vulkan_recording.command_buffer, numindices, 1, 0, 0, 0);
 }
 
 /*
@@ -179,11 +182,11 @@ void R_DrawBrushModel (entity_t *e)
 	psurf = &clmodel->surfaces[clmodel->firstmodelsurface];
 
 	// calc this before doing the MarkLights so that we can use this matrix to transform the light
-	e->angles[0] = -e->angles[0];	// stupid quake bug
+	// don't flip e->angles in place, the sky stage may read them on another thread
+	vec3_t angles = { -e->angles[0], e->angles[1], e->angles[2] };	// stupid quake bug
 	float model_matrix[16];
 	IdentityMatrix (model_matrix);
-	R_RotateForEntity (model_matrix, e->origin, e->angles);
-	e->angles[0] = -e->angles[0];	// stupid quake bug
+	R_RotateForEntity (model_matrix, e->origin, angles);
 
 	// calculate dynamic lighting for bmodel if it's not an
 	// instanced model
@@ -221,6 +224,7 @@ void R_DrawBrushModel (entity_t *e)
 			rs_brushpolys++;
 		}
 	}
+	R_BuildQueuedLightmaps ();
 
 	R_DrawTextureChains (clmodel, e, chain_model);
 	R_DrawTextureChains_Water (clmodel, e, chain_model);
@@ -263,11 +267,10 @@ void R_DrawBrushModel_ShowTris(entity_t *e)
 
 	psurf = &clmodel->surfaces[clmodel->firstmodelsurface];
 
-	e->angles[0] = -e->angles[0];	// stupid quake bug
+	vec3_t angles = { -e->angles[0], e->angles[1], e->angles[2] };	// stupid quake bug
 	float model_matrix[16];
 	IdentityMatrix(model_matrix);
-	R_RotateForEntity (model_matrix, e->origin, e->angles);
-	e->angles[0] = -e->angles[0];	// stupid quake bug
+	R_RotateForEntity (model_matrix, e->origin, angles);
 
 	float mvp[16];
 	memcpy(mvp, vulkan_globals.view_projection_matrix, 16 * sizeof(float));
@@ -306,57 +309,272 @@ void R_DrawBrushModel_ShowTris(entity_t *e)
 
 /*
 ================
-R_RenderDynamicLightmaps
-called during rendering
+R_DlightHash
+
+identifies the set of dlights touching the surface this frame and everything
+about them R_AddDynamicLights depends on
 ================
 */
-void R_RenderDynamicLightmaps (msurface_t *fa)
+static unsigned int R_DlightHash (msurface_t *fa)
+{
+	unsigned int	hash = 2166136261u;
+	unsigned int	bits, data[8];
+	int				i, j, k;
+
+	for (i = 0; i < (MAX_DLIGHTS + 31) >> 5; i++)
+	{
+		for (bits = fa->dlightbits[i], j = 0; bits; bits >>= 1, j++)
+		{
+			dlight_t *dl;
+
+			if (!(bits & 1))
+				continue;
+
+			dl = &cl_dlights[i * 32 + j];
+			data[0] = i * 32 + j;
+			memcpy (&data[1], dl->transformed, sizeof (vec3_t));
+			memcpy (&data[4], &dl->radius, sizeof (float));
+			memcpy (&data[5], &dl->minlight, sizeof (float));
+			memcpy (&data[6], dl->color, 2 * sizeof (float));
+			for (k = 0; k < 8; k++)
+				hash = (hash ^ data[k]) * 16777619u;
+			memcpy (&data[0], &dl->color[2], sizeof (float));
+			hash = (hash ^ data[0]) * 16777619u;
+		}
+	}
+
+	return hash;
+}
+
+/*
+================
+R_LightmapNeedsUpdate
+
+read-only check, safe to call from worker threads
+================
+*/
+qboolean R_LightmapNeedsUpdate (msurface_t *fa)
 {
-	byte		*base;
 	int			maps;
-	glRect_t    *theRect;
-	int smax, tmax;
 
 	if (fa->flags & SURF_DRAWTILED) //johnfitz -- not a lightmapped surface
-		return;
+		return false;
+
+	if (!r_dynamic.value)
+		return false;
 
 	// check for lightmap modification
 	for (maps=0; maps < MAXLIGHTMAPS && fa->styles[maps] != 255; maps++)
 		if (d_lightstylevalue[fa->styles[maps]] != fa->cached_light[maps])
-			goto dynamic;
+			return true;
+
+	if (fa->dlightframe == r_framecount)	// dynamic this frame
+		return !fa->cached_dlight || (R_DlightHash (fa) != fa->cached_dlighthash);
+
+	return fa->cached_dlight;			// dynamic previously
+}
+
+static msurface_t	**queuedlightmaps;
+static int			numqueuedlightmaps, maxqueuedlightmaps;
+
+static unsigned int	**stylecaches;
+static int			numstylecaches, maxstylecaches;
 
-	if (fa->dlightframe == r_framecount	// dynamic this frame
-		|| fa->cached_dlight)			// dynamic previously
+/*
+================
+R_AllocStyleCache
+
+gives a surface that is rebuilt at runtime a cache of its combined styles.
+It starts out as the sum at all style values 0, so the first build fills it.
+================
+*/
+static void R_AllocStyleCache (msurface_t *fa)
+{
+	int maps;
+	int size = ((fa->extents[0]>>4)+1) * ((fa->extents[1]>>4)+1);
+
+	if (numstylecaches == maxstylecaches)
 	{
-dynamic:
-		if (r_dynamic.value)
+		maxstylecaches = q_max (maxstylecaches * 2, 256);
+		stylecaches = (unsigned int **) realloc (stylecaches, maxstylecaches * sizeof (unsigned int *));
+		if (!stylecaches)
+			Sys_Error ("R_AllocStyleCache: out of memory");
+	}
+
+	fa->stylecache = (unsigned int *) calloc (size * 3, sizeof (unsigned int));
+	if (!fa->stylecache)
+		Sys_Error ("R_AllocStyleCache: out of memory");
+	stylecaches[numstylecaches++] = fa->stylecache;
+
+	for (maps = 0; maps < MAXLIGHTMAPS; maps++)
+		fa->cached_light[maps] = 0;
+}
+
+/*
+================
+R_FreeStyleCaches
+================
+*/
+static void R_FreeStyleCaches (void)
+{
+	int i;
+
+	for (i = 0; i < numstylecaches; i++)
+		free (stylecaches[i]);
+	numstylecaches = 0;
+}
+
+/*
+================
+R_AddDirtyRect
+
+adds a region to the upload list of a lightmap block. Regions are kept
+disjoint, as vkCmdCopyBufferToImage requires: overlapping ones are merged, and
+so are neighbours whose bounding box wastes no texels. A full list merges the
+new region into the entry whose bounds grow the least.
+================
+*/
+static void R_AddDirtyRect (struct lightmap_s *lm, int l, int t, int w, int h)
+{
+	int			i, best, bestgrowth, growth;
+	int			ul, ut, ur, ub;
+	glRect_t	*rect;
+
+	for (;;)
+	{
+		best = -1;
+		bestgrowth = INT_MAX;
+		for (i = 0; i < lm->numdirtyrects; i++)
 		{
-			struct lightmap_s *lm = &lightmaps[fa->lightmaptexturenum];
-			lm->modified = true;
-			theRect = &lm->rectchange;
-			if (fa->light_t < theRect->t) {
-				if (theRect->h)
-					theRect->h += theRect->t - fa->light_t;
-				theRect->t = fa->light_t;
-			}
-			if (fa->light_s < theRect->l) {
-				if (theRect->w)
-					theRect->w += theRect->l - fa->light_s;
-				theRect->l = fa->light_s;
+			rect = &lm->dirtyrects[i];
+			ul = q_min (l, rect->l);
+			ut = q_min (t, rect->t);
+			ur = q_max (l + w, rect->l + rect->w);
+			ub = q_max (t + h, rect->t + rect->h);
+			growth = (ur - ul) * (ub - ut) - w * h - rect->w * rect->h;
+
+			if (l < rect->l + rect->w && rect->l < l + w && t < rect->t + rect->h && rect->t < t + h)
+				growth = INT_MIN; // overlapping, must merge
+			if (growth < bestgrowth)
+			{
+				best = i;
+				bestgrowth = growth;
 			}
-			smax = (fa->extents[0]>>4)+1;
-			tmax = (fa->extents[1]>>4)+1;
-			if ((theRect->w + theRect->l) < (fa->light_s + smax))
-				theRect->w = (fa->light_s-theRect->l)+smax;
-			if ((theRect->h + theRect->t) < (fa->light_t + tmax))
-				theRect->h = (fa->light_t-theRect->t)+tmax;
-			base = lm->data;
-			base += fa->light_t * LMBLOCK_WIDTH * lightmap_bytes + fa->light_s * lightmap_bytes;
-			R_BuildLightMap (fa, base, LMBLOCK_WIDTH*lightmap_bytes);
 		}
+
+		if (best == -1 || (bestgrowth > 0 && lm->numdirtyrects < MAX_LIGHTMAP_DIRTY_RECTS))
+		{
+			rect = &lm->dirtyrects[lm->numdirtyrects++];
+			rect->l = l;
+			rect->t = t;
+			rect->w = w;
+			rect->h = h;
+			return;
+		}
+
+		// merge with the best candidate and check the result against the others again
+		rect = &lm->dirtyrects[best];
+		ul = q_min (l, rect->l);
+		ut = q_min (t, rect->t);
+		w = q_max (l + w, rect->l + rect->w) - ul;
+		h = q_max (t + h, rect->t + rect->h) - ut;
+		l = ul;
+		t = ut;
+		*rect = lm->dirtyrects[--lm->numdirtyrects];
+	}
+}
+
+/*
+================
+R_QueueDynamicLightmap
+
+marks the surface's texels dirty in its lightmap and queues them for
+R_BuildQueuedLightmaps. Main thread only.
+================
+*/
+void R_QueueDynamicLightmap (msurface_t *fa)
+{
+	int smax, tmax;
+	struct lightmap_s *lm = &lightmaps[fa->lightmaptexturenum];
+
+	if (!fa->stylecache && fa->samples && cl.worldmodel->lightdata)
+		R_AllocStyleCache (fa);
+
+	smax = (fa->extents[0]>>4)+1;
+	tmax = (fa->extents[1]>>4)+1;
+	R_AddDirtyRect (lm, fa->light_s, fa->light_t, smax, tmax);
+
+	if (numqueuedlightmaps == maxqueuedlightmaps)
+	{
+		maxqueuedlightmaps = q_max (maxqueuedlightmaps * 2, 256);
+		queuedlightmaps = (msurface_t **) realloc (queuedlightmaps, maxqueuedlightmaps * sizeof (msurface_t *));
+		if (!queuedlightmaps)
+			Sys_Error ("R_QueueDynamicLightmap: out of memory");
+	}
+	queuedlightmaps[numqueuedlightmaps++] = fa;
+}
+
+/*
+================
+R_RenderDynamicLightmaps
+called during rendering
+================
+*/
+void R_RenderDynamicLightmaps (msurface_t *fa)
+{
+	if (R_LightmapNeedsUpdate (fa))
+		R_QueueDynamicLightmap (fa);
+}
+
+/*
+================
+R_BuildQueuedLightmapRange
+
+every surface has its own rect in its lightmap block, so surfaces can be
+rebuilt in any order and on any thread
+================
+*/
+#define LIGHTMAP_BUILD_RANGE	8	// surfaces per job
+
+static void R_BuildQueuedLightmapRange (int range, void *payload)
+{
+	int		i;
+	int		first = range * LIGHTMAP_BUILD_RANGE;
+	int		last = q_min (first + LIGHTMAP_BUILD_RANGE, numqueuedlightmaps);
+	byte	*base;
+
+	for (i = first; i < last; i++)
+	{
+		msurface_t *fa = queuedlightmaps[i];
+		base = lightmaps[fa->lightmaptexturenum].data;
+		base += fa->light_t * LMBLOCK_WIDTH * lightmap_bytes + fa->light_s * lightmap_bytes;
+		R_BuildLightMap (fa, base, LMBLOCK_WIDTH*lightmap_bytes);
 	}
 }
 
+/*
+================
+R_BuildQueuedLightmaps
+
+rebuilds the texels of all queued surfaces, in parallel if there are enough of them.
+Must run before R_UploadLightmaps and before the dlights are moved to another
+entity's space.
+================
+*/
+void R_BuildQueuedLightmaps (void)
+{
+	if (!numqueuedlightmaps)
+		return;
+
+	if (numqueuedlightmaps <= LIGHTMAP_BUILD_RANGE)
+		R_BuildQueuedLightmapRange (0, NULL);
+	else
+		Jobs_ParallelFor (R_BuildQueuedLightmapRange, (numqueuedlightmaps + LIGHTMAP_BUILD_RANGE - 1) / LIGHTMAP_BUILD_RANGE, NULL, 0);
+
+	rs_lightmapsurfs += numqueuedlightmaps;
+	numqueuedlightmaps = 0;
+}
+
 /*
 ========================
 AllocBlock -- returns a texture number and the position inside it
@@ -437,6 +655,7 @@ void GL_CreateSurfaceLightmap (msurface_t *surf)
 	smax = (surf->extents[0]>>4)+1;
 	tmax = (surf->extents[1]>>4)+1;
 
+	surf->stylecache = NULL;
 	surf->lightmaptexturenum = AllocBlock (smax, tmax, &surf->light_s, &surf->light_t);
 	base = lightmaps[surf->lightmaptexturenum].data;
 	base += (surf->light_t * LMBLOCK_WIDTH + surf->light_s) * lightmap_bytes;
@@ -525,6 +744,363 @@ void BuildSurfaceDisplayList (msurface_t *fa)
 	poly->numverts = lnumverts;
 }
 
+/*
+=============================================================
+
+	RENDER CACHE
+
+The lightmap atlas (layout and contents) and the brush model vertex array
+only depend on the brush models in the precache list. They are written to
+<gamedir>/rcache/<map>.rcache once built, and read back with a single
+mapping the next time the same models are loaded. The file is keyed by the
+models' names and checksums, so any change to a bsp or .lit rebuilds it.
+
+=============================================================
+*/
+
+#define RCACHE_MAGIC	(('C'<<24)+('R'<<16)+('K'<<8)+'V')	// "VKRC"
+#define RCACHE_VERSION	1
+
+typedef struct
+{
+	int				magic;
+	int				version;
+	int				lmblockwidth, lmblockheight, lmbytes;
+	int				nummodels;
+	int				lightmapcount;
+	int				numlitsurfaces;
+	unsigned int	numverts;
+} rcacheheader_t;
+
+typedef struct
+{
+	char			name[MAX_QPATH];
+	unsigned int	checksum;
+	int				numsurfaces;
+} rcachemodel_t;
+
+typedef struct
+{
+	int				texnum;
+	short			light_s, light_t;
+} rcachesurface_t;
+
+// followed by lightmapcount block heights, the used rows of every block and
+// numverts * VERTEXSIZE floats of vertex array
+
+static byte		*rcache_data;		// mapped cache file, until the vertex buffer is built
+static size_t	rcache_size;
+static float	*rcache_varray;
+
+/*
+================
+R_RenderCacheModels
+
+lists the models the lightmaps and vertex array are built from, -1 if one
+of them has no checksum because it was loaded while r_rendercache was off
+================
+*/
+static int R_RenderCacheModels (qmodel_t **models)
+{
+	int		j, count;
+	qmodel_t	*m;
+
+	for (j=1, count=0 ; j<MAX_MODELS ; j++)
+	{
+		m = cl.model_precache[j];
+		if (!m)
+			break;
+		if (m->name[0] == '*' || m->type != mod_brush)
+			continue;
+		if (!m->checksum)
+			return -1;
+		models[count++] = m;
+	}
+
+	return count;
+}
+
+/*
+================
+R_RenderCachePath
+================
+*/
+static void R_RenderCachePath (char *path, size_t size)
+{
+	char	base[MAX_QPATH];
+
+	COM_FileBase (cl.worldmodel->name, base, sizeof(base));
+	q_snprintf (path, size, "%s/rcache/%s.rcache", com_gamedir, base);
+}
+
+/*
+================
+R_ReleaseRenderCache
+================
+*/
+static void R_ReleaseRenderCache (void)
+{
+	if (rcache_data)
+		Sys_UnmapFile (rcache_data, rcache_size);
+	rcache_data = NULL;
+	rcache_size = 0;
+	rcache_varray = NULL;
+}
+
+/*
+================
+R_LoadRenderCache
+
+restores the lightmap blocks and the lightmapped surfaces' polys from the
+render cache. Returns false, leaving everything untouched, if there is no
+valid cache for the current set of models.
+================
+*/
+static qboolean R_LoadRenderCache (void)
+{
+	qmodel_t		*models[MAX_MODELS];
+	char			path[MAX_OSPATH];
+	rcacheheader_t	*header;
+	rcachemodel_t	*cmodels;
+	rcachesurface_t	*csurfs, *cs;
+	int				*heights;
+	byte			*rows;
+	float			*varray;
+	size_t			size, expected, numrows;
+	unsigned int	numverts;
+	int				i, j, maps, nummodels, numlitsurfaces;
+	msurface_t		*surf;
+	glpoly_t		*poly;
+
+	R_ReleaseRenderCache ();
+	if (!r_rendercache.value)
+		return false;
+	nummodels = R_RenderCacheModels (models);
+	if (nummodels < 0)
+		return false;
+
+	R_RenderCachePath (path, sizeof(path));
+	rcache_data = Sys_MapFile (path, &rcache_size);
+	if (!rcache_data)
+		return false;
+	size = rcache_size;
+
+	header = (rcacheheader_t *) rcache_data;
+	if (size < sizeof(*header) || header->magic != RCACHE_MAGIC || header->version != RCACHE_VERSION ||
+		header->lmblockwidth != LMBLOCK_WIDTH || header->lmblockheight != LMBLOCK_HEIGHT ||
+		header->lmbytes != lightmap_bytes || header->nummodels != nummodels ||
+		header->lightmapcount <= 0 || header->lightmapcount > (int)MAX_SANITY_LIGHTMAPS ||
+		header->numlitsurfaces < 0)
+		goto invalid;
+
+	// check the key and count what the models need
+	cmodels = (rcachemodel_t *) (header + 1);
+	expected = sizeof(*header) + nummodels * sizeof(*cmodels);
+	if (size < expected)
+		goto invalid;
+
+	numlitsurfaces = 0;
+	numverts = 0;
+	for (i=0 ; i<nummodels ; i++)
+	{
+		if (strncmp (cmodels[i].name, models[i]->name, MAX_QPATH) || cmodels[i].checksum != models[i]->checksum ||
+			cmodels[i].numsurfaces != models[i]->numsurfaces)
+			goto invalid;
+		for (j=0 ; j<models[i]->numsurfaces ; j++)
+		{
+			if (!(models[i]->surfaces[j].flags & SURF_DRAWTILED))
+				numlitsurfaces++;
+			numverts += models[i]->surfaces[j].numedges;
+		}
+	}
+	if (header->numlitsurfaces != numlitsurfaces || header->numverts != numverts)
+		goto invalid;
+
+	csurfs = (rcachesurface_t *) (cmodels + nummodels);
+	heights = (int *) (csurfs + numlitsurfaces);
+	expected += numlitsurfaces * sizeof(*csurfs) + header->lightmapcount * sizeof(*heights);
+	if (size < expected)
+		goto invalid;
+
+	numrows = 0;
+	for (i=0 ; i<header->lightmapcount ; i++)
+	{
+		if (heights[i] < 0 || heights[i] > LMBLOCK_HEIGHT)
+			goto invalid;
+		numrows += heights[i];
+	}
+	rows = (byte *) (heights + header->lightmapcount);
+	varray = (float *) (rows + numrows * LMBLOCK_WIDTH * lightmap_bytes);
+	expected += numrows * LMBLOCK_WIDTH * lightmap_bytes + (size_t)numverts * VERTEXSIZE * sizeof(float);
+	if (size != expected)
+		goto invalid;
+
+	for (i=0, cs=csurfs ; i<nummodels ; i++)
+	{
+		for (j=0 ; j<models[i]->numsurfaces ; j++)
+		{
+			surf = &models[i]->surfaces[j];
+			if (surf->flags & SURF_DRAWTILED)
+				continue;
+			if (cs->texnum < 0 || cs->texnum >= header->lightmapcount ||
+				cs->light_s < 0 || cs->light_s + (surf->extents[0]>>4)+1 > LMBLOCK_WIDTH ||
+				cs->light_t < 0 || cs->light_t + (surf->extents[1]>>4)+1 > heights[cs->texnum])
+				goto invalid;
+			cs++;
+		}
+	}
+
+	// the cache is valid, restore the lightmap blocks
+	lightmap_count = header->lightmapcount;
+	lightmaps = (struct lightmap_s *) calloc (lightmap_count, sizeof(*lightmaps));
+	if (!lightmaps)
+		Sys_Error ("R_LoadRenderCache: out of memory");
+	for (i=0 ; i<lightmap_count ; i++)
+	{
+		lightmaps[i].data = (byte *) calloc (1, 4*LMBLOCK_WIDTH*LMBLOCK_HEIGHT);
+		if (!lightmaps[i].data)
+			Sys_Error ("R_LoadRenderCache: out of memory");
+		memcpy (lightmaps[i].data, rows, heights[i] * LMBLOCK_WIDTH * lightmap_bytes);
+		rows += heights[i] * LMBLOCK_WIDTH * lightmap_bytes;
+	}
+
+	// and the state GL_CreateSurfaceLightmap and BuildSurfaceDisplayList leave behind
+	rcache_varray = varray;
+	for (i=0, cs=csurfs ; i<nummodels ; i++)
+	{
+		for (j=0 ; j<models[i]->numsurfaces ; j++, varray += surf->numedges * VERTEXSIZE)
+		{
+			surf = &models[i]->surfaces[j];
+			if (surf->flags & SURF_DRAWTILED)
+				continue;
+
+			surf->stylecache = NULL;
+			surf->lightmaptexturenum = cs->texnum;
+			surf->light_s = cs->light_s;
+			surf->light_t = cs->light_t;
+			surf->cached_dlight = false;
+			if (cl.worldmodel->lightdata && surf->samples)
+				for (maps = 0 ; maps < MAXLIGHTMAPS && surf->styles[maps] != 255 ; maps++)
+					surf->cached_light[maps] = d_lightstylevalue[surf->styles[maps]];
+			cs++;
+
+			poly = (glpoly_t *) Hunk_Alloc (sizeof(glpoly_t) + (surf->numedges-4) * VERTEXSIZE*sizeof(float));
+			poly->next = surf->polys;
+			surf->polys = poly;
+			poly->numverts = surf->numedges;
+			memcpy (poly->verts, varray, surf->numedges * VERTEXSIZE * sizeof(float));
+		}
+	}
+
+	Con_DPrintf ("loaded render cache %s\n", path);
+	return true;
+
+invalid:
+	Con_DPrintf ("render cache %s is out of date\n", path);
+	R_ReleaseRenderCache ();
+	return false;
+}
+
+/*
+================
+R_SaveRenderCache
+
+writes the lightmap blocks and the vertex array just built to the render cache
+================
+*/
+static void R_SaveRenderCache (const float *varray, unsigned int numverts)
+{
+	qmodel_t		*models[MAX_MODELS];
+	char			path[MAX_OSPATH];
+	rcacheheader_t	header;
+	rcachemodel_t	cmodel;
+	rcachesurface_t	*csurfs, *cs;
+	int				*heights;
+	int				i, j, nummodels, numlitsurfaces;
+	msurface_t		*surf;
+	FILE			*f;
+
+	if (!r_rendercache.value)
+		return;
+
+	nummodels = R_RenderCacheModels (models);
+	if (nummodels < 0)
+		return;
+	for (i=0, numlitsurfaces=0 ; i<nummodels ; i++)
+		for (j=0 ; j<models[i]->numsurfaces ; j++)
+			if (!(models[i]->surfaces[j].flags & SURF_DRAWTILED))
+				numlitsurfaces++;
+
+	csurfs = (rcachesurface_t *) malloc (numlitsurfaces * sizeof(*csurfs) + 1);
+	heights = (int *) calloc (lightmap_count + 1, sizeof(*heights));
+	if (!csurfs || !heights)
+		Sys_Error ("R_SaveRenderCache: out of memory");
+
+	// only the rows of each block that are in use are stored
+	for (i=0, cs=csurfs ; i<nummodels ; i++)
+	{
+		for (j=0 ; j<models[i]->numsurfaces ; j++)
+		{
+			surf = &models[i]->surfaces[j];
+			if (surf->flags & SURF_DRAWTILED)
+				continue;
+			cs->texnum = surf->lightmaptexturenum;
+			cs->light_s = surf->light_s;
+			cs->light_t = surf->light_t;
+			heights[cs->texnum] = q_max (heights[cs->texnum], surf->light_t + (surf->extents[1]>>4)+1);
+			cs++;
+		}
+	}
+
+	R_RenderCachePath (path, sizeof(path));
+	COM_CreatePath (path);
+	f = fopen (path, "wb");
+	if (!f)
+	{
+		Con_DPrintf ("couldn't write render cache %s\n", path);
+		free (csurfs);
+		free (heights);
+		return;
+	}
+
+	header.magic = RCACHE_MAGIC;
+	header.version = RCACHE_VERSION;
+	header.lmblockwidth = LMBLOCK_WIDTH;
+	header.lmblockheight = LMBLOCK_HEIGHT;
+	header.lmbytes = lightmap_bytes;
+	header.nummodels = nummodels;
+	header.lightmapcount = lightmap_count;
+	header.numlitsurfaces = numlitsurfaces;
+	header.numverts = numverts;
+	fwrite (&header, sizeof(header), 1, f);
+
+	for (i=0 ; i<nummodels ; i++)
+	{
+		memset (&cmodel, 0, sizeof(cmodel));
+		q_strlcpy (cmodel.name, models[i]->name, sizeof(cmodel.name));
+		cmodel.checksum = models[i]->checksum;
+		cmodel.numsurfaces = models[i]->numsurfaces;
+		fwrite (&cmodel, sizeof(cmodel), 1, f);
+	}
+	fwrite (csurfs, sizeof(*csurfs), numlitsurfaces, f);
+	fwrite (heights, sizeof(*heights), lightmap_count, f);
+	for (i=0 ; i<lightmap_count ; i++)
+		fwrite (lightmaps[i].data, LMBLOCK_WIDTH * lightmap_bytes, heights[i], f);
+	fwrite (varray, VERTEXSIZE * sizeof(float), numverts, f);
+
+	if (ferror (f))
+	{
+		fclose (f);
+		Con_DPrintf ("couldn't write render cache %s\n", path);
+		remove (path);
+	}
+	else
+		fclose (f);
+
+	free (csurfs);
+	free (heights);
+}
+
 /*
 ==================
 GL_BuildLightmaps -- called at level load time
@@ -542,6 +1118,8 @@ void GL_BuildLightmaps (void)
 
 	r_framecount = 1; // no dlightcache
 
+	R_FreeStyleCaches ();
+
 	//Spike -- wipe out all the lightmap data (johnfitz -- the gltexture objects were already freed by Mod_ClearAll)
 	for (i=0; i < lightmap_count; i++)
 		free(lightmaps[i].data);
@@ -552,23 +1130,26 @@ void GL_BuildLightmaps (void)
 
 	lightmap_bytes = 4;
 
-	for (j=1 ; j<MAX_MODELS ; j++)
+	if (!R_LoadRenderCache ())
 	{
-		m = cl.model_precache[j];
-		if (!m)
-			break;
-		if (m->name[0] == '*')
-			continue;
-		r_pcurrentvertbase = m->vertexes;
-		currentmodel = m;
-		for (i=0 ; i<m->numsurfaces ; i++)
+		for (j=1 ; j<MAX_MODELS ; j++)
 		{
-			//johnfitz -- rewritten to use SURF_DRAWTILED instead of the sky/water flags
-			if (m->surfaces[i].flags & SURF_DRAWTILED)
+			m = cl.model_precache[j];
+			if (!m)
+				break;
+			if (m->name[0] == '*')
 				continue;
-			GL_CreateSurfaceLightmap (m->surfaces + i);
-			BuildSurfaceDisplayList (m->surfaces + i);
-			//johnfitz
+			r_pcurrentvertbase = m->vertexes;
+			currentmodel = m;
+			for (i=0 ; i<m->numsurfaces ; i++)
+			{
+				//johnfitz -- rewritten to use SURF_DRAWTILED instead of the sky/water flags
+				if (m->surfaces[i].flags & SURF_DRAWTILED)
+					continue;
+				GL_CreateSurfaceLightmap (m->surfaces + i);
+				BuildSurfaceDisplayList (m->surfaces + i);
+				//johnfitz
+			}
 		}
 	}
 
@@ -578,11 +1159,7 @@ void GL_BuildLightmaps (void)
 	for (i=0; i<lightmap_count; i++)
 	{
 		lm = &lightmaps[i];
-		lm->modified = false;
-		lm->rectchange.l = LMBLOCK_WIDTH;
-		lm->rectchange.t = LMBLOCK_HEIGHT;
-		lm->rectchange.w = 0;
-		lm->rectchange.h = 0;
+		lm->numdirtyrects = 0;
 
 		//johnfitz -- use texture manager
 		sprintf(name, "lightmap%07i",i);
@@ -653,9 +1230,9 @@ void GL_BuildBModelVertexBuffer (void)
 		}
 	}
 	
-	// build vertex array
+	// build vertex array, unless the render cache already has it
 	varray_bytes = VERTEXSIZE * sizeof(float) * numverts;
-	varray = (float *) malloc (varray_bytes);
+	varray = rcache_varray ? rcache_varray : (float *) malloc (varray_bytes);
 	varray_index = 0;
 	
 	for (j=1 ; j<MAX_MODELS ; j++)
@@ -668,7 +1245,8 @@ void GL_BuildBModelVertexBuffer (void)
 		{
 			msurface_t *s = &m->surfaces[i];
 			s->vbo_firstvert = varray_index;
-			memcpy (&varray[VERTEXSIZE * varray_index], s->polys->verts, VERTEXSIZE * sizeof(float) * s->numedges);
+			if (!rcache_varray)
+				memcpy (&varray[VERTEXSIZE * varray_index], s->polys->verts, VERTEXSIZE * sizeof(float) * s->numedges);
 			varray_index += s->numedges;
 		}
 	}
@@ -732,7 +1310,13 @@ void GL_BuildBModelVertexBuffer (void)
 		remaining_size -= size_to_copy;
 	}
 
-	free (varray);
+	if (rcache_varray)
+		R_ReleaseRenderCache ();
+	else
+	{
+		R_SaveRenderCache (varray, numverts);
+		free (varray);
+	}
 }
 
 /*
@@ -740,7 +1324,7 @@ void GL_BuildBModelVertexBuffer (void)
 R_AddDynamicLights
 ===============
 */
-void R_AddDynamicLights (msurface_t *surf)
+void R_AddDynamicLights (msurface_t *surf, unsigned *blocklights)
 {
 	int			lnum;
 	int			sd, td;
@@ -823,63 +1407,129 @@ void R_AddDynamicLights (msurface_t *surf)
 
 /*
 ===============
-R_AccumulateLightmap
+R_ScaleLightmap
 
-Scales 'lightmap' contents (RGB8) by 'scale' and accumulates
-the result in the 'blocklights' array (RGB32)
+Scales 'lightmap' contents (RGB8) by 'scale' and adds the result to
+or subtracts it from the RGB32 array 'bl'
 ===============
 */
-void R_AccumulateLightmap(byte* lightmap, unsigned scale, int texels)
+static inline void R_ScaleLightmap(unsigned* bl, byte* lightmap, unsigned scale, int texels, const qboolean subtract)
 {
-	unsigned *bl = blocklights;
 	int size = texels * 3;
 
 #ifdef USE_SSE2
-	if (use_simd && size >= 8)
+	if (use_simd)
 	{
+		// scale fits 16 bits, so mullo/mulhi give the full 24 bit products
 		__m128i vscale = _mm_set1_epi16(scale);
-		__m128i vlo, vhi, vdst, vsrc, v;
+		__m128i vzero = _mm_setzero_si128();
+		__m128i vlo, vhi, vsrc, v;
 
-		while (size >= 8)
+#define OP_EPI32(a, b) (subtract ? _mm_sub_epi32(a, b) : _mm_add_epi32(a, b))
+		while (size >= 16)
 		{
-			vsrc = _mm_loadl_epi64((const __m128i*)lightmap);
+			vsrc = _mm_loadu_si128((const __m128i*)lightmap);
 
-			v = _mm_unpacklo_epi8(vsrc, _mm_setzero_si128());
+			v = _mm_unpacklo_epi8(vsrc, vzero);
 			vlo = _mm_mullo_epi16(v, vscale);
 			vhi = _mm_mulhi_epu16(v, vscale);
+			_mm_storeu_si128((__m128i*)bl + 0, OP_EPI32(_mm_loadu_si128((const __m128i*)bl + 0), _mm_unpacklo_epi16(vlo, vhi)));
+			_mm_storeu_si128((__m128i*)bl + 1, OP_EPI32(_mm_loadu_si128((const __m128i*)bl + 1), _mm_unpackhi_epi16(vlo, vhi)));
 
-			vdst = _mm_loadu_si128((const __m128i*)bl);
-			vdst = _mm_add_epi32(vdst, _mm_unpacklo_epi16(vlo, vhi));
-			_mm_storeu_si128((__m128i*)bl, vdst);
-			bl += 4;
+			v = _mm_unpackhi_epi8(vsrc, vzero);
+			vlo = _mm_mullo_epi16(v, vscale);
+			vhi = _mm_mulhi_epu16(v, vscale);
+			_mm_storeu_si128((__m128i*)bl + 2, OP_EPI32(_mm_loadu_si128((const __m128i*)bl + 2), _mm_unpacklo_epi16(vlo, vhi)));
+			_mm_storeu_si128((__m128i*)bl + 3, OP_EPI32(_mm_loadu_si128((const __m128i*)bl + 3), _mm_unpackhi_epi16(vlo, vhi)));
 
-			vdst = _mm_loadu_si128((const __m128i*)bl);
-			vdst = _mm_add_epi32(vdst, _mm_unpackhi_epi16(vlo, vhi));
-			_mm_storeu_si128((__m128i*)bl, vdst);
-			bl += 4;
+			bl += 16;
+			lightmap += 16;
+			size -= 16;
+		}
+
+		if (size >= 8)
+		{
+			vsrc = _mm_loadl_epi64((const __m128i*)lightmap);
 
+			v = _mm_unpacklo_epi8(vsrc, vzero);
+			vlo = _mm_mullo_epi16(v, vscale);
+			vhi = _mm_mulhi_epu16(v, vscale);
+			_mm_storeu_si128((__m128i*)bl + 0, OP_EPI32(_mm_loadu_si128((const __m128i*)bl + 0), _mm_unpacklo_epi16(vlo, vhi)));
+			_mm_storeu_si128((__m128i*)bl + 1, OP_EPI32(_mm_loadu_si128((const __m128i*)bl + 1), _mm_unpackhi_epi16(vlo, vhi)));
+
+			bl += 8;
 			lightmap += 8;
 			size -= 8;
 		}
+#undef OP_EPI32
+	}
+#elif defined(USE_NEON)
+	{
+		const uint16_t vscale = scale;
+
+#define OP_N_U16(a, b, c) (subtract ? vmlsl_n_u16(a, b, c) : vmlal_n_u16(a, b, c))
+		while (size >= 16)
+		{
+			uint8x16_t vsrc = vld1q_u8(lightmap);
+			uint16x8_t vlo = vmovl_u8(vget_low_u8(vsrc));
+			uint16x8_t vhi = vmovl_u8(vget_high_u8(vsrc));
+
+			vst1q_u32(bl +  0, OP_N_U16(vld1q_u32(bl +  0), vget_low_u16(vlo), vscale));
+			vst1q_u32(bl +  4, OP_N_U16(vld1q_u32(bl +  4), vget_high_u16(vlo), vscale));
+			vst1q_u32(bl +  8, OP_N_U16(vld1q_u32(bl +  8), vget_low_u16(vhi), vscale));
+			vst1q_u32(bl + 12, OP_N_U16(vld1q_u32(bl + 12), vget_high_u16(vhi), vscale));
+
+			bl += 16;
+			lightmap += 16;
+			size -= 16;
+		}
+#undef OP_N_U16
 	}
 #endif // def USE_SSE2
 
-	while (size-- > 0)
-		*bl++ += *lightmap++ * scale;
+	if (subtract)
+		while (size-- > 0)
+			*bl++ -= *lightmap++ * scale;
+	else
+		while (size-- > 0)
+			*bl++ += *lightmap++ * scale;
+}
+
+/*
+===============
+R_AccumulateLightmap
+
+Scales 'lightmap' contents (RGB8) by 'scale' and accumulates
+the result in the RGB32 array 'bl'
+===============
+*/
+void R_AccumulateLightmap(unsigned* bl, byte* lightmap, unsigned scale, int texels)
+{
+	R_ScaleLightmap(bl, lightmap, scale, texels, false);
+}
+
+/*
+===============
+R_SubtractLightmap
+===============
+*/
+void R_SubtractLightmap(unsigned* bl, byte* lightmap, unsigned scale, int texels)
+{
+	R_ScaleLightmap(bl, lightmap, scale, texels, true);
 }
 
 /*
 ===============
 R_StoreLightmap
 
-Converts contiguous lightmap info accumulated in 'blocklights'
+Converts contiguous lightmap info accumulated in 'src'
 from RGB32 (with 8 fractional bits) to RGBA8, saturates and
-stores the result in 'dest'
+stores the result in 'dest'. 'src' must have one more readable
+value past the last texel.
 ===============
 */
-void R_StoreLightmap(byte* dest, int width, int height, int stride)
+void R_StoreLightmap(unsigned* src, byte* dest, int width, int height, int stride)
 {
-	unsigned *src = blocklights;
 
 #ifdef USE_SSE2
 	if (use_simd)
@@ -888,8 +1538,27 @@ void R_StoreLightmap(byte* dest, int width, int height, int stride)
 
 		while (height-- > 0)
 		{
-			int i;
-			for (i = 0; i < width; i++)
+			int i = 0;
+
+			// 4 texels: 12 channels are saturated into 12 packed RGB bytes, then spread to RGBA
+			for (; i + 4 <= width; i += 4)
+			{
+				__m128i v0 = _mm_srli_epi32(_mm_loadu_si128((const __m128i*)src + 0), 9);
+				__m128i v1 = _mm_srli_epi32(_mm_loadu_si128((const __m128i*)src + 1), 9);
+				__m128i v2 = _mm_srli_epi32(_mm_loadu_si128((const __m128i*)src + 2), 9);
+				__m128i v = _mm_packus_epi16(_mm_packs_epi32(v0, v1), _mm_packs_epi32(v2, vzero));
+				uint32_t w0 = _mm_cvtsi128_si32(v);
+				uint32_t w1 = _mm_cvtsi128_si32(_mm_srli_si128(v, 4));
+				uint32_t w2 = _mm_cvtsi128_si32(_mm_srli_si128(v, 8));
+
+				((uint32_t*)dest)[i + 0] = w0 | 0xff000000;
+				((uint32_t*)dest)[i + 1] = (w0 >> 24) | (w1 << 8) | 0xff000000;
+				((uint32_t*)dest)[i + 2] = (w1 >> 16) | (w2 << 16) | 0xff000000;
+				((uint32_t*)dest)[i + 3] = (w2 >> 8) | 0xff000000;
+				src += 12;
+			}
+
+			for (; i < width; i++)
 			{
 				__m128i v = _mm_srli_epi32(_mm_loadu_si128((const __m128i*)src), 9);
 				v = _mm_packs_epi32(v, vzero);
@@ -902,6 +1571,40 @@ void R_StoreLightmap(byte* dest, int width, int height, int stride)
 	}
 	else
 #endif // def USE_SSE2
+#if defined(USE_NEON)
+	{
+		uint8x8x4_t vdst;
+		vdst.val[3] = vdup_n_u8(255);
+
+		while (height-- > 0)
+		{
+			int i = 0;
+
+			// 8 texels: vld3 deinterleaves the channels, vst4 interleaves them again with alpha
+			for (; i + 8 <= width; i += 8)
+			{
+				uint32x4x3_t lo = vld3q_u32(src);
+				uint32x4x3_t hi = vld3q_u32(src + 12);
+				int c;
+
+				for (c = 0; c < 3; c++)
+					vdst.val[c] = vqmovn_u16(vcombine_u16(vqmovn_u32(vshrq_n_u32(lo.val[c], 9)), vqmovn_u32(vshrq_n_u32(hi.val[c], 9))));
+				vst4_u8(dest + i * 4, vdst);
+				src += 24;
+			}
+
+			for (; i < width; i++)
+			{
+				unsigned c;
+				c = *src++ >> 9; dest[i * 4 + 0] = q_min(c, 255);
+				c = *src++ >> 9; dest[i * 4 + 1] = q_min(c, 255);
+				c = *src++ >> 9; dest[i * 4 + 2] = q_min(c, 255);
+				dest[i * 4 + 3] = 255;
+			}
+			dest += stride;
+		}
+	}
+#else
 	{
 		stride -= width * 4;
 		while (height-- > 0)
@@ -918,6 +1621,120 @@ void R_StoreLightmap(byte* dest, int width, int height, int stride)
 			dest += stride;
 		}
 	}
+#endif // defined(USE_NEON)
+}
+
+/*
+===============
+R_LightmapTest_f
+
+r_lightmaptest [iterations]: feeds random lightmaps, scales and sizes through
+R_AccumulateLightmap, R_SubtractLightmap and R_StoreLightmap and compares the
+results bit for bit with plain C.  Covers the SSE2 kernels with r_simd on
+and off, and the NEON ones on builds that have them.
+===============
+*/
+static int R_LightmapTestRun (int iterations)
+{
+	const int	maxtexels = 300, maxwidth = 64, maxheight = 8, pad = 8;
+	const int	destsize = maxheight * (maxwidth + pad) * 4;
+	const int	blsize = (q_max (maxtexels, maxwidth * maxheight) * 3 + 1) * sizeof (unsigned);
+	unsigned	*bl, *ref;
+	byte		*lightmap, *dest, *refdest;
+	int			i, j, x, y, texels, width, height, stride, errors = 0;
+	unsigned	scale, c;
+	qboolean	subtract;
+
+	bl = (unsigned *) malloc (blsize);
+	ref = (unsigned *) malloc (blsize);
+	lightmap = (byte *) malloc (maxtexels * 3);
+	dest = (byte *) malloc (destsize);
+	refdest = (byte *) malloc (destsize);
+	if (!bl || !ref || !lightmap || !dest || !refdest)
+		Sys_Error ("R_LightmapTest_f: out of memory");
+
+	for (i = 0; i < iterations; i++)
+	{
+		// scale and accumulate / subtract
+		texels = 1 + rand () % maxtexels;
+		scale = ((unsigned)rand () << 8 ^ rand ()) & 0xffff;	// lightstyle values fit 16 bits
+		subtract = rand () & 1;
+		for (j = 0; j < texels * 3; j++)
+		{
+			lightmap[j] = rand () & 255;
+			bl[j] = ref[j] = (unsigned)rand () << 16 ^ rand ();
+		}
+		if (subtract)
+		{
+			R_SubtractLightmap (bl, lightmap, scale, texels);
+			for (j = 0; j < texels * 3; j++)
+				ref[j] -= lightmap[j] * scale;
+		}
+		else
+		{
+			R_AccumulateLightmap (bl, lightmap, scale, texels);
+			for (j = 0; j < texels * 3; j++)
+				ref[j] += lightmap[j] * scale;
+		}
+		if (memcmp (bl, ref, texels * 3 * sizeof (unsigned)))
+		{
+			if (!errors++)
+				Con_Printf ("%s: %i texels, scale %u differ\n", subtract ? "R_SubtractLightmap" : "R_AccumulateLightmap", texels, scale);
+		}
+
+		// store, saturating, into rows narrower than the stride
+		width = 1 + rand () % maxwidth;
+		height = 1 + rand () % maxheight;
+		stride = (width + rand () % pad) * 4;
+		for (j = 0; j < width * height * 3 + 1; j++)
+			bl[j] = (rand () & 1) ? (unsigned)rand () % (300 << 9) : (unsigned)rand () << 16 ^ rand ();
+		memset (dest, 0xcd, destsize);
+		memset (refdest, 0xcd, destsize);
+		R_StoreLightmap (bl, dest, width, height, stride);
+		for (y = 0; y < height; y++)
+		{
+			for (x = 0; x < width; x++)
+			{
+				for (j = 0; j < 3; j++)
+				{
+					c = bl[(y * width + x) * 3 + j] >> 9;
+					refdest[y * stride + x * 4 + j] = q_min (c, 255);
+				}
+				refdest[y * stride + x * 4 + 3] = 255;
+			}
+		}
+		if (memcmp (dest, refdest, destsize))
+		{
+			if (!errors++)
+				Con_Printf ("R_StoreLightmap: %ix%i, stride %i differ\n", width, height, stride);
+		}
+	}
+
+	free (bl);
+	free (ref);
+	free (lightmap);
+	free (dest);
+	free (refdest);
+	return errors;
+}
+
+void R_LightmapTest_f (void)
+{
+	int		iterations = (Cmd_Argc () > 1) ? Q_atoi (Cmd_Argv (1)) : 10000;
+#if defined(USE_SIMD)
+	qboolean	saved_simd = use_simd;
+
+	use_simd = SDL_HasSSE () && SDL_HasSSE2 ();
+	if (use_simd)
+		Con_Printf ("lightmap kernels, SSE2: %i mismatches in %i cases\n", R_LightmapTestRun (iterations), iterations);
+	use_simd = false;
+	Con_Printf ("lightmap kernels, plain C: %i mismatches in %i cases\n", R_LightmapTestRun (iterations), iterations);
+	use_simd = saved_simd;
+#elif defined(USE_NEON)
+	Con_Printf ("lightmap kernels, NEON: %i mismatches in %i cases\n", R_LightmapTestRun (iterations), iterations);
+#else
+	Con_Printf ("lightmap kernels, plain C: %i mismatches in %i cases\n", R_LightmapTestRun (iterations), iterations);
+#endif
 }
 
 /*
@@ -934,15 +1751,42 @@ void R_BuildLightMap (msurface_t *surf, byte *dest, int stride)
 	byte		*lightmap;
 	unsigned	scale;
 	int			maps;
+	unsigned	*blocklights;
+	int			mark;
 
 	surf->cached_dlight = (surf->dlightframe == r_framecount);
+	if (surf->cached_dlight)
+		surf->cached_dlighthash = R_DlightHash (surf);
 
 	smax = (surf->extents[0]>>4)+1;
 	tmax = (surf->extents[1]>>4)+1;
 	size = smax*tmax;
 	lightmap = surf->samples;
 
-	if (cl.worldmodel->lightdata)
+	mark = Scratch_Mark ();
+	blocklights = (unsigned *) Scratch_Alloc ((size * 3 + 1) * sizeof (unsigned)); // +1 for R_StoreLightmap
+
+	if (cl.worldmodel->lightdata && surf->stylecache)
+	{
+		// only recomposite the styles that changed since the last build
+		for (maps = 0 ; maps < MAXLIGHTMAPS && surf->styles[maps] != 255 ; maps++)
+		{
+			scale = d_lightstylevalue[surf->styles[maps]];
+			if (scale > (unsigned)surf->cached_light[maps])
+				R_AccumulateLightmap(surf->stylecache, lightmap, scale - surf->cached_light[maps], size);
+			else if (scale < (unsigned)surf->cached_light[maps])
+				R_SubtractLightmap(surf->stylecache, lightmap, surf->cached_light[maps] - scale, size);
+			surf->cached_light[maps] = scale;	// 8.8 fraction
+			lightmap += size * 3;
+		}
+
+		memcpy (&blocklights[0], surf->stylecache, size * 3 * sizeof (unsigned int));
+
+		// add all the dynamic lights
+		if (surf->dlightframe == r_framecount)
+			R_AddDynamicLights (surf, blocklights);
+	}
+	else if (cl.worldmodel->lightdata)
 	{
 		// clear to no light
 		memset (&blocklights[0], 0, size * 3 * sizeof (unsigned int)); //johnfitz -- lit support via lordhavoc
@@ -956,7 +1800,7 @@ void R_BuildLightMap (msurface_t *surf, byte *dest, int stride)
 				scale = d_lightstylevalue[surf->styles[maps]];
 				surf->cached_light[maps] = scale;	// 8.8 fraction
 				//johnfitz -- lit support via lordhavoc
-				R_AccumulateLightmap(lightmap, scale, size);
+				R_AccumulateLightmap(blocklights, lightmap, scale, size);
 				lightmap += size * 3;
 				//johnfitz
 			}
@@ -964,7 +1808,7 @@ void R_BuildLightMap (msurface_t *surf, byte *dest, int stride)
 
 		// add all the dynamic lights
 		if (surf->dlightframe == r_framecount)
-			R_AddDynamicLights (surf);
+			R_AddDynamicLights (surf, blocklights);
 	}
 	else
 	{
@@ -972,44 +1816,46 @@ void R_BuildLightMap (msurface_t *surf, byte *dest, int stride)
 		memset (&blocklights[0], 255, size * 3 * sizeof (unsigned int)); //johnfitz -- lit support via lordhavoc
 	}
 
-	R_StoreLightmap(dest, smax, tmax, stride);
+	R_StoreLightmap(blocklights, dest, smax, tmax, stride);
+	Scratch_FreeToMark (mark);
 }
 
 /*
 ===============
 R_UploadLightmap -- johnfitz -- uploads the modified lightmap to opengl if necessary
 
-assumes lightmap texture is already bound
+copies the dirty regions into 'staging_memory' and records one copy with a
+region per dirty rect. Returns the number of staging bytes used.
 ===============
 */
-static void R_UploadLightmap(int lmap, gltexture_t * lightmap_tex)
+static int R_UploadLightmap(int lmap, gltexture_t * lightmap_tex, VkCommandBuffer command_buffer, VkBuffer staging_buffer, int staging_offset, byte * staging_memory)
 {
 	struct lightmap_s *lm = &lightmaps[lmap];
-	if (!lm->modified)
-		return;
-
-	lm->modified = false;
+	VkBufferImageCopy regions[MAX_LIGHTMAP_DIRTY_RECTS];
+	int i, row, row_size, size = 0;
 
-	const int staging_size = LMBLOCK_WIDTH * lm->rectchange.h * 4;
-
-	VkBuffer staging_buffer;
-	VkCommandBuffer command_buffer;
-	int staging_offset;
-	unsigned char * staging_memory = R_StagingAllocate(staging_size, 4, &command_buffer, &staging_buffer, &staging_offset);
-
-	byte * data = lm->data+lm->rectchange.t*LMBLOCK_WIDTH*lightmap_bytes;
-	memcpy(staging_memory, data, staging_size);
-
-	VkBufferImageCopy region;
-	memset(&region, 0, sizeof(region));
-	region.bufferOffset = staging_offset;
-	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-	region.imageSubresource.layerCount = 1;
-	region.imageSubresource.mipLevel = 0;
-	region.imageExtent.width = LMBLOCK_WIDTH;
-	region.imageExtent.height = lm->rectchange.h;
-	region.imageExtent.depth = 1;
-	region.imageOffset.y = lm->rectchange.t;
+	for (i = 0; i < lm->numdirtyrects; i++)
+	{
+		glRect_t *rect = &lm->dirtyrects[i];
+		byte * data = lm->data + (rect->t * LMBLOCK_WIDTH + rect->l) * lightmap_bytes;
+
+		row_size = rect->w * lightmap_bytes;
+		for (row = 0; row < rect->h; row++)
+			memcpy(staging_memory + size + row * row_size, data + row * LMBLOCK_WIDTH * lightmap_bytes, row_size);
+
+		memset(&regions[i], 0, sizeof(regions[i]));
+		regions[i].bufferOffset = staging_offset + size;
+		regions[i].imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		regions[i].imageSubresource.layerCount = 1;
+		regions[i].imageSubresource.mipLevel = 0;
+		regions[i].imageExtent.width = rect->w;
+		regions[i].imageExtent.height = rect->h;
+		regions[i].imageExtent.depth = 1;
+		regions[i].imageOffset.x = rect->l;
+		regions[i].imageOffset.y = rect->t;
+
+		size += row_size * rect->h;
+	}
 
 	VkImageMemoryBarrier image_memory_barrier;
 	memset(&image_memory_barrier, 0, sizeof(image_memory_barrier));
@@ -1029,7 +1875,7 @@ static void R_UploadLightmap(int lmap, gltexture_t * lightmap_tex)
 
 	vulkan_globals.vk_cmd_pipeline_barrier(command_buffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, NULL, 0, NULL, 1, &image_memory_barrier);
 	
-	vulkan_globals.vk_cmd_copy_buffer_to_image(command_buffer, staging_buffer, lightmap_tex->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+	vulkan_globals.vk_cmd_copy_buffer_to_image(command_buffer, staging_buffer, lightmap_tex->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, lm->numdirtyrects, regions);
 
 	image_memory_barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
 	image_memory_barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
@@ -1037,23 +1883,69 @@ static void R_UploadLightmap(int lmap, gltexture_t * lightmap_tex)
 	image_memory_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
 	vulkan_globals.vk_cmd_pipeline_barrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, NULL, 0, NULL, 1, &image_memory_barrier);
 
-	lm->rectchange.l = LMBLOCK_WIDTH;
-	lm->rectchange.t = LMBLOCK_HEIGHT;
-	lm->rectchange.h = 0;
-	lm->rectchange.w = 0;
+	rs_lightmapregions += lm->numdirtyrects;
+	lm->numdirtyrects = 0;
 
 	rs_dynamiclightmaps++;
+
+	return size;
 }
 
-void R_UploadLightmaps (void)
+/*
+===============
+R_UploadLightmapBatch
+
+uploads the dirty regions of lightmap blocks first..last-1 from a single
+staging allocation of 'size' bytes
+===============
+*/
+static void R_UploadLightmapBatch (int first, int last, int size)
 {
-	int lmap;
+	VkBuffer staging_buffer;
+	VkCommandBuffer command_buffer;
+	int lmap, staging_offset;
+	byte * staging_memory = R_StagingAllocate(size, 4, &command_buffer, &staging_buffer, &staging_offset);
 
-	for (lmap = 0; lmap < lightmap_count; lmap++)
+	rs_lightmapbytes += size;
+
+	for (lmap = first; lmap < last; lmap++)
 	{
-		if (!lightmaps[lmap].modified)
+		if (!lightmaps[lmap].numdirtyrects)
 			continue;
 
-		R_UploadLightmap(lmap, lightmaps[lmap].texture);
+		const int used = R_UploadLightmap(lmap, lightmaps[lmap].texture, command_buffer, staging_buffer, staging_offset, staging_memory);
+		staging_offset += used;
+		staging_memory += used;
 	}
 }
+
+/*
+===============
+R_UploadLightmaps
+
+uploads the dirty regions of all lightmap blocks, batching as many blocks per
+staging allocation as fit in the staging buffer
+===============
+*/
+void R_UploadLightmaps (void)
+{
+	int lmap, i, lmsize, first = 0, size = 0;
+
+	for (lmap = 0; lmap < lightmap_count; lmap++)
+	{
+		lmsize = 0;
+		for (i = 0; i < lightmaps[lmap].numdirtyrects; i++)
+			lmsize += lightmaps[lmap].dirtyrects[i].w * lightmaps[lmap].dirtyrects[i].h * lightmap_bytes;
+
+		if (size && size + lmsize >= vulkan_globals.staging_buffer_size)
+		{	// a block on its own always goes through, R_StagingAllocate grows the buffer if it has to
+			R_UploadLightmapBatch (first, lmap, size);
+			first = lmap;
+			size = 0;
+		}
+		size += lmsize;
+	}
+
+	if (size)
+		R_UploadLightmapBatch (first, lightmap_count, size);
+}
@@ -101,7 +101,9 @@ particle_t *R_AllocParticle (void)
 	{
 		int i;
 
+		memtag_t tag = Memory_SetTag (MEMTAG_PARTICLES);
 		free_particles = (particle_t *) Hunk_Alloc (MAX_PARTICLES * sizeof (particle_t));
+		Memory_SetTag (tag);
 
 		for (i = 1; i < MAX_PARTICLES; i++)
 			free_particles[i - 1].next = &free_particles[i];
@@ -694,8 +696,8 @@ void R_FlushParticles (int num_particles, particlevertex_t *vertices)
 	memcpy (dst, vertices, num_particles * sizeof (particlevertex_t));
 
 	// draw
-	vulkan_globals.vk_cmd_bind_vertex_buffers (vulkan_globals.command_buffer, 0, 1, &vertex_buffer, &vertex_buffer_offset);
-	vulkan_globals.vk_cmd_draw (vulkan_globals.command_buffer, 4, num_particles, 0, 0);
+	vulkan_globals.vk_cmd_bind_vertex_buffers (vulkan_recording.command_buffer, 0, 1, &vertex_buffer, &vertex_buffer_offset);
+	vulkan_globals.vk_cmd_draw (vulkan_recording.command_buffer, 4, num_particles, 0, 0);
 }
 
 
@@ -726,8 +728,11 @@ static void R_DrawParticlesFaces(void)
 		pt->accel[2] = (pt->dvel[2] + (pt->grav[2] * grav)) * 0.5f;
 	}
 
-	static particlevertex_t vertices[MAX_PARTICLES];
 	int num_particles = 0;
+	for (particle_t *p = active_particles; p; p = p->next)
+		num_particles++;
+	particlevertex_t *vertices = (particlevertex_t *) Frame_Alloc (q_min (num_particles, MAX_PARTICLES) * sizeof (particlevertex_t));
+	num_particles = 0;
 
 	// push-constants must be 4-float aligned; we pack them tighter and unpack in the GLSL
 	float pcdata[12];
@@ -6173,33 +6173,16 @@ static void R_AddTexturedParticle(scenetris_t *t, particle_t *p, plooks_t *type)
 	t->numidx += 6;
 }
 
-static void PScript_DrawParticleTypes (float pframetime)
-{
-	void (*bdraw)(scenetris_t *t, beamseg_t *p, plooks_t *type);
-	void (*tdraw)(scenetris_t *t, particle_t *p, plooks_t *type);
-
-	vec3_t oldorg;
-	vec3_t stop, normal;
-	part_type_t *type, *lastvalidtype;
-	particle_t		*p, *kill;
-	clippeddecal_t *d, *dkill;
-	ramp_t *ramp;
-	float grav;
-	vec3_t friction;
-	scenetris_t *scenetri;
-	float dist;
-	particle_t *kill_list, *kill_first;	//the kill list is to stop particles from being freed and reused whilst still in this loop
-										//which is bad because beams need to find out when particles died. Reuse can do wierd things.
-										//remember that they're not drawn instantly either.
-	beamseg_t *b, *bkill;
-
-	int traces=r_particle_tracelimit.value;
-	int rampind;
-	static float flurrytime;
-	qboolean doflurry;
-	int batchflags;
-	unsigned int i, o;
+/*
+===============
+PScript_UpdateLooks
 
+Reevaluates the shared looks after a particle effect was changed.
+Registers models, so it must run on the main thread before the particles are drawn.
+===============
+*/
+void PScript_UpdateLooks (void)
+{
 	if (r_plooksdirty)
 	{
 		int j, k;
@@ -6226,6 +6209,34 @@ static void PScript_DrawParticleTypes (float pframetime)
 		CL_RegisterParticles();
 		PScript_RecalculateSkyTris();
 	}
+}
+
+static void PScript_DrawParticleTypes (float pframetime)
+{
+	void (*bdraw)(scenetris_t *t, beamseg_t *p, plooks_t *type);
+	void (*tdraw)(scenetris_t *t, particle_t *p, plooks_t *type);
+
+	vec3_t oldorg;
+	vec3_t stop, normal;
+	part_type_t *type, *lastvalidtype;
+	particle_t		*p, *kill;
+	clippeddecal_t *d, *dkill;
+	ramp_t *ramp;
+	float grav;
+	vec3_t friction;
+	scenetris_t *scenetri;
+	float dist;
+	particle_t *kill_list, *kill_first;	//the kill list is to stop particles from being freed and reused whilst still in this loop
+										//which is bad because beams need to find out when particles died. Reuse can do wierd things.
+										//remember that they're not drawn instantly either.
+	beamseg_t *b, *bkill;
+
+	int traces=r_particle_tracelimit.value;
+	int rampind;
+	static float flurrytime;
+	qboolean doflurry;
+	int batchflags;
+	unsigned int i, o;
 
 	VectorScale (vup, 1.5, pup);
 	VectorScale (vright, 1.5, pright);
@@ -6920,10 +6931,10 @@ endtype:
 
 			const int num_indices = tris->numidx;
 			const VkDeviceSize vertex_buffer_offset = 0;
-			vulkan_globals.vk_cmd_bind_index_buffer(vulkan_globals.command_buffer, index_buffers[current_buffer_index], 0, VK_INDEX_TYPE_UINT16);
-			vulkan_globals.vk_cmd_bind_vertex_buffers(vulkan_globals.command_buffer, 0, 1, &vertex_buffers[current_buffer_index], &vertex_buffer_offset);
-			vulkan_globals.vk_cmd_bind_descriptor_sets(vulkan_globals.command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.layout.handle, 0, 1, &tex->descriptor_set, 0, NULL);
-			vulkan_globals.vk_cmd_draw_indexed(vulkan_globals.command_buffer, num_indices, 1, tris->firstidx, tris->firstvert, 0);
+			vulkan_globals.vk_cmd_bind_index_buffer(vulkan_recording.command_buffer, index_buffers[current_buffer_index], 0, VK_INDEX_TYPE_UINT16);
+			vulkan_globals.vk_cmd_bind_vertex_buffers(vulkan_recording.command_buffer, 0, 1, &vertex_buffers[current_buffer_index], &vertex_buffer_offset);
+			vulkan_globals.vk_cmd_bind_descriptor_sets(vulkan_recording.command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.layout.handle, 0, 1, &tex->descriptor_set, 0, NULL);
+			vulkan_globals.vk_cmd_draw_indexed(vulkan_recording.command_buffer, num_indices, 1, tris->firstidx, tris->firstvert, 0);
 		}
 	}
 	R_EndDebugUtilsLabel ();
@@ -6975,6 +6986,7 @@ void PScript_DrawParticles (void)
 		}
 	}
 
+	PScript_UpdateLooks();
 	PScript_DrawParticleTypes(pframetime);
 }
 
@@ -6995,9 +7007,9 @@ void PScript_DrawParticles_ShowTris (void)
 		scenetris_t* tris = &cl_stris[i];
 		const int num_indices = tris->numidx;
 		const VkDeviceSize vertex_buffer_offset = 0;
-		vulkan_globals.vk_cmd_bind_index_buffer(vulkan_globals.command_buffer, index_buffers[current_buffer_index], 0, VK_INDEX_TYPE_UINT16);
-		vulkan_globals.vk_cmd_bind_vertex_buffers(vulkan_globals.command_buffer, 0, 1, &vertex_buffers[current_buffer_index], &vertex_buffer_offset);
-		vulkan_globals.vk_cmd_draw_indexed(vulkan_globals.command_buffer, num_indices, 1, tris->firstidx, tris->firstvert, 0);
+		vulkan_globals.vk_cmd_bind_index_buffer(vulkan_recording.command_buffer, index_buffers[current_buffer_index], 0, VK_INDEX_TYPE_UINT16);
+		vulkan_globals.vk_cmd_bind_vertex_buffers(vulkan_recording.command_buffer, 0, 1, &vertex_buffers[current_buffer_index], &vertex_buffer_offset);
+		vulkan_globals.vk_cmd_draw_indexed(vulkan_recording.command_buffer, num_indices, 1, tris->firstidx, tris->firstvert, 0);
 	}
 }
 
@@ -192,19 +192,19 @@ void R_DrawSpriteModel (entity_t *e)
 
 	R_CreateSpriteVertices(e, frame, vertices);
 
-	vkCmdBindVertexBuffers(vulkan_globals.command_buffer, 0, 1, &buffer, &buffer_offset);
-	vkCmdBindIndexBuffer(vulkan_globals.command_buffer, vulkan_globals.fan_index_buffer, 0, VK_INDEX_TYPE_UINT16);
+	vkCmdBindVertexBuffers(vulkan_recording.command_buffer, 0, 1, &buffer, &buffer_offset);
+	vkCmdBindIndexBuffer(vulkan_recording.command_buffer, vulkan_globals.fan_index_buffer, 0, VK_INDEX_TYPE_UINT16);
 
 	R_BindPipeline(VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.sprite_pipeline);
 
 	psprite = (msprite_t *) currententity->model->cache.data;
 	if (psprite->type == SPR_ORIENTED)
-		vkCmdSetDepthBias(vulkan_globals.command_buffer, OFFSET_DECAL, 0.0f, 1.0f);
+		vkCmdSetDepthBias(vulkan_recording.command_buffer, OFFSET_DECAL, 0.0f, 1.0f);
 	else
-		vkCmdSetDepthBias(vulkan_globals.command_buffer, OFFSET_NONE, 0.0f, 0.0f);
+		vkCmdSetDepthBias(vulkan_recording.command_buffer, OFFSET_NONE, 0.0f, 0.0f);
 
-	vkCmdBindDescriptorSets(vulkan_globals.command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_pipeline_layout.handle, 0, 1, &frame->gltexture->descriptor_set, 0, NULL);
-	vkCmdDrawIndexed(vulkan_globals.command_buffer, 6, 1, 0, 0, 0);
+	vkCmdBindDescriptorSets(vulkan_recording.command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_pipeline_layout.handle, 0, 1, &frame->gltexture->descriptor_set, 0, NULL);
+	vkCmdDrawIndexed(vulkan_recording.command_buffer, 6, 1, 0, 0, 0);
 }
 
 /*
@@ -221,8 +221,8 @@ void R_DrawSpriteModel_ShowTris (entity_t *e)
 
 	R_CreateSpriteVertices(e, frame, vertices);
 
-	vkCmdBindVertexBuffers(vulkan_globals.command_buffer, 0, 1, &buffer, &buffer_offset);
-	vkCmdBindIndexBuffer(vulkan_globals.command_buffer, vulkan_globals.fan_index_buffer, 0, VK_INDEX_TYPE_UINT16);
+	vkCmdBindVertexBuffers(vulkan_recording.command_buffer, 0, 1, &buffer, &buffer_offset);
+	vkCmdBindIndexBuffer(vulkan_recording.command_buffer, vulkan_globals.fan_index_buffer, 0, VK_INDEX_TYPE_UINT16);
 
 	R_BindPipeline(VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.sprite_pipeline);
 
@@ -231,6 +231,6 @@ void R_DrawSpriteModel_ShowTris (entity_t *e)
 	else
 		R_BindPipeline(VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.showtris_depth_test_pipeline);
 
-	vkCmdBindDescriptorSets(vulkan_globals.command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_pipeline_layout.handle, 0, 1, &frame->gltexture->descriptor_set, 0, NULL);
-	vkCmdDrawIndexed(vulkan_globals.command_buffer, 6, 1, 0, 0, 0);
+	vkCmdBindDescriptorSets(vulkan_recording.command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_pipeline_layout.handle, 0, 1, &frame->gltexture->descriptor_set, 0, NULL);
+	vkCmdDrawIndexed(vulkan_recording.command_buffer, 6, 1, 0, 0, 0);
 }
@@ -164,24 +164,144 @@ byte R_CullBoxSIMD (soa_aabb_t box, byte activelanes)
 #endif // defined(USE_SSE2)
 
 #if defined(USE_SIMD)
+/*
+=============================================================================
+
+PARALLEL SURFACE MARKING
+
+The leaf pass and the back-face pass run as jobs over fixed-size ranges.
+Every thread marks into its own surface bitmask, every surface range keeps
+its own texture chain fragments and lightmap dirty list.  Fragments are
+spliced in range order afterwards, so the chains come out exactly as the
+serial loop would have built them.
+
+=============================================================================
+*/
+
+#define MARK_LEAF_RANGE		2048	// leafs per job, multiple of 8
+#define MARK_SURF_RANGE		4096	// surfaces per job, multiple of 8
+
+typedef struct
+{
+	msurface_t	*head;
+	msurface_t	*tail;
+} chainfrag_t;
+
+static struct
+{
+	qmodel_t	*model;
+	int		numthreads;
+	int		surfvisbytes;
+	byte		*threadsurfvis;		// [numthreads][surfvisbytes]
+
+	int		numtextures;
+	texture_t	**textures;		// every distinct texture used by a surface
+	int		*surftexture;		// [numsurfaces] index into textures
+
+	int		numleafranges;
+	int		*efragleafs;		// [numleafs], MARK_LEAF_RANGE per range
+	int		*numefragleafs;		// [numleafranges]
+
+	int		numsurfranges;
+	chainfrag_t	*frags;			// [numsurfranges][numtextures]
+	int		*touched;		// [numsurfranges][numtextures]
+	int		*numtouched;		// [numsurfranges]
+	msurface_t	**lightmapsurfs;	// [numsurfaces], MARK_SURF_RANGE per range
+	int		*numlightmapsurfs;	// [numsurfranges]
+	int		*brushpolys;		// [numsurfranges]
+} mark;
+
 /*
 ===============
-R_MarkVisSurfacesSIMD
+R_InitMarkRanges
+
+(re)builds the per-range scratch data for the current world model
 ===============
 */
-void R_MarkVisSurfacesSIMD (byte *vis)
+void R_InitMarkRanges (void)
 {
-	msurface_t		*surf;
+	qmodel_t	*model = cl.worldmodel;
+	int		i, j, hashsize, *hash;
+	texture_t	*tex;
+
+	free (mark.threadsurfvis);
+	free (mark.textures);
+	free (mark.surftexture);
+	free (mark.efragleafs);
+	free (mark.numefragleafs);
+	free (mark.frags);
+	free (mark.touched);
+	free (mark.numtouched);
+	free (mark.lightmapsurfs);
+	free (mark.numlightmapsurfs);
+	free (mark.brushpolys);
+	memset (&mark, 0, sizeof (mark));
+
+	if (!model)
+		return;
+
+	mark.model = model;
+	mark.numthreads = Jobs_NumThreads ();
+	mark.surfvisbytes = (model->numsurfaces + 7) / 8;
+	mark.threadsurfvis = (byte *) calloc (mark.numthreads, mark.surfvisbytes);
+
+	// map surfaces to dense texture indices
+	for (hashsize = 64; hashsize < model->numtextures * 4; hashsize <<= 1)
+		;
+	hash = (int *) malloc (hashsize * sizeof (int));
+	memset (hash, -1, hashsize * sizeof (int));
+	mark.textures = (texture_t **) malloc (hashsize / 2 * sizeof (texture_t *));
+	mark.surftexture = (int *) malloc (model->numsurfaces * sizeof (int));
+	for (i = 0; i < model->numsurfaces; i++)
+	{
+		tex = model->surfaces[i].texinfo->texture;
+		for (j = ((uintptr_t)tex >> 4) & (hashsize - 1); hash[j] >= 0; j = (j + 1) & (hashsize - 1))
+			if (mark.textures[hash[j]] == tex)
+				break;
+		if (hash[j] < 0)
+		{
+			if (mark.numtextures == hashsize / 2)
+				Sys_Error ("R_InitMarkRanges: too many textures");
+			hash[j] = mark.numtextures;
+			mark.textures[mark.numtextures++] = tex;
+		}
+		mark.surftexture[i] = hash[j];
+	}
+	free (hash);
+
+	mark.numleafranges = (model->numleafs + MARK_LEAF_RANGE - 1) / MARK_LEAF_RANGE;
+	mark.efragleafs = (int *) malloc (q_max (model->numleafs, 1) * sizeof (int));
+	mark.numefragleafs = (int *) calloc (q_max (mark.numleafranges, 1), sizeof (int));
+
+	mark.numsurfranges = (model->numsurfaces + MARK_SURF_RANGE - 1) / MARK_SURF_RANGE;
+	j = q_max (mark.numsurfranges, 1);
+	mark.frags = (chainfrag_t *) calloc (j * q_max (mark.numtextures, 1), sizeof (chainfrag_t));
+	mark.touched = (int *) malloc (j * q_max (mark.numtextures, 1) * sizeof (int));
+	mark.numtouched = (int *) calloc (j, sizeof (int));
+	mark.lightmapsurfs = (msurface_t **) malloc (q_max (model->numsurfaces, 1) * sizeof (msurface_t *));
+	mark.numlightmapsurfs = (int *) calloc (j, sizeof (int));
+	mark.brushpolys = (int *) calloc (j, sizeof (int));
+}
+
+/*
+===============
+R_MarkLeafRange
+
+marks the surfaces of visible leafs into this thread's bitmask
+===============
+*/
+static void R_MarkLeafRange (int range, void *payload)
+{
+	byte			*vis = *(byte **)payload;
 	unsigned int	i, j, k;
-	unsigned int	numleafs = cl.worldmodel->numleafs;
-	unsigned int	numsurfaces = cl.worldmodel->numsurfaces;
-	byte			*surfvis = cl.worldmodel->surfvis;
+	unsigned int	first = range * MARK_LEAF_RANGE;
+	unsigned int	last = q_min (first + MARK_LEAF_RANGE, (unsigned int)cl.worldmodel->numleafs);
+	byte			*surfvis = mark.threadsurfvis + Jobs_ThreadIndex () * mark.surfvisbytes;
+	int				*efragleafs = mark.efragleafs + first;
+	int				numefragleafs = 0;
 	soa_aabb_t		*leafbounds = cl.worldmodel->soa_leafbounds;
 
-	memset(cl.worldmodel->surfvis, 0, (cl.worldmodel->numsurfaces + 7) / 8);
-
-	// iterate through leaves, marking surfaces
-	for (i = 0; i < numleafs; i += 8)
+	for (i = first; i < last; i += 8)
 	{
 		byte mask = vis[i / 8];
 		if (mask == 0)
@@ -191,7 +311,7 @@ void R_MarkVisSurfacesSIMD (byte *vis)
 		if (mask == 0)
 			continue;
 
-		for (j = 0; (j < 8) && ((i + j) < numleafs); ++j)
+		for (j = 0; (j < 8) && ((i + j) < last); ++j)
 		{
 			if (!(mask & (1u << j)))
 				continue;
@@ -208,15 +328,45 @@ void R_MarkVisSurfacesSIMD (byte *vis)
 				}
 			}
 
-			// add static models
+			// static models are added serially afterwards
 			if (leaf->efrags)
-				R_StoreEfrags (&leaf->efrags);
+				efragleafs[numefragleafs++] = 1 + i + j;
 		}
 	}
 
-	for (i = 0; i < numsurfaces; i += 8)
+	mark.numefragleafs[range] = numefragleafs;
+}
+
+/*
+===============
+R_MarkSurfaceRange
+
+merges the per-thread bitmasks, back-face culls and builds chain fragments
+===============
+*/
+static void R_MarkSurfaceRange (int range, void *payload)
+{
+	msurface_t		*surf;
+	unsigned int	i, j, t;
+	unsigned int	first = range * MARK_SURF_RANGE;
+	unsigned int	last = q_min (first + MARK_SURF_RANGE, (unsigned int)cl.worldmodel->numsurfaces);
+	chainfrag_t		*frags = mark.frags + range * mark.numtextures;
+	int				*touched = mark.touched + range * mark.numtextures;
+	int				numtouched = 0;
+	msurface_t		**lightmapsurfs = mark.lightmapsurfs + first;
+	int				numlightmapsurfs = 0;
+	int				brushpolys = 0;
+
+	for (i = first; i < last; i += 8)
 	{
-		byte mask = surfvis[i / 8];
+		byte mask = 0;
+		for (t = 0; t < (unsigned int)mark.numthreads; t++)
+		{
+			byte *threadvis = mark.threadsurfvis + t * mark.surfvisbytes + i / 8;
+			mask |= *threadvis;
+			*threadvis = 0;
+		}
+		cl.worldmodel->surfvis[i / 8] = mask;
 		if (mask == 0)
 			continue;
 
@@ -226,17 +376,77 @@ void R_MarkVisSurfacesSIMD (byte *vis)
 
 		for (j = 0; j < 8; ++j)
 		{
+			chainfrag_t *frag;
+			int texnum;
+
 			if (!(mask & (1u << j)))
 				continue;
 
 			surf = &cl.worldmodel->surfaces[i + j];
-			rs_brushpolys++; //count wpolys here
-			R_ChainSurface(surf, chain_world);
-			R_RenderDynamicLightmaps(surf);
-			if (surf->texinfo->texture->warpimage)
-				surf->texinfo->texture->update_warp = true;
+			brushpolys++; //count wpolys here
+
+			texnum = mark.surftexture[i + j];
+			frag = &frags[texnum];
+			if (!frag->head)
+			{
+				frag->tail = surf;
+				touched[numtouched++] = texnum;
+			}
+			surf->texturechain = frag->head;
+			frag->head = surf;
+
+			if (R_LightmapNeedsUpdate(surf))
+				lightmapsurfs[numlightmapsurfs++] = surf;
 		}
 	}
+
+	mark.numtouched[range] = numtouched;
+	mark.numlightmapsurfs[range] = numlightmapsurfs;
+	mark.brushpolys[range] = brushpolys;
+}
+
+/*
+===============
+R_MarkVisSurfacesSIMD
+===============
+*/
+void R_MarkVisSurfacesSIMD (byte *vis)
+{
+	int			i, j;
+	texture_t	*tex;
+	chainfrag_t	*frag;
+
+	if (mark.model != cl.worldmodel)
+		R_InitMarkRanges ();
+
+	Jobs_ParallelFor (R_MarkLeafRange, mark.numleafranges, &vis, sizeof (vis));
+	Jobs_ParallelFor (R_MarkSurfaceRange, mark.numsurfranges, NULL, 0);
+
+	// add static models in leaf order
+	for (i = 0; i < mark.numleafranges; i++)
+		for (j = 0; j < mark.numefragleafs[i]; j++)
+			R_StoreEfrags (&cl.worldmodel->leafs[mark.efragleafs[i * MARK_LEAF_RANGE + j]].efrags);
+
+	// splice chain fragments in range order and queue dirty lightmaps
+	for (i = 0; i < mark.numsurfranges; i++)
+	{
+		for (j = 0; j < mark.numtouched[i]; j++)
+		{
+			int texnum = mark.touched[i * mark.numtextures + j];
+			frag = &mark.frags[i * mark.numtextures + texnum];
+			tex = mark.textures[texnum];
+			frag->tail->texturechain = tex->texturechains[chain_world];
+			tex->texturechains[chain_world] = frag->head;
+			frag->head = frag->tail = NULL;
+			if (tex->warpimage)
+				tex->update_warp = true;
+		}
+
+		for (j = 0; j < mark.numlightmapsurfs[i]; j++)
+			R_QueueDynamicLightmap (mark.lightmapsurfs[i * MARK_SURF_RANGE + j]);
+
+		rs_brushpolys += mark.brushpolys[i];
+	}
 }
 #endif // defined(USE_SIMD)
 
@@ -326,6 +536,8 @@ void R_MarkSurfaces (void)
 	else
 #endif
 	  R_MarkVisSurfaces(vis);
+
+	R_BuildQueuedLightmaps ();
 }
 
 //==============================================================================
@@ -360,8 +572,9 @@ static void R_TriangleIndicesForSurf (msurface_t *s, uint32_t *dest)
 
 #define MAX_BATCH_SIZE 65536
 
-static uint32_t vbo_indices[MAX_BATCH_SIZE];
-static unsigned int num_vbo_indices;
+// batches are per thread, world stages may be recorded by jobs (r_parallel_recording)
+static THREAD_LOCAL uint32_t vbo_indices[MAX_BATCH_SIZE];
+static THREAD_LOCAL unsigned int num_vbo_indices;
 
 /*
 ================
@@ -401,20 +614,20 @@ static void R_FlushBatch (qboolean fullbright_enabled, qboolean alpha_test, qboo
 				slope_factor = -0.25f;
 			}
 		}
-		vkCmdSetDepthBias(vulkan_globals.command_buffer, constant_factor, 0.0f, slope_factor);
+		vkCmdSetDepthBias(vulkan_recording.command_buffer, constant_factor, 0.0f, slope_factor);
 
 		if (!r_fullbright_cheatsafe)
-			vulkan_globals.vk_cmd_bind_descriptor_sets(vulkan_globals.command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.world_pipeline_layout.handle, 1, 1, &lightmap_texture->descriptor_set, 0, NULL);
+			vulkan_globals.vk_cmd_bind_descriptor_sets(vulkan_recording.command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.world_pipeline_layout.handle, 1, 1, &lightmap_texture->descriptor_set, 0, NULL);
 		else
-			vulkan_globals.vk_cmd_bind_descriptor_sets(vulkan_globals.command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.world_pipeline_layout.handle, 1, 1, &greytexture->descriptor_set, 0, NULL);
+			vulkan_globals.vk_cmd_bind_descriptor_sets(vulkan_recording.command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.world_pipeline_layout.handle, 1, 1, &greytexture->descriptor_set, 0, NULL);
 
 		VkBuffer buffer;
 		VkDeviceSize buffer_offset;
 		byte * indices = R_IndexAllocate(num_vbo_indices * sizeof(uint32_t), &buffer, &buffer_offset);
 		memcpy(indices, vbo_indices, num_vbo_indices * sizeof(uint32_t));
 
-		vulkan_globals.vk_cmd_bind_index_buffer(vulkan_globals.command_buffer, buffer, buffer_offset, VK_INDEX_TYPE_UINT32);
-		vulkan_globals.vk_cmd_draw_indexed(vulkan_globals.command_buffer, num_vbo_indices, 1, 0, 0, 0);
+		vulkan_globals.vk_cmd_bind_index_buffer(vulkan_recording.command_buffer, buffer, buffer_offset, VK_INDEX_TYPE_UINT32);
+		vulkan_globals.vk_cmd_draw_indexed(vulkan_recording.command_buffer, num_vbo_indices, 1, 0, 0, 0);
 
 		num_vbo_indices = 0;
 	}
@@ -518,7 +731,7 @@ void R_DrawTextureChains_Water (qmodel_t *model, entity_t *ent, texchain_t chain
 				else
 					R_BindPipeline(VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.water_pipeline);
 
-				vulkan_globals.vk_cmd_bind_descriptor_sets(vulkan_globals.command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_pipeline_layout.handle, 0, 1, &t->warpimage->descriptor_set, 0, NULL);
+				vulkan_globals.vk_cmd_bind_descriptor_sets(vulkan_recording.command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_pipeline_layout.handle, 0, 1, &t->warpimage->descriptor_set, 0, NULL);
 
 				if (model != cl.worldmodel)
 				{
@@ -555,11 +768,11 @@ void R_DrawTextureChains_Multitexture (qmodel_t *model, entity_t *ent, texchain_
 	gltexture_t	*fullbright = NULL;
 
 	VkDeviceSize offset = 0;
-	vulkan_globals.vk_cmd_bind_vertex_buffers(vulkan_globals.command_buffer, 0, 1, &bmodel_vertex_buffer, &offset);
+	vulkan_globals.vk_cmd_bind_vertex_buffers(vulkan_recording.command_buffer, 0, 1, &bmodel_vertex_buffer, &offset);
 
-	vulkan_globals.vk_cmd_bind_descriptor_sets(vulkan_globals.command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.world_pipeline_layout.handle, 2, 1, &nulltexture->descriptor_set, 0, NULL);
+	vulkan_globals.vk_cmd_bind_descriptor_sets(vulkan_recording.command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.world_pipeline_layout.handle, 2, 1, &nulltexture->descriptor_set, 0, NULL);
 	if (r_lightmap_cheatsafe)
-		vulkan_globals.vk_cmd_bind_descriptor_sets(vulkan_globals.command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.world_pipeline_layout.handle, 0, 1, &greytexture->descriptor_set, 0, NULL);
+		vulkan_globals.vk_cmd_bind_descriptor_sets(vulkan_recording.command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.world_pipeline_layout.handle, 0, 1, &greytexture->descriptor_set, 0, NULL);
 
 	if (alpha_blend) {
 		R_PushConstants(VK_SHADER_STAGE_ALL_GRAPHICS, 20 * sizeof(float), 1 * sizeof(float), &alpha);
@@ -575,7 +788,7 @@ void R_DrawTextureChains_Multitexture (qmodel_t *model, entity_t *ent, texchain_
 		if (gl_fullbrights.value && (fullbright = R_TextureAnimation(t, ent_frame)->fullbright) && !r_lightmap_cheatsafe)
 		{
 			fullbright_enabled = true;
-			vulkan_globals.vk_cmd_bind_descriptor_sets(vulkan_globals.command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.world_pipeline_layout.handle, 2, 1, &fullbright->descriptor_set, 0, NULL);
+			vulkan_globals.vk_cmd_bind_descriptor_sets(vulkan_recording.command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.world_pipeline_layout.handle, 2, 1, &fullbright->descriptor_set, 0, NULL);
 		}
 		else
 			fullbright_enabled = false;
@@ -589,7 +802,7 @@ void R_DrawTextureChains_Multitexture (qmodel_t *model, entity_t *ent, texchain_
 		texture_t * texture = R_TextureAnimation(t, ent_frame);
 		gltexture_t * gl_texture = texture->gltexture;
 		if (!r_lightmap_cheatsafe)
-			vulkan_globals.vk_cmd_bind_descriptor_sets(vulkan_globals.command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.world_pipeline_layout.handle, 0, 1, &gl_texture->descriptor_set, 0, NULL);
+			vulkan_globals.vk_cmd_bind_descriptor_sets(vulkan_recording.command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.world_pipeline_layout.handle, 0, 1, &gl_texture->descriptor_set, 0, NULL);
 
 		for (s = t->texturechains[chain]; s; s = s->texturechain)
 		{
@@ -623,7 +836,10 @@ void R_DrawTextureChains (qmodel_t *model, entity_t *ent, texchain_t chain)
 	else
 		entalpha = 1;
 
-	R_UploadLightmaps ();
+	// lightmap uploads go through the staging buffers which only the main thread may use,
+	// R_RenderScene uploads them after it started the jobs for the world stages
+	if (Jobs_ThreadIndex () == 0)
+		R_UploadLightmaps ();
 	R_DrawTextureChains_Multitexture (model, ent, chain, entalpha);
 }
 
@@ -669,7 +885,7 @@ void R_DrawWorld_ShowTris (void)
 	else
 		R_BindPipeline(VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.showtris_depth_test_pipeline);
 
-	vkCmdBindIndexBuffer(vulkan_globals.command_buffer, vulkan_globals.fan_index_buffer, 0, VK_INDEX_TYPE_UINT16);
+	vkCmdBindIndexBuffer(vulkan_recording.command_buffer, vulkan_globals.fan_index_buffer, 0, VK_INDEX_TYPE_UINT16);
 
 	if (!r_drawworld_cheatsafe)
 		return;
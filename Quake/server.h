@@ -318,6 +318,13 @@ void SV_BroadcastPrintf (const char *fmt, ...) FUNC_PRINTF(1,2);
 
 void SV_Physics (void);
 
+extern qboolean sv_predictingmoves;
+void SV_MoveChanged (edict_t *ent);
+// while sv_predictingmoves, call before anything that can change how ent
+// clips traces: origin, size, solid, owner, angles, flags or skin
+void SV_EndPredictions (void);
+void SV_PhysicsTest_f (void);
+
 qboolean SV_CheckBottom (edict_t *ent);
 qboolean SV_movestep (edict_t *ent, vec3_t move, qboolean relink);
 
@@ -162,6 +162,7 @@ S_Init
 void S_Init (void)
 {
 	int i;
+	memtag_t tag;
 
 	if (snd_initialized)
 	{
@@ -217,7 +218,9 @@ void S_Init (void)
 
 	SND_InitScaletable ();
 
+	tag = Memory_SetTag (MEMTAG_SOUND);
 	known_sfx = (sfx_t *) Hunk_AllocName (MAX_SFX*sizeof(sfx_t), "sfx_t");
+	Memory_SetTag (tag);
 	num_sfx = 0;
 
 	snd_initialized = true;
@@ -98,6 +98,7 @@ sfxcache_t *S_LoadSound (sfx_t *s)
 	int		len;
 	float	stepscale;
 	sfxcache_t	*sc;
+	memtag_t	tag;
 	byte	stackbuf[1*1024];		// avoid dirtying the cache heap
 
 // see if still in memory
@@ -145,7 +146,9 @@ sfxcache_t *S_LoadSound (sfx_t *s)
 		return NULL;
 	}
 
+	tag = Memory_SetTag (MEMTAG_SOUND);
 	sc = (sfxcache_t *) Cache_Alloc ( &s->cache, len + sizeof(sfxcache_t), s->name);
+	Memory_SetTag (tag);
 	if (!sc)
 		return NULL;
 
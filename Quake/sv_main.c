@@ -1043,6 +1043,7 @@ void SV_Init (void)
 	extern	cvar_t	sv_idealpitchscale;
 	extern	cvar_t	sv_aim;
 	extern	cvar_t	sv_altnoclip; //johnfitz
+	extern	cvar_t	sv_parallelphysics;
 
 	Cvar_RegisterVariable (&sv_maxvelocity);
 	Cvar_RegisterVariable (&sv_gravity);
@@ -1060,8 +1061,10 @@ void SV_Init (void)
 	Cvar_RegisterVariable (&sv_freezenonclients);
 	Cvar_RegisterVariable (&pr_checkextension);
 	Cvar_RegisterVariable (&sv_altnoclip); //johnfitz
+	Cvar_RegisterVariable (&sv_parallelphysics);
 
 	Cmd_AddCommand("pext", SV_Pext_f);
+	Cmd_AddCommand ("sv_physicstest", SV_PhysicsTest_f);
 	Cmd_AddCommand ("sv_protocol", &SV_Protocol_f); //johnfitz
 
 	for (i=0 ; i<MAX_MODELS ; i++)
@@ -2750,6 +2753,7 @@ void SV_SpawnServer (const char *server)
 	svs.changelevel_issued = false;		// now safe to issue another
 
 	PR_SwitchQCVM(NULL);
+	SV_EndPredictions ();	// in case an error left physics half way
 
 //
 // tell all connected clients that we are going to a new level
@@ -2833,6 +2837,11 @@ void SV_SpawnServer (const char *server)
 	q_strlcpy (sv.name, server, sizeof(sv.name));
 	q_snprintf (sv.modelname, sizeof(sv.modelname), "maps/%s.bsp", server);
 	qcvm->worldmodel = Mod_ForName (sv.modelname, false);
+	if (!qcvm->worldmodel)
+	{	// may have been added since the game directories were listed
+		COM_FlushDirectoryCache ();
+		qcvm->worldmodel = Mod_ForName (sv.modelname, false);
+	}
 	if (!qcvm->worldmodel || qcvm->worldmodel->type != mod_brush)
 	{
 		Con_Printf ("Couldn't spawn server %s\n", sv.modelname);
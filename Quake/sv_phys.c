@@ -101,6 +101,8 @@ void SV_CheckVelocity (edict_t *ent)
 		if (IS_NAN(ent->v.origin[i]))
 		{
 			Con_Printf ("Got a NaN origin on %s\n", PR_GetString(ent->v.classname));
+			if (sv_predictingmoves)
+				SV_MoveChanged (ent);
 			ent->v.origin[i] = 0;
 		}
 		if (ent->v.velocity[i] > sv_maxvelocity.value)
@@ -192,6 +194,442 @@ void SV_Impact (edict_t *e1, edict_t *e2)
 }
 
 
+/*
+===============================================================================
+
+PARALLEL MOVE PREDICTION
+
+With sv_parallelphysics, the first trace of every falling toss, fly and step
+entity that does not think this frame is run on the job threads before the
+serial loop.  The loop itself is unchanged: SV_PhysicsMove hands out a
+predicted trace only when it is asked with bit identical inputs and nothing
+else was linked, unlinked or written by QC inside the swept box since, so
+the result is the one SV_Move would have returned.  sv_parallelphysics 2
+traces again anyway and reports any prediction that differs.
+
+===============================================================================
+*/
+
+cvar_t	sv_parallelphysics = {"sv_parallelphysics","0",CVAR_NONE};
+
+#define	PREDICT_GRID	64		// change grid cells along x and y
+#define	PREDICT_BATCH	16		// traces per job index
+
+typedef struct
+{
+	edict_t		*ent;
+	vec3_t		start, end, mins, maxs;
+	int			type;
+	int			owner;			// the passedict fields SV_Move looks at
+	float		size0;
+	vec3_t		boxmins, boxmaxs;	// where SV_Move looks for entities
+	qboolean	valid;
+	trace_t		trace;
+} movepredict_t;
+
+qboolean		sv_predictingmoves;
+
+static movepredict_t	*predictions;
+static int		numpredictions, maxpredictions;
+static int		*predictionforedict;	// prediction + 1 by edict number
+static int		*changededicts;			// changed since their box was last marked
+static byte		*changedflags;
+static int		numchanged;
+static int		edictslots;
+static int		predictionsused;		// for sv_physicstest
+
+// 0 while nothing changed in a cell, edict number + 1 if only that edict
+// did, -1 once several did
+static int		predictgrid[PREDICT_GRID][PREDICT_GRID];
+static vec3_t	gridmins;
+static float	gridscale[2];
+
+/*
+================
+SV_PredictCell
+================
+*/
+static int SV_PredictCell (float v, int axis)
+{
+	float	f;
+
+	f = (v - gridmins[axis]) * gridscale[axis];
+	if (!(f >= 0))	// NaN as well
+		return 0;
+	if (f >= PREDICT_GRID - 1)
+		return PREDICT_GRID - 1;
+	return (int)f;
+}
+
+/*
+================
+SV_PredictMark
+
+Marks the area of ent's current abs box as changed by it
+================
+*/
+static void SV_PredictMark (edict_t *ent, int num)
+{
+	int		x, y, x0, y0, x1, y1;
+	int		*cell;
+
+	x0 = SV_PredictCell (ent->v.absmin[0], 0);
+	y0 = SV_PredictCell (ent->v.absmin[1], 1);
+	x1 = SV_PredictCell (ent->v.absmax[0], 0);
+	y1 = SV_PredictCell (ent->v.absmax[1], 1);
+
+	for (y = y0; y <= y1; y++)
+	{
+		for (x = x0; x <= x1; x++)
+		{
+			cell = &predictgrid[y][x];
+			if (!*cell)
+				*cell = num + 1;
+			else if (*cell != num + 1)
+				*cell = -1;
+		}
+	}
+}
+
+/*
+================
+SV_MoveChanged
+
+The box is marked now and once more before the next prediction is checked,
+as QC writes land after this is called and may move the box itself.
+================
+*/
+void SV_MoveChanged (edict_t *ent)
+{
+	int		num;
+
+	if (qcvm != &sv.qcvm)
+		return;
+	num = ((byte *)ent - (byte *)qcvm->edicts) / qcvm->edict_size;
+	if (num < 0 || num >= edictslots)
+		return;
+
+	SV_PredictMark (ent, num);
+	if (!changedflags[num])
+	{
+		changedflags[num] = 1;
+		changededicts[numchanged++] = num;
+	}
+}
+
+/*
+================
+SV_PredictFlush
+================
+*/
+static void SV_PredictFlush (void)
+{
+	int		i, num;
+
+	for (i = 0; i < numchanged; i++)
+	{
+		num = changededicts[i];
+		changedflags[num] = 0;
+		SV_PredictMark (EDICT_NUM(num), num);
+	}
+	numchanged = 0;
+}
+
+/*
+================
+SV_PredictDirty
+
+True if anything but num changed in the box since the predictions were made
+================
+*/
+static qboolean SV_PredictDirty (vec3_t mins, vec3_t maxs, int num)
+{
+	int		x, y, x0, y0, x1, y1;
+	int		cell;
+
+	SV_PredictFlush ();
+
+	x0 = SV_PredictCell (mins[0], 0);
+	y0 = SV_PredictCell (mins[1], 1);
+	x1 = SV_PredictCell (maxs[0], 0);
+	y1 = SV_PredictCell (maxs[1], 1);
+
+	for (y = y0; y <= y1; y++)
+	{
+		for (x = x0; x <= x1; x++)
+		{
+			cell = predictgrid[y][x];
+			if (cell && cell != num + 1)
+				return true;
+		}
+	}
+	return false;
+}
+
+/*
+================
+SV_PredictVelocity
+
+SV_CheckVelocity without the fixups, which have to print
+================
+*/
+static qboolean SV_PredictVelocity (edict_t *ent, vec3_t vel)
+{
+	int		i;
+
+	for (i = 0; i < 3; i++)
+	{
+		if (IS_NAN(vel[i]) || IS_NAN(ent->v.origin[i]))
+			return false;
+		if (vel[i] > sv_maxvelocity.value)
+			vel[i] = sv_maxvelocity.value;
+		else if (vel[i] < -sv_maxvelocity.value)
+			vel[i] = -sv_maxvelocity.value;
+	}
+	return true;
+}
+
+/*
+================
+SV_PredictMove
+
+Works out the first trace the physics code will ask for ent, doing the same
+float math as SV_Physics_Toss / SV_Physics_Step.  Returns false when there
+is nothing worth predicting.
+================
+*/
+static qboolean SV_PredictMove (edict_t *ent, int gravityofs, movepredict_t *p)
+{
+	float	thinktime, ent_gravity, time_left;
+	vec3_t	vel, move, mins2, maxs2;
+	eval_t	*val;
+	int		i, movetype;
+
+	val = GetEdictFieldValue (ent, gravityofs);
+	if (val && val->_float)
+		ent_gravity = val->_float;
+	else
+		ent_gravity = 1.0;
+
+	movetype = ent->v.movetype;
+	VectorCopy (ent->v.velocity, vel);
+	if (movetype == MOVETYPE_TOSS || movetype == MOVETYPE_GIB || movetype == MOVETYPE_BOUNCE
+	|| movetype == MOVETYPE_FLY || movetype == MOVETYPE_FLYMISSILE)
+	{
+		thinktime = ent->v.nextthink;
+		if (!(thinktime <= 0 || thinktime > qcvm->time + host_frametime))
+			return false;	// QC runs first and may change anything
+		if ((int)ent->v.flags & FL_ONGROUND)
+			return false;
+		if (!SV_PredictVelocity (ent, vel))
+			return false;
+		if (movetype != MOVETYPE_FLY && movetype != MOVETYPE_FLYMISSILE)
+			vel[2] -= ent_gravity * sv_gravity.value * host_frametime;
+		VectorScale (vel, host_frametime, move);
+		VectorAdd (ent->v.origin, move, p->end);
+
+		if (movetype == MOVETYPE_FLYMISSILE)
+			p->type = MOVE_MISSILE;
+		else if (ent->v.solid == SOLID_TRIGGER || ent->v.solid == SOLID_NOT)
+			p->type = MOVE_NOMONSTERS;
+		else
+			p->type = MOVE_NORMAL;
+	}
+	else if (movetype == MOVETYPE_STEP)
+	{
+		if ((int)ent->v.flags & (FL_ONGROUND | FL_FLY | FL_SWIM))
+			return false;	// falls before it thinks, so thinking is fine
+		vel[2] -= ent_gravity * sv_gravity.value * host_frametime;
+		if (!SV_PredictVelocity (ent, vel))
+			return false;
+		if (!vel[0] && !vel[1] && !vel[2])
+			return false;
+		time_left = host_frametime;
+		for (i = 0; i < 3; i++)
+			p->end[i] = ent->v.origin[i] + time_left * vel[i];
+		p->type = MOVE_NORMAL;
+	}
+	else
+		return false;
+
+	p->ent = ent;
+	VectorCopy (ent->v.origin, p->start);
+	VectorCopy (ent->v.mins, p->mins);
+	VectorCopy (ent->v.maxs, p->maxs);
+	p->owner = ent->v.owner;
+	p->size0 = ent->v.size[0];
+
+	if (p->type == MOVE_MISSILE)
+	{
+		for (i = 0; i < 3; i++)
+		{
+			mins2[i] = -15;
+			maxs2[i] = 15;
+		}
+	}
+	else
+	{
+		VectorCopy (p->mins, mins2);
+		VectorCopy (p->maxs, maxs2);
+	}
+	SV_MoveBounds (p->start, mins2, maxs2, p->end, p->boxmins, p->boxmaxs);
+
+	return true;
+}
+
+/*
+================
+SV_PredictMovesJob
+================
+*/
+static void SV_PredictMovesJob (int index, void *unused)
+{
+	movepredict_t	*p;
+	int				i, end;
+
+	sv_tracequiet = true;
+	end = q_min ((index + 1) * PREDICT_BATCH, numpredictions);
+	for (i = index * PREDICT_BATCH; i < end; i++)
+	{
+		p = &predictions[i];
+		sv_traceprinted = false;
+		p->trace = SV_Move (p->start, p->mins, p->maxs, p->end, p->type, p->ent);
+		p->valid = !sv_traceprinted;	// let the main thread trace and print
+	}
+	sv_tracequiet = false;
+}
+
+/*
+================
+SV_EndPredictions
+
+Also called before the edicts change under it: a Host_Error out of the
+physics loop skips the call at its end.
+================
+*/
+void SV_EndPredictions (void)
+{
+	int		i;
+
+	for (i = 0; i < numchanged; i++)
+		changedflags[changededicts[i]] = 0;
+	numchanged = 0;
+	sv_predictingmoves = false;
+}
+
+/*
+================
+SV_PredictMoves
+================
+*/
+static void SV_PredictMoves (int entity_cap)
+{
+	edict_t	*ent;
+	int		i, gravityofs;
+
+	SV_EndPredictions ();
+	if (!sv_parallelphysics.value || qcvm != &sv.qcvm || Jobs_NumThreads () < 2)
+		return;
+	if (pr_global_struct->force_retouch)
+		return;		// everything relinks anyway
+
+	if (edictslots != qcvm->max_edicts)
+	{
+		free (predictionforedict);
+		free (changededicts);
+		free (changedflags);
+		edictslots = qcvm->max_edicts;
+		predictionforedict = (int *) calloc (edictslots, sizeof(int));
+		changededicts = (int *) calloc (edictslots, sizeof(int));
+		changedflags = (byte *) calloc (edictslots, 1);
+		if (!predictionforedict || !changededicts || !changedflags)
+			Sys_Error ("SV_PredictMoves: out of memory");
+	}
+	memset (predictionforedict, 0, edictslots * sizeof(int));
+
+	gravityofs = ED_FindFieldOffset ("gravity");
+	numpredictions = 0;
+	for (i = svs.maxclients + 1; i < entity_cap; i++)
+	{
+		ent = EDICT_NUM(i);
+		if (ent->free)
+			continue;
+		if (numpredictions == maxpredictions)
+		{
+			maxpredictions = q_max (maxpredictions * 2, 256);
+			predictions = (movepredict_t *) realloc (predictions, maxpredictions * sizeof(movepredict_t));
+			if (!predictions)
+				Sys_Error ("SV_PredictMoves: out of memory");
+		}
+		if (SV_PredictMove (ent, gravityofs, &predictions[numpredictions]))
+			predictionforedict[i] = ++numpredictions;
+	}
+	if (!numpredictions)
+		return;
+
+	Jobs_ParallelFor (SV_PredictMovesJob, (numpredictions + PREDICT_BATCH - 1) / PREDICT_BATCH, NULL, 0);
+
+	memset (predictgrid, 0, sizeof(predictgrid));
+	VectorCopy (qcvm->worldmodel->mins, gridmins);
+	for (i = 0; i < 2; i++)
+		gridscale[i] = PREDICT_GRID / q_max (qcvm->worldmodel->maxs[i] - qcvm->worldmodel->mins[i], 1.f);
+	sv_predictingmoves = true;
+}
+
+/*
+================
+SV_SameTrace
+================
+*/
+static qboolean SV_SameTrace (const trace_t *a, const trace_t *b)
+{
+	return a->allsolid == b->allsolid && a->startsolid == b->startsolid
+		&& a->inopen == b->inopen && a->inwater == b->inwater
+		&& !memcmp (&a->fraction, &b->fraction, sizeof(a->fraction))
+		&& !memcmp (a->endpos, b->endpos, sizeof(a->endpos))
+		&& !memcmp (&a->plane, &b->plane, sizeof(a->plane))
+		&& a->ent == b->ent && a->contents == b->contents;
+}
+
+/*
+================
+SV_PhysicsMove
+
+SV_Move for the physics code, using the predicted trace when it still holds
+================
+*/
+static trace_t SV_PhysicsMove (vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, int type, edict_t *ent)
+{
+	movepredict_t	*p;
+	trace_t			trace;
+	int				num;
+
+	if (!sv_predictingmoves)
+		return SV_Move (start, mins, maxs, end, type, ent);
+
+	num = NUM_FOR_EDICT(ent);
+	if (num >= edictslots || !predictionforedict[num])
+		return SV_Move (start, mins, maxs, end, type, ent);
+	p = &predictions[predictionforedict[num] - 1];
+	predictionforedict[num] = 0;	// the entity moves right after
+
+	if (!p->valid || p->type != type
+	|| memcmp (p->start, start, sizeof(vec3_t)) || memcmp (p->end, end, sizeof(vec3_t))
+	|| memcmp (p->mins, mins, sizeof(vec3_t)) || memcmp (p->maxs, maxs, sizeof(vec3_t))
+	|| p->owner != ent->v.owner || memcmp (&p->size0, &ent->v.size[0], sizeof(float))
+	|| SV_PredictDirty (p->boxmins, p->boxmaxs, num))
+		return SV_Move (start, mins, maxs, end, type, ent);
+
+	predictionsused++;
+	if (sv_parallelphysics.value < 2)
+		return p->trace;
+
+	trace = SV_Move (start, mins, maxs, end, type, ent);
+	if (!SV_SameTrace (&trace, &p->trace))
+		Con_Printf ("sv_parallelphysics: prediction for entity %i (%s) differs\n", num, PR_GetString (ent->v.classname));
+	return trace;
+}
+
 /*
 ==================
 ClipVelocity
@@ -272,7 +710,7 @@ int SV_FlyMove (edict_t *ent, float time, trace_t *steptrace)
 		for (i=0 ; i<3 ; i++)
 			end[i] = ent->v.origin[i] + time_left * ent->v.velocity[i];
 
-		trace = SV_Move (ent->v.origin, ent->v.mins, ent->v.maxs, end, false, ent);
+		trace = SV_PhysicsMove (ent->v.origin, ent->v.mins, ent->v.maxs, end, false, ent);
 
 		if (trace.allsolid)
 		{	// entity is trapped in another solid
@@ -421,12 +859,12 @@ trace_t SV_PushEntity (edict_t *ent, vec3_t push)
 	VectorAdd (ent->v.origin, push, end);
 
 	if (ent->v.movetype == MOVETYPE_FLYMISSILE)
-		trace = SV_Move (ent->v.origin, ent->v.mins, ent->v.maxs, end, MOVE_MISSILE, ent);
+		trace = SV_PhysicsMove (ent->v.origin, ent->v.mins, ent->v.maxs, end, MOVE_MISSILE, ent);
 	else if (ent->v.solid == SOLID_TRIGGER || ent->v.solid == SOLID_NOT)
 	// only clip against bmodels
-		trace = SV_Move (ent->v.origin, ent->v.mins, ent->v.maxs, end, MOVE_NOMONSTERS, ent);
+		trace = SV_PhysicsMove (ent->v.origin, ent->v.mins, ent->v.maxs, end, MOVE_NOMONSTERS, ent);
 	else
-		trace = SV_Move (ent->v.origin, ent->v.mins, ent->v.maxs, end, MOVE_NORMAL, ent);
+		trace = SV_PhysicsMove (ent->v.origin, ent->v.mins, ent->v.maxs, end, MOVE_NORMAL, ent);
 
 	VectorCopy (trace.endpos, ent->v.origin);
 	SV_LinkEdict (ent, true);
@@ -558,6 +996,8 @@ void SV_PushMove (edict_t *pusher, float movetime)
 				continue;
 			if (check->v.solid == SOLID_NOT || check->v.solid == SOLID_TRIGGER)
 			{	// corpse
+				if (sv_predictingmoves)
+					SV_MoveChanged (check);
 				check->v.mins[0] = check->v.mins[1] = 0;
 				VectorCopy (check->v.mins, check->v.maxs);
 				continue;
@@ -1247,6 +1687,8 @@ void SV_Physics (void)
 	else
 		entity_cap = qcvm->num_edicts; 
 
+	SV_PredictMoves (entity_cap);
+
 	//for (i=0 ; i<sv.num_edicts ; i++, ent = NEXT_EDICT(ent))
 	for (i=0 ; i<entity_cap ; i++, ent = NEXT_EDICT(ent))
 	{
@@ -1278,9 +1720,226 @@ void SV_Physics (void)
 			Host_EndGame ("SV_Physics: bad movetype %i", (int)ent->v.movetype);
 	}
 
+	SV_EndPredictions ();
+
 	if (pr_global_struct->force_retouch)
 		pr_global_struct->force_retouch--;
 
 	if (!(sv_freezenonclients.value && qcvm == &sv.qcvm))
 	  qcvm->time += host_frametime;
 }
+
+/*
+===============================================================================
+
+PHYSICS DETERMINISM TEST
+
+sv_physicstest [frames] runs the loaded map forward twice from the same
+snapshot, once serially and once with sv_parallelphysics, and compares the
+edicts and globals after every frame.  rand is reseeded the same for both
+runs, and messages QC writes meanwhile are dropped.  The map is put back the
+way it was afterwards, only strings QC zoned during the runs are leaked.
+
+===============================================================================
+*/
+
+typedef struct
+{
+	byte		*edicts;
+	float		*globals;
+	double		time;
+	int			num_edicts;
+	int			numknownstrings, freeknownstrings;
+	int			num_statics;
+	int			lastcheck;
+	double		lastchecktime;
+	const char	*tempstring;		// the last temp string handed out
+	sizebuf_t	*messages;
+} physicssnapshot_t;
+
+/*
+================
+SV_PhysicsTestMessage
+
+the message buffers QC can write to, 4 + 2 * svs.maxclients of them
+================
+*/
+static sizebuf_t *SV_PhysicsTestMessage (int i)
+{
+	switch (i)
+	{
+	case 0:	return &sv.datagram;
+	case 1:	return &sv.reliable_datagram;
+	case 2:	return &sv.signon;
+	case 3:	return &sv.multicast;
+	}
+	i -= 4;
+	return (i & 1) ? &svs.clients[i >> 1].datagram : &svs.clients[i >> 1].message;
+}
+
+/*
+================
+SV_PhysicsTestSave
+================
+*/
+static void SV_PhysicsTestSave (physicssnapshot_t *s)
+{
+	int		i;
+
+	s->edicts = (byte *) malloc (qcvm->max_edicts * qcvm->edict_size);
+	s->globals = (float *) malloc (qcvm->progs->numglobals * sizeof(float));
+	s->messages = (sizebuf_t *) malloc ((4 + 2 * svs.maxclients) * sizeof(sizebuf_t));
+	if (!s->edicts || !s->globals || !s->messages)
+		Sys_Error ("SV_PhysicsTestSave: out of memory");
+
+	memcpy (s->edicts, qcvm->edicts, qcvm->max_edicts * qcvm->edict_size);
+	memcpy (s->globals, qcvm->globals, qcvm->progs->numglobals * sizeof(float));
+	for (i = 0; i < 4 + 2 * svs.maxclients; i++)
+		s->messages[i] = *SV_PhysicsTestMessage (i);
+	s->time = qcvm->time;
+	s->num_edicts = qcvm->num_edicts;
+	s->numknownstrings = qcvm->numknownstrings;
+	s->freeknownstrings = qcvm->freeknownstrings;
+	s->num_statics = sv.num_statics;
+	s->lastcheck = sv.lastcheck;
+	s->lastchecktime = sv.lastchecktime;
+	s->tempstring = PR_GetTempString ();
+}
+
+/*
+================
+SV_PhysicsTestRestore
+================
+*/
+static void SV_PhysicsTestRestore (physicssnapshot_t *s)
+{
+	edict_t	*ent;
+	int		i;
+
+	memcpy (qcvm->edicts, s->edicts, qcvm->max_edicts * qcvm->edict_size);
+	memcpy (qcvm->globals, s->globals, qcvm->progs->numglobals * sizeof(float));
+	for (i = 0; i < 4 + 2 * svs.maxclients; i++)
+		*SV_PhysicsTestMessage (i) = s->messages[i];
+	qcvm->time = s->time;
+	qcvm->num_edicts = s->num_edicts;
+	qcvm->numknownstrings = s->numknownstrings;
+	qcvm->freeknownstrings = s->freeknownstrings;
+	sv.num_statics = s->num_statics;
+	sv.lastcheck = s->lastcheck;
+	sv.lastchecktime = s->lastchecktime;
+	while (PR_GetTempString () != s->tempstring)
+		;	// same temp string order, so the same string numbers
+
+	// the saved links point into the old area nodes, relink like a loadgame
+	SV_ClearWorld ();
+	for (i = 0, ent = qcvm->edicts; i < qcvm->max_edicts; i++, ent = NEXT_EDICT(ent))
+		ent->area.prev = ent->area.next = NULL;
+	for (i = 1, ent = NEXT_EDICT(qcvm->edicts); i < qcvm->num_edicts; i++, ent = NEXT_EDICT(ent))
+		if (!ent->free)
+			SV_LinkEdict (ent, false);
+}
+
+/*
+================
+SV_PhysicsTestSums
+
+one checksum for the count, the globals and every edict, leaving out the
+area links
+================
+*/
+static void SV_PhysicsTestSums (unsigned *sums)
+{
+	edict_t	*ent;
+	int		i, skip = offsetof(edict_t, num_leafs);
+
+	sums[0] = qcvm->num_edicts;
+	sums[1] = Com_BlockChecksum (qcvm->globals, qcvm->progs->numglobals * sizeof(float));
+	for (i = 0, ent = qcvm->edicts; i < qcvm->num_edicts; i++, ent = NEXT_EDICT(ent))
+		sums[2 + i] = Com_BlockChecksum ((byte *) ent + skip, qcvm->edict_size - skip) ^ ent->free;
+}
+
+/*
+================
+SV_PhysicsTest_f
+================
+*/
+void SV_PhysicsTest_f (void)
+{
+	physicssnapshot_t	snap;
+	qcvm_t		*oldvm;
+	unsigned	*serial, *sums, *ref;
+	int			frames, pass, frame, i, stride, bad = 0;
+	float		parallel = sv_parallelphysics.value;
+	double		frametime = host_frametime;
+
+	if (!sv.active)
+	{
+		Con_Printf ("sv_physicstest: no map loaded\n");
+		return;
+	}
+	frames = (Cmd_Argc () > 1) ? q_max (Q_atoi (Cmd_Argv (1)), 1) : 100;
+	if (Jobs_NumThreads () < 2)
+		Con_Printf ("sv_physicstest: no job threads, nothing is predicted\n");
+
+	oldvm = qcvm;
+	PR_SwitchQCVM (NULL);
+	PR_SwitchQCVM (&sv.qcvm);
+
+	stride = 2 + qcvm->max_edicts;
+	serial = (unsigned *) malloc (frames * stride * sizeof(unsigned));
+	sums = (unsigned *) malloc (stride * sizeof(unsigned));
+	if (!serial || !sums)
+		Sys_Error ("SV_PhysicsTest_f: out of memory");
+	SV_PhysicsTestSave (&snap);
+	host_frametime = 1.0 / 72;
+
+	for (pass = 0; pass < 2; pass++)
+	{
+		SV_PhysicsTestRestore (&snap);
+		sv_parallelphysics.value = pass;
+		srand (0);
+		predictionsused = 0;
+		for (frame = 0; frame < frames; frame++)
+		{
+			SV_Physics ();
+			for (i = 0; i < 4 + 2 * svs.maxclients; i++)
+				*SV_PhysicsTestMessage (i) = snap.messages[i];
+
+			if (!pass)
+			{
+				SV_PhysicsTestSums (&serial[frame * stride]);
+				continue;
+			}
+			SV_PhysicsTestSums (sums);
+			ref = &serial[frame * stride];
+			if (sums[0] == ref[0] && !memcmp (&sums[1], &ref[1], (1 + sums[0]) * sizeof(unsigned)))
+				continue;
+			if (bad++)
+				continue;
+			if (sums[0] != ref[0])
+				Con_Printf ("frame %i: %u edicts instead of %u\n", frame, sums[0], ref[0]);
+			else if (sums[1] != ref[1])
+				Con_Printf ("frame %i: globals differ\n", frame);
+			else
+			{
+				for (i = 0; sums[2 + i] == ref[2 + i]; i++)
+					;
+				Con_Printf ("frame %i: edict %i (%s) differs\n", frame, i, PR_GetString (EDICT_NUM(i)->v.classname));
+			}
+		}
+	}
+
+	Con_Printf ("sv_physicstest: %i of %i frames differ, %i traces predicted\n", bad, frames, predictionsused);
+
+	SV_PhysicsTestRestore (&snap);
+	sv_parallelphysics.value = parallel;
+	host_frametime = frametime;
+	free (snap.edicts);
+	free (snap.globals);
+	free (snap.messages);
+	free (serial);
+	free (sums);
+
+	PR_SwitchQCVM (NULL);
+	PR_SwitchQCVM (oldvm);
+}
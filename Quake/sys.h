@@ -42,6 +42,10 @@ int Sys_FileWrite (int handle,const void *data, int count);
 int Sys_FileTime (const char *path);
 void Sys_mkdir (const char *path);
 
+// maps a whole file read only, returns NULL if it is not present or empty
+void *Sys_MapFile (const char *path, size_t *size);
+void Sys_UnmapFile (void *data, size_t size);
+
 //
 // system IO
 //
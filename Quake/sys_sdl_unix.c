@@ -31,6 +31,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include <libgen.h>	/* dirname() and basename() */
 #endif
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <sys/time.h>
 #include <fcntl.h>
 #include <time.h>
@@ -136,6 +137,36 @@ int Sys_FileWrite (int handle, const void *data, int count)
 	return fwrite (data, 1, count, sys_handles[handle]);
 }
 
+void *Sys_MapFile (const char *path, size_t *size)
+{
+	struct stat	st;
+	void		*data;
+	int			fd;
+
+	fd = open (path, O_RDONLY);
+	if (fd == -1)
+		return NULL;
+
+	if (fstat (fd, &st) == -1 || st.st_size <= 0)
+	{
+		close (fd);
+		return NULL;
+	}
+
+	data = mmap (NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close (fd);
+	if (data == MAP_FAILED)
+		return NULL;
+
+	*size = st.st_size;
+	return data;
+}
+
+void Sys_UnmapFile (void *data, size_t size)
+{
+	munmap (data, size);
+}
+
 int Sys_FileTime (const char *path)
 {
 	FILE	*f;
@@ -134,6 +134,41 @@ int Sys_FileWrite (int handle, const void *data, int count)
 	return fwrite (data, 1, count, sys_handles[handle]);
 }
 
+void *Sys_MapFile (const char *path, size_t *size)
+{
+	HANDLE			file, mapping;
+	LARGE_INTEGER	file_size;
+	void			*data;
+
+	file = CreateFile (path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return NULL;
+
+	if (!GetFileSizeEx (file, &file_size) || file_size.QuadPart <= 0 || (ULONGLONG)file_size.QuadPart > (SIZE_T)-1)
+	{
+		CloseHandle (file);
+		return NULL;
+	}
+
+	mapping = CreateFileMapping (file, NULL, PAGE_READONLY, 0, 0, NULL);
+	CloseHandle (file);
+	if (!mapping)
+		return NULL;
+
+	data = MapViewOfFile (mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle (mapping);
+	if (!data)
+		return NULL;
+
+	*size = (size_t)file_size.QuadPart;
+	return data;
+}
+
+void Sys_UnmapFile (void *data, size_t size)
+{
+	UnmapViewOfFile (data);
+}
+
 int Sys_FileTime (const char *path)
 {
 	FILE	*f;
@@ -565,10 +565,10 @@ void V_PolyBlend (void)
 		vertices[i].color[3] = v_blend[3] * 255.0f;
 	}
 
-	vkCmdBindVertexBuffers(vulkan_globals.command_buffer, 0, 1, &vertex_buffer, &vertex_buffer_offset);
-	vkCmdBindIndexBuffer(vulkan_globals.command_buffer, vulkan_globals.fan_index_buffer, 0, VK_INDEX_TYPE_UINT16);
+	vkCmdBindVertexBuffers(vulkan_recording.command_buffer, 0, 1, &vertex_buffer, &vertex_buffer_offset);
+	vkCmdBindIndexBuffer(vulkan_recording.command_buffer, vulkan_globals.fan_index_buffer, 0, VK_INDEX_TYPE_UINT16);
 	R_BindPipeline(VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_poly_blend_pipeline);
-	vkCmdDrawIndexed(vulkan_globals.command_buffer, 6, 1, 0, 0, 0);
+	vkCmdDrawIndexed(vulkan_recording.command_buffer, 6, 1, 0, 0, 0);
 }
 
 /*
@@ -891,7 +891,7 @@ void V_RenderView (void)
 		render_warp = false;
 		render_pass_index = 0;
 		render_scale = 1;
-		vkCmdBeginRenderPass(vulkan_globals.command_buffer, &vulkan_globals.main_render_pass_begin_infos[0], VK_SUBPASS_CONTENTS_INLINE);
+		vkCmdBeginRenderPass(vulkan_recording.command_buffer, &vulkan_globals.main_render_pass_begin_infos[0], VK_SUBPASS_CONTENTS_INLINE);
 		return;
 	}
 
@@ -73,11 +73,18 @@ void W_LoadWadFile (void) //johnfitz -- filename is now hard-coded for honesty
 	int			infotableofs;
 	const char		*filename = WADFILENAME;
 
-	//johnfitz -- modified to use malloc
-	//TODO: use cache_alloc
-	if (wad_base)
+	// the lumps are read straight from a read only mapping. big endian
+	// machines swap the pic headers in place, so they get a writable copy
+	if (wad_base && host_bigendian)
 		free (wad_base);
-	wad_base = COM_LoadMallocFile (filename, NULL);
+	else if (wad_base)
+		COM_ReleaseMappedFile (wad_base);
+	free (wad_lumps);
+	wad_lumps = NULL;
+	if (host_bigendian)
+		wad_base = COM_LoadMallocFile (filename, NULL);
+	else
+		wad_base = COM_LoadMappedFile (filename, NULL);
 	if (!wad_base)
 		Sys_Error ("W_LoadWadFile: couldn't load %s\n\n"
 			   "Basedir is: %s\n\n"
@@ -99,13 +106,18 @@ void W_LoadWadFile (void) //johnfitz -- filename is now hard-coded for honesty
 		wad_numlumps = LittleLong(header->numlumps);
 		infotableofs = LittleLong(header->infotableofs);
 	}
-	wad_lumps = (lumpinfo_t *)(wad_base + infotableofs);
 	if (infotableofs < 0 || infotableofs+wad_numlumps*sizeof(lumpinfo_t)>(size_t)com_filesize)
 	{
 		Con_Printf ("Wad file %s header extends beyond end of file\n",filename);
 		wad_numlumps = 0;
 	}
 
+	// the directory gets fixed up, so it lives in a copy
+	wad_lumps = (lumpinfo_t *) malloc (q_max (wad_numlumps, 1) * sizeof(lumpinfo_t));
+	if (!wad_lumps)
+		Sys_Error ("W_LoadWadFile: out of memory");
+	memcpy (wad_lumps, wad_base + infotableofs, wad_numlumps * sizeof(lumpinfo_t));
+
 	for (i=0, lump_p = wad_lumps ; i<wad_numlumps ; i++,lump_p++)
 	{
 		lump_p->filepos = LittleLong(lump_p->filepos);
@@ -127,7 +139,7 @@ void W_LoadWadFile (void) //johnfitz -- filename is now hard-coded for honesty
 			}
 		}
 		W_CleanupName (lump_p->name, lump_p->name);	// CAUTION: in-place editing!!! The endian fixups too.
-		if (lump_p->type == TYP_QPIC)
+		if (lump_p->type == TYP_QPIC && host_bigendian)
 			SwapPic ( (qpic_t *)(wad_base + lump_p->filepos));
 	}
 }
@@ -57,9 +57,14 @@ HULL BOXES
 */
 
 
-static	hull_t		box_hull;
-static	mclipnode_t	box_clipnodes[6]; //johnfitz -- was dclipnode_t
-static	mplane_t	box_planes[6];
+// per thread, so that sv_parallelphysics can trace from the job threads
+static THREAD_LOCAL	hull_t		box_hull;
+static THREAD_LOCAL	mclipnode_t	box_clipnodes[6]; //johnfitz -- was dclipnode_t
+static THREAD_LOCAL	mplane_t	box_planes[6];
+
+// a trace running on a job thread must not print: it raises sv_traceprinted
+// instead, and the caller redoes it on the main thread
+THREAD_LOCAL qboolean	sv_tracequiet, sv_traceprinted;
 
 /*
 ===================
@@ -108,6 +113,9 @@ BSP trees instead of being compared directly.
 */
 hull_t	*SV_HullForBox (vec3_t mins, vec3_t maxs)
 {
+	if (!box_hull.clipnodes)
+		SV_InitBoxHull ();	// first box trace on this thread
+
 	box_planes[0].dist = maxs[0];
 	box_planes[1].dist = mins[0];
 	box_planes[2].dist = maxs[1];
@@ -141,15 +149,23 @@ hull_t *SV_HullForEntity (edict_t *ent, vec3_t mins, vec3_t maxs, vec3_t offset)
 	if (ent->v.solid == SOLID_BSP)
 	{	// explicit hulls in the BSP model
 		if (ent->v.movetype != MOVETYPE_PUSH && !pr_checkextension.value)
-			Con_Warning ("SOLID_BSP without MOVETYPE_PUSH (%s at %f %f %f)\n",
-				    PR_GetString(ent->v.classname), ent->v.origin[0], ent->v.origin[1], ent->v.origin[2]);
+		{
+			if (sv_tracequiet)
+				sv_traceprinted = true;
+			else
+				Con_Warning ("SOLID_BSP without MOVETYPE_PUSH (%s at %f %f %f)\n",
+					    PR_GetString(ent->v.classname), ent->v.origin[0], ent->v.origin[1], ent->v.origin[2]);
+		}
 
 		model = qcvm->GetModel(ent->v.modelindex);
 
 		if (!model || model->type != mod_brush)
 		{
-			Con_Warning ("SOLID_BSP with a non bsp model (%s at %f %f %f)\n",
-				    PR_GetString(ent->v.classname), ent->v.origin[0], ent->v.origin[1], ent->v.origin[2]);
+			if (sv_tracequiet)
+				sv_traceprinted = true;
+			else
+				Con_Warning ("SOLID_BSP with a non bsp model (%s at %f %f %f)\n",
+					    PR_GetString(ent->v.classname), ent->v.origin[0], ent->v.origin[1], ent->v.origin[2]);
 			goto nohitmeshsupport;
 		}
 
@@ -258,6 +274,8 @@ void SV_UnlinkEdict (edict_t *ent)
 {
 	if (!ent->area.prev)
 		return;		// not linked in anywhere
+	if (sv_predictingmoves)
+		SV_MoveChanged (ent);
 	RemoveLink (&ent->area);
 	ent->area.prev = ent->area.next = NULL;
 }
@@ -482,6 +500,9 @@ void SV_LinkEdict (edict_t *ent, qboolean touch_triggers)
 		ent->v.absmax[2] += 1;
 	}
 
+	if (sv_predictingmoves)
+		SV_MoveChanged (ent);
+
 // link to PVS leafs
 	ent->num_leafs = 0;
 	if (ent->v.modelindex)
@@ -884,7 +905,10 @@ qboolean SV_SlowRecursiveHullCheck (hull_t *hull, int num, float p1f, float p2f,
 		{
 			trace->fraction = midf;
 			VectorCopy (mid, trace->endpos);
-			Con_DPrintf ("backup past 0\n");
+			if (sv_tracequiet)
+				sv_traceprinted = true;
+			else
+				Con_DPrintf ("backup past 0\n");
 			return false;
 		}
 		midf = p1f + (p2f - p1f)*frac;
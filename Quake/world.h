@@ -91,5 +91,12 @@ trace_t SV_Move (vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, int type, e
 
 qboolean SV_RecursiveHullCheck (hull_t *hull, vec3_t p1, vec3_t p2, trace_t *trace, unsigned int hitcontents);
 
+void SV_MoveBounds (vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, vec3_t boxmins, vec3_t boxmaxs);
+// the box SV_Move looks for entities in
+
+extern THREAD_LOCAL qboolean sv_tracequiet, sv_traceprinted;
+// set sv_tracequiet to trace off the main thread: messages are dropped and
+// sv_traceprinted is raised instead
+
 #endif	/* _QUAKE_WORLD_H */
 
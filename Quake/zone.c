@@ -23,9 +23,16 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "quakedef.h"
 
+#if defined(SDL_FRAMEWORK) || defined(NO_SDL_CONFIG)
+#include <SDL2/SDL.h>
+#else
+#include "SDL.h"
+#endif
+
 #define	DYNAMIC_SIZE	(4 * 1024 * 1024) // ericw -- was 512KB (64-bit) / 384KB (32-bit)
 
 #define	ZONEID	0x1d4a11
+#define	SLABID	0x51ab11
 #define MINFRAGMENT	64
 
 typedef struct memblock_s
@@ -47,6 +54,88 @@ typedef struct
 void Cache_FreeLow (int new_low_hunk);
 void Cache_FreeHigh (int new_high_hunk);
 
+/*
+==============================================================================
+
+						MEMORY ACCOUNTING
+
+==============================================================================
+*/
+
+typedef struct
+{
+	int		live, peak;		// bytes, headers included
+	int		count;			// live allocations
+	int		total;			// allocations made
+} memstats_t;
+
+static const char *memtag_names[NUM_MEMTAGS] =
+{
+	"misc",
+	"model",
+	"texture",
+	"sound",
+	"progs",
+	"particles",
+	"network",
+};
+
+#define MEMTAG_NONE	-1		// not accounted, for the zone's own hunk block
+
+static memstats_t	mem_stats[NUM_MEMTAGS];
+static int			mem_zonebytes, mem_cachebytes;
+static THREAD_LOCAL memtag_t	mem_tag;
+
+static char			mem_logpath[MAX_OSPATH];
+static FILE			*mem_logfile;
+
+// the zone and the accounting can be used from job threads, the hunk and
+// the cache are main thread only. SDL mutexes are recursive, so Z_Realloc
+// may call back into Z_Malloc and Z_Free while holding it.
+static SDL_mutex	*zone_lock;
+
+/*
+========================
+Memory_SetTag
+========================
+*/
+memtag_t Memory_SetTag (memtag_t tag)
+{
+	memtag_t	old = mem_tag;
+
+	mem_tag = tag;
+	return old;
+}
+
+/*
+========================
+Memory_Account
+
+adds (size > 0) or removes (size < 0) an allocation of the given tag
+========================
+*/
+static void Memory_Account (int tag, int size)
+{
+	memstats_t	*stats;
+
+	if (tag == MEMTAG_NONE)
+		return;
+
+	SDL_LockMutex (zone_lock);
+	stats = &mem_stats[tag];
+	stats->live += size;
+	if (size > 0)
+	{
+		stats->count++;
+		stats->total++;
+		if (stats->live > stats->peak)
+			stats->peak = stats->live;
+	}
+	else
+		stats->count--;
+	SDL_UnlockMutex (zone_lock);
+}
+
 
 /*
 ==============================================================================
@@ -60,11 +149,162 @@ The rover can be left pointing at a non-empty block
 
 The zone calls are pretty much only used for small strings and structures,
 all big things are allocated on the hunk.
+
+Small allocations don't go through the block list: they are served from
+slabs, zone blocks that are carved into equally sized objects, one list of
+slabs with free objects per size class. Allocating and freeing an object is
+O(1) and doesn't fragment the block list. Objects carry a memblock_t header
+with SLABID, whose prev points to the slab and next links the free objects.
 ==============================================================================
 */
 
 static memzone_t	*mainzone;
 
+#define	ZONE_SLABTAG	(NUM_MEMTAGS + 1)	// blocks holding slabs, their objects are accounted individually
+#define	SLAB_SIZE		8192
+#define	NUM_SIZECLASSES	8
+
+typedef struct zslab_s
+{
+	int				id;			// SLABID
+	int				sizeclass;
+	int				numused;	// objects allocated
+	int				numcarved;	// objects ever handed out, the rest was never touched
+	memblock_t		*freelist;
+	struct zslab_s	*next, *prev;	// in the size class' list of slabs with free objects
+} zslab_t;
+
+#define	SLAB_HEADER	((sizeof(zslab_t) + 15) & ~15)
+
+static const int	z_sizeclasses[NUM_SIZECLASSES] = {16, 32, 48, 64, 96, 128, 192, 256};
+static zslab_t		*z_partialslabs[NUM_SIZECLASSES];
+static qboolean		z_noslabs;		// first fit only, for zone_bench
+
+/*
+========================
+Z_MemTag
+
+the memory tag a zone tag is accounted to
+========================
+*/
+static int Z_MemTag (int tag)
+{
+	return (tag == ZONE_SLABTAG) ? MEMTAG_NONE : tag - 1;
+}
+
+/*
+========================
+Z_SizeClass
+
+returns the slab size class for a request, or -1 for the block list
+========================
+*/
+static int Z_SizeClass (int size)
+{
+	// indexed by (size + 15) / 16
+	static const signed char classes[17] = {0, 0, 1, 2, 3, 4, 4, 5, 5, 6, 6, 6, 6, 7, 7, 7, 7};
+
+	if (z_noslabs || size > z_sizeclasses[NUM_SIZECLASSES - 1])
+		return -1;
+	return classes[(size + 15) >> 4];
+}
+
+static void *Z_BlockMalloc (int size, int tag);
+static void Z_BlockFree (memblock_t *block);
+
+/*
+========================
+Z_SlabMalloc
+========================
+*/
+static void *Z_SlabMalloc (int sizeclass, int tag)
+{
+	int			stride = sizeof(memblock_t) + z_sizeclasses[sizeclass];
+	int			capacity = (SLAB_SIZE - SLAB_HEADER) / stride;
+	zslab_t		*slab = z_partialslabs[sizeclass];
+	memblock_t	*object;
+
+	if (!slab)
+	{
+		slab = (zslab_t *) Z_BlockMalloc (SLAB_SIZE, ZONE_SLABTAG);
+		if (!slab)
+			return NULL;
+		memset (slab, 0, sizeof(*slab));
+		slab->id = SLABID;
+		slab->sizeclass = sizeclass;
+		z_partialslabs[sizeclass] = slab;
+	}
+
+	if (slab->freelist)
+	{
+		object = slab->freelist;
+		slab->freelist = object->next;
+	}
+	else
+		object = (memblock_t *) ((byte *)slab + SLAB_HEADER + stride * slab->numcarved++);
+
+	if (++slab->numused == capacity)
+	{	// full, take it off the list
+		z_partialslabs[sizeclass] = slab->next;
+		if (slab->next)
+			slab->next->prev = NULL;
+		slab->next = slab->prev = NULL;
+	}
+
+	object->size = stride;
+	object->tag = tag;
+	object->id = SLABID;
+	object->pad = sizeclass;
+	object->next = NULL;
+	object->prev = (memblock_t *) slab;
+	Memory_Account (tag - 1, stride);
+
+	// zero all of it, so Z_Realloc can grow in place
+	memset (object + 1, 0, z_sizeclasses[sizeclass]);
+
+	return (void *) (object + 1);
+}
+
+/*
+========================
+Z_SlabFree
+========================
+*/
+static void Z_SlabFree (memblock_t *object)
+{
+	zslab_t	*slab = (zslab_t *) object->prev;
+	int		sizeclass = object->pad;
+	int		capacity = (SLAB_SIZE - SLAB_HEADER) / object->size;
+
+	if (sizeclass < 0 || sizeclass >= NUM_SIZECLASSES || slab->id != SLABID || slab->sizeclass != sizeclass)
+		Sys_Error ("Z_Free: freed a slab object with a bad header");
+
+	Memory_Account (object->tag - 1, -object->size);
+	object->tag = 0;
+	object->next = slab->freelist;
+	slab->freelist = object;
+
+	if (slab->numused-- == capacity)
+	{	// was full, it has room again
+		slab->prev = NULL;
+		slab->next = z_partialslabs[sizeclass];
+		if (slab->next)
+			slab->next->prev = slab;
+		z_partialslabs[sizeclass] = slab;
+	}
+	else if (!slab->numused && (slab->next || slab->prev))
+	{	// empty and not the last slab of its class, give it back to the zone
+		if (slab->prev)
+			slab->prev->next = slab->next;
+		else
+			z_partialslabs[sizeclass] = slab->next;
+		if (slab->next)
+			slab->next->prev = slab->prev;
+		slab->id = 0;
+		Z_BlockFree ((memblock_t *) ((byte *)slab - sizeof(memblock_t)));
+	}
+}
+
 
 /*
 ========================
@@ -73,18 +313,37 @@ Z_Free
 */
 void Z_Free (void *ptr)
 {
-	memblock_t	*block, *other;
+	memblock_t	*block;
 
 	if (!ptr)
 		return;	//ignore this like libc would
 //		Sys_Error ("Z_Free: NULL pointer");
 
 	block = (memblock_t *) ( (byte *)ptr - sizeof(memblock_t));
-	if (block->id != ZONEID)
+	if (block->id != ZONEID && block->id != SLABID)
 		Sys_Error ("Z_Free: freed a pointer without ZONEID");
 	if (block->tag == 0)
 		Sys_Error ("Z_Free: freed a freed pointer");
 
+	SDL_LockMutex (zone_lock);
+	if (block->id == SLABID)
+		Z_SlabFree (block);
+	else
+		Z_BlockFree (block);
+	SDL_UnlockMutex (zone_lock);
+}
+
+/*
+========================
+Z_BlockFree
+========================
+*/
+static void Z_BlockFree (memblock_t *block)
+{
+	memblock_t	*other;
+
+	Memory_Account (Z_MemTag (block->tag), -block->size);
+	mem_zonebytes -= block->size;
 	block->tag = 0;		// mark as free
 
 	other = block->prev;
@@ -112,12 +371,30 @@ void Z_Free (void *ptr)
 
 static void *Z_TagMalloc (int size, int tag)
 {
-	int		extra;
-	memblock_t	*start, *rover, *newblock, *base;
+	int		sizeclass;
 
 	if (!tag)
 		Sys_Error ("Z_TagMalloc: tried to use a 0 tag");
 
+	sizeclass = Z_SizeClass (size);
+	if (sizeclass >= 0)
+		return Z_SlabMalloc (sizeclass, tag);
+
+	return Z_BlockMalloc (size, tag);
+}
+
+/*
+========================
+Z_BlockMalloc
+
+first fit allocation from the block list
+========================
+*/
+static void *Z_BlockMalloc (int size, int tag)
+{
+	int		extra;
+	memblock_t	*start, *rover, *newblock, *base;
+
 //
 // scan through the block list looking for the first free block
 // of sufficient size
@@ -157,6 +434,8 @@ static void *Z_TagMalloc (int size, int tag)
 	}
 
 	base->tag = tag;				// no longer a free block
+	Memory_Account (Z_MemTag (tag), base->size);
+	mem_zonebytes += base->size;
 
 	mainzone->rover = base->next;	// next allocation will start looking here
 
@@ -187,6 +466,8 @@ static void Z_CheckHeap (void)
 			Sys_Error ("Z_CheckHeap: next block doesn't have proper back link\n");
 		if (!block->tag && !block->next->tag)
 			Sys_Error ("Z_CheckHeap: two consecutive free blocks\n");
+		if (block->tag == ZONE_SLABTAG && ((zslab_t *)(block + 1))->id != SLABID)
+			Sys_Error ("Z_CheckHeap: trashed slab header\n");
 	}
 }
 
@@ -200,8 +481,10 @@ void *Z_Malloc (int size)
 {
 	void	*buf;
 
+	SDL_LockMutex (zone_lock);
 	Z_CheckHeap ();	// DEBUG
-	buf = Z_TagMalloc (size, 1);
+	buf = Z_TagMalloc (size, mem_tag + 1);
+	SDL_UnlockMutex (zone_lock);
 	if (!buf)
 		Sys_Error ("Z_Malloc: failed on allocation of %i bytes",size);
 	Q_memset (buf, 0, size);
@@ -211,12 +494,12 @@ void *Z_Malloc (int size)
 
 /*
 ========================
-Z_Realloc
+Z_ReallocLocked
 ========================
 */
-void *Z_Realloc(void *ptr, int size)
+static void *Z_ReallocLocked (void *ptr, int size)
 {
-	int old_size;
+	int old_size, old_tag;
 	void *old_ptr;
 	memblock_t *block;
 
@@ -224,24 +507,48 @@ void *Z_Realloc(void *ptr, int size)
 		return Z_Malloc (size);
 
 	block = (memblock_t *) ((byte *) ptr - sizeof (memblock_t));
-	if (block->id != ZONEID)
+	if (block->id != ZONEID && block->id != SLABID)
 		Sys_Error ("Z_Realloc: realloced a pointer without ZONEID");
 	if (block->tag == 0)
 		Sys_Error ("Z_Realloc: realloced a freed pointer");
 
+	if (block->id == SLABID || Z_SizeClass (size) >= 0)
+	{	// a new slab may be carved out of a freed block, so copy before freeing
+		if (block->id == SLABID)
+			old_size = z_sizeclasses[block->pad];
+		else
+			old_size = block->size - (4 + (int)sizeof(memblock_t));	/* see Z_BlockMalloc() */
+		if (block->id == SLABID && Z_SizeClass (size) == block->pad)
+		{	// fits in place, keep the tail zeroed for growing again
+			if (size < old_size)
+				memset ((byte *)ptr + size, 0, old_size - size);
+			return ptr;
+		}
+		old_ptr = ptr;
+		ptr = Z_TagMalloc (size, block->tag);
+		if (!ptr)
+			Sys_Error ("Z_Realloc: failed on allocation of %i bytes", size);
+		memcpy (ptr, old_ptr, q_min(old_size, size));
+		if (old_size < size)
+			memset ((byte *)ptr + old_size, 0, size - old_size);
+		Z_Free (old_ptr);
+		return ptr;
+	}
+
 	old_size = block->size;
-	old_size -= (4 + (int)sizeof(memblock_t));	/* see Z_TagMalloc() */
+	old_size -= (4 + (int)sizeof(memblock_t));	/* see Z_BlockMalloc() */
+	old_tag = block->tag;
 	old_ptr = ptr;
 
 	Z_Free (ptr);
-	ptr = Z_TagMalloc (size, 1);
+	ptr = Z_TagMalloc (size, old_tag);
 	if (!ptr)
 		Sys_Error ("Z_Realloc: failed on allocation of %i bytes", size);
 
 	//Spike -- fix a bug where alignment resulted in no 0-initialisation
 	block = (memblock_t *) ((byte *) ptr - sizeof (memblock_t));
 	size = block->size;
-	size -= (4 + (int)sizeof(memblock_t));	/* see Z_TagMalloc() */
+	size -= (4 + (int)sizeof(memblock_t));	/* see Z_BlockMalloc() */
 	//Spike -- end fix
 
 	if (ptr != old_ptr)
@@ -252,6 +559,20 @@ void *Z_Realloc(void *ptr, int size)
 	return ptr;
 }
 
+/*
+========================
+Z_Realloc
+========================
+*/
+void *Z_Realloc (void *ptr, int size)
+{
+	SDL_LockMutex (zone_lock);
+	ptr = Z_ReallocLocked (ptr, size);
+	SDL_UnlockMutex (zone_lock);
+
+	return ptr;
+}
+
 char *Z_Strdup (const char *s)
 {
 	size_t sz = strlen(s) + 1;
@@ -270,6 +591,7 @@ void Z_Print (memzone_t *zone)
 {
 	memblock_t	*block;
 
+	SDL_LockMutex (zone_lock);
 	Con_Printf ("zone size: %i  location: %p\n",mainzone->size,mainzone);
 
 	for (block = zone->blocklist.next ; ; block = block->next)
@@ -286,6 +608,7 @@ void Z_Print (memzone_t *zone)
 		if (!block->tag && !block->next->tag)
 			Con_Printf ("ERROR: two consecutive free blocks\n");
 	}
+	SDL_UnlockMutex (zone_lock);
 }
 
 
@@ -293,11 +616,12 @@ void Z_Print (memzone_t *zone)
 
 #define	HUNK_SENTINAL	0x1df001ed
 
-#define HUNKNAME_LEN	24
+#define HUNKNAME_LEN	20
 typedef struct
 {
 	int		sentinal;
 	int		size;		// including sizeof(hunk_t), -1 = not allocated
+	int		tag;		// memtag_t or MEMTAG_NONE
 	char	name[HUNKNAME_LEN];
 } hunk_t;
 
@@ -429,13 +753,49 @@ void Hunk_Print_f (void)
 
 /*
 ===================
-Hunk_AllocName
+Hunk_Unaccount
+
+removes the blocks in [start, end) from the memory stats
 ===================
 */
-void *Hunk_AllocName (int size, const char *name)
+static void Hunk_Unaccount (byte *start, byte *end)
 {
 	hunk_t	*h;
 
+	for (h = (hunk_t *)start ; (byte *)h < end ; h = (hunk_t *)((byte *)h + h->size))
+	{
+		if (h->sentinal != HUNK_SENTINAL || h->size < (int) sizeof(hunk_t))
+			Sys_Error ("Hunk_Unaccount: trashed sentinal");
+		Memory_Account (h->tag, -h->size);
+	}
+}
+
+/*
+===================
+Hunk_CheckThread
+
+the hunk and the cache are not locked, job threads must use the zone or
+their scratch memory instead
+===================
+*/
+static inline void Hunk_CheckThread (const char *function)
+{
+#ifndef NDEBUG
+	if (Jobs_ThreadIndex () != 0)
+		Sys_Error ("%s: called from job thread %i", function, Jobs_ThreadIndex ());
+#endif
+}
+
+/*
+===================
+Hunk_AllocTag
+===================
+*/
+static void *Hunk_AllocTag (int size, const char *name, int tag)
+{
+	hunk_t	*h;
+
+	Hunk_CheckThread ("Hunk_Alloc");
 #ifdef PARANOID
 	Hunk_Check ();
 #endif
@@ -457,11 +817,23 @@ void *Hunk_AllocName (int size, const char *name)
 
 	h->size = size;
 	h->sentinal = HUNK_SENTINAL;
+	h->tag = tag;
 	q_strlcpy (h->name, name, HUNKNAME_LEN);
+	Memory_Account (tag, size);
 
 	return (void *)(h+1);
 }
 
+/*
+===================
+Hunk_AllocName
+===================
+*/
+void *Hunk_AllocName (int size, const char *name)
+{
+	return Hunk_AllocTag (size, name, mem_tag);
+}
+
 /*
 ===================
 Hunk_Alloc
@@ -479,8 +851,10 @@ int	Hunk_LowMark (void)
 
 void Hunk_FreeToLowMark (int mark)
 {
+	Hunk_CheckThread ("Hunk_FreeToLowMark");
 	if (mark < 0 || mark > hunk_low_used)
 		Sys_Error ("Hunk_FreeToLowMark: bad mark %i", mark);
+	Hunk_Unaccount (hunk_base + mark, hunk_base + hunk_low_used);
 	memset (hunk_base + mark, 0, hunk_low_used - mark);
 	hunk_low_used = mark;
 }
@@ -498,6 +872,7 @@ int	Hunk_HighMark (void)
 
 void Hunk_FreeToHighMark (int mark)
 {
+	Hunk_CheckThread ("Hunk_FreeToHighMark");
 	if (hunk_tempactive)
 	{
 		hunk_tempactive = false;
@@ -505,6 +880,7 @@ void Hunk_FreeToHighMark (int mark)
 	}
 	if (mark < 0 || mark > hunk_high_used)
 		Sys_Error ("Hunk_FreeToHighMark: bad mark %i", mark);
+	Hunk_Unaccount (hunk_base + hunk_size - hunk_high_used, hunk_base + hunk_size - mark);
 	memset (hunk_base + hunk_size - hunk_high_used, 0, hunk_high_used - mark);
 	hunk_high_used = mark;
 }
@@ -519,6 +895,7 @@ void *Hunk_HighAllocName (int size, const char *name)
 {
 	hunk_t	*h;
 
+	Hunk_CheckThread ("Hunk_HighAllocName");
 	if (size < 0)
 		Sys_Error ("Hunk_HighAllocName: bad size: %i", size);
 
@@ -548,7 +925,9 @@ void *Hunk_HighAllocName (int size, const char *name)
 	memset (h, 0, size);
 	h->size = size;
 	h->sentinal = HUNK_SENTINAL;
+	h->tag = mem_tag;
 	q_strlcpy (h->name, name, HUNKNAME_LEN);
+	Memory_Account (h->tag, size);
 
 	return (void *)(h+1);
 }
@@ -602,6 +981,7 @@ CACHE MEMORY
 typedef struct cache_system_s
 {
 	int			size;		// including this header
+	int			tag;		// memtag_t
 	cache_user_t		*user;
 	char			name[CACHENAME_LEN];
 	struct cache_system_s	*prev, *next;
@@ -629,6 +1009,9 @@ void Cache_Move ( cache_system_t *c)
 
 		Q_memcpy ( new_cs+1, c+1, c->size - sizeof(cache_system_t) );
 		new_cs->user = c->user;
+		new_cs->tag = c->tag;
+		Memory_Account (new_cs->tag, new_cs->size);
+		mem_cachebytes += new_cs->size;
 		Q_memcpy (new_cs->name, c->name, sizeof(new_cs->name));
 		Cache_Free (c->user, false); //johnfitz -- added second argument
 		new_cs->user->data = (void *)(new_cs+1);
@@ -859,11 +1242,15 @@ void Cache_Free (cache_user_t *c, qboolean freetextures) //johnfitz -- added sec
 {
 	cache_system_t	*cs;
 
+	Hunk_CheckThread ("Cache_Free");
 	if (!c->data)
 		Sys_Error ("Cache_Free: not allocated");
 
 	cs = ((cache_system_t *)c->data) - 1;
 
+	Memory_Account (cs->tag, -cs->size);
+	mem_cachebytes -= cs->size;
+
 	cs->prev->next = cs->next;
 	cs->next->prev = cs->prev;
 	cs->next = cs->prev = NULL;
@@ -912,6 +1299,7 @@ void *Cache_Alloc (cache_user_t *c, int size, const char *name)
 {
 	cache_system_t	*cs;
 
+	Hunk_CheckThread ("Cache_Alloc");
 	if (c->data)
 		Sys_Error ("Cache_Alloc: allready allocated");
 
@@ -929,6 +1317,9 @@ void *Cache_Alloc (cache_user_t *c, int size, const char *name)
 			q_strlcpy (cs->name, name, CACHENAME_LEN);
 			c->data = (void *)(cs+1);
 			cs->user = c;
+			cs->tag = mem_tag;
+			Memory_Account (cs->tag, cs->size);
+			mem_cachebytes += cs->size;
 			break;
 		}
 
@@ -942,8 +1333,382 @@ void *Cache_Alloc (cache_user_t *c, int size, const char *name)
 	return Cache_Check (c);
 }
 
+/*
+==============================================================================
+
+						SCRATCH MEMORY
+
+Every thread owns a bump allocator for temporary memory that never outlives
+the job or frame that made it. It grows by whole chunks which are kept for
+reuse, so a mark is simply the byte offset into all the chunks laid end to
+end: an allocation that doesn't fit the current chunk skips its remainder.
+==============================================================================
+*/
+
+#define	SCRATCH_CHUNK	(256 * 1024)
+
+typedef struct scratchchunk_s
+{
+	struct scratchchunk_s	*next;
+	byte	*data;			// 16 byte aligned, follows the header
+	int		size;			// usable bytes at data
+} scratchchunk_t;
+
+typedef struct
+{
+	scratchchunk_t	*chunks;
+	scratchchunk_t	*current;
+	int				base;		// mark of the current chunk's first byte
+	int				used;		// bytes used in the current chunk
+} scratch_t;
+
+static THREAD_LOCAL scratch_t	scratch;
+
+/*
+===================
+Scratch_Alloc
+===================
+*/
+void *Scratch_Alloc (int size)
+{
+	scratchchunk_t	*chunk;
+	void			*buf;
+
+	if (size < 0)
+		Sys_Error ("Scratch_Alloc: bad size: %i", size);
+	size = (size+15)&~15;
+
+	while (!scratch.current || scratch.used + size > scratch.current->size)
+	{
+		if (scratch.current && scratch.current->next)
+		{
+			scratch.base += scratch.current->size;
+			scratch.current = scratch.current->next;
+			scratch.used = 0;
+			continue;
+		}
+
+		chunk = (scratchchunk_t *) malloc (sizeof(scratchchunk_t) + 15 + q_max(size, SCRATCH_CHUNK));
+		if (!chunk)
+			Sys_Error ("Scratch_Alloc: failed on %i bytes", size);
+		chunk->next = NULL;
+		chunk->data = (byte *)(((uintptr_t)(chunk + 1) + 15) & ~(uintptr_t)15);
+		chunk->size = q_max(size, SCRATCH_CHUNK);
+		if (scratch.current)
+		{
+			scratch.base += scratch.current->size;
+			scratch.current->next = chunk;
+		}
+		else
+			scratch.chunks = chunk;
+		scratch.current = chunk;
+		scratch.used = 0;
+	}
+
+	buf = scratch.current->data + scratch.used;
+	scratch.used += size;
+
+	return buf;
+}
+
+/*
+===================
+Scratch_Mark
+===================
+*/
+int Scratch_Mark (void)
+{
+	return scratch.base + scratch.used;
+}
+
+/*
+===================
+Scratch_FreeToMark
+===================
+*/
+void Scratch_FreeToMark (int mark)
+{
+	scratchchunk_t	*chunk;
+	int				base = 0;
+
+	if (mark < 0 || mark > Scratch_Mark ())
+		Sys_Error ("Scratch_FreeToMark: bad mark %i", mark);
+
+	for (chunk = scratch.chunks; chunk; base += chunk->size, chunk = chunk->next)
+	{
+		if (mark <= base + chunk->size)
+		{
+			scratch.current = chunk;
+			scratch.base = base;
+			scratch.used = mark - base;
+			return;
+		}
+	}
+}
+
+/*
+==============================================================================
+
+						FRAME MEMORY
+
+Two hunk blocks used in turn, one per frame. Allocating is a single atomic
+add, so any thread may use it, and Memory_EndFrame switches to the other
+block and resets it. Data therefore stays valid until the end of the next
+frame, long enough for a command buffer that is still being submitted.
+
+A frame that needs more than -framemem, for instance timerefresh rendering
+many views in one host frame, gets the rest from malloc'd overflow blocks
+that are freed together with their block.
+==============================================================================
+*/
+
+#define	FRAME_MEMORY_SIZE	(2 * 1024 * 1024)
+
+typedef struct
+{
+	byte			*base;
+	SDL_atomic_t	used;
+	void			*overflow;	// malloc'd blocks, each starts with the next pointer
+} framearena_t;
+
+static framearena_t	frame_arenas[2];
+static int			frame_arena_index;
+static int			frame_size;
+static int			frame_peak;
+
+/*
+===================
+Frame_AllocOverflow
+===================
+*/
+static void *Frame_AllocOverflow (framearena_t *arena, int size)
+{
+	void	**block, *next;
+
+	block = (void **) malloc (sizeof(void *) + 15 + size);
+	if (!block)
+		Sys_Error ("Frame_Alloc: failed on %i bytes", size);
+
+	do
+	{
+		next = arena->overflow;
+		block[0] = next;
+	} while (!SDL_AtomicCASPtr (&arena->overflow, next, block));
+
+	return (byte *)(((uintptr_t)(block + 1) + 15) & ~(uintptr_t)15);
+}
+
+/*
+===================
+Frame_Alloc
+===================
+*/
+void *Frame_Alloc (int size)
+{
+	framearena_t	*arena = &frame_arenas[frame_arena_index];
+	int				offset;
+
+	if (size < 0)
+		Sys_Error ("Frame_Alloc: bad size: %i", size);
+	size = (size+15)&~15;
+
+	offset = SDL_AtomicAdd (&arena->used, size);
+	if (offset + size > frame_size)
+		return Frame_AllocOverflow (arena, size);
+
+	return arena->base + offset;
+}
+
+/*
+===================
+Frame_Used
+===================
+*/
+int Frame_Used (void)
+{
+	return SDL_AtomicGet (&frame_arenas[frame_arena_index].used);	// overflow included
+}
+
+/*
+===================
+Frame_Peak
+===================
+*/
+int Frame_Peak (void)
+{
+	return q_max (frame_peak, Frame_Used ());
+}
+
+/*
+===================
+Frame_Swap
+===================
+*/
+static void Frame_Swap (void)
+{
+	framearena_t	*arena;
+	void			**block;
+	int				used;
+
+	used = Frame_Used ();
+	if (used > frame_size)
+		Con_DPrintf ("Frame_Alloc: frame needed %i KB, raise -framemem\n", (used + 1023) / 1024);
+	frame_peak = q_max (frame_peak, used);
+
+	frame_arena_index ^= 1;
+	arena = &frame_arenas[frame_arena_index];
+	while ((block = (void **) arena->overflow) != NULL)
+	{
+		arena->overflow = block[0];
+		free (block);
+	}
+	SDL_AtomicSet (&arena->used, 0);
+}
+
 //============================================================================
 
+/*
+========================
+Memory_Stats_f
+========================
+*/
+static void Memory_Stats_f (void)
+{
+	memstats_t	*stats;
+	int			i;
+
+	Con_Printf ("tag             live       peak   count   allocs\n");
+	for (i = 0; i < NUM_MEMTAGS; i++)
+	{
+		stats = &mem_stats[i];
+		Con_Printf ("%-9s %10i %10i %7i %8i\n", memtag_names[i], stats->live, stats->peak, stats->count, stats->total);
+	}
+	Con_Printf ("hunk:  %i low + %i high of %i, %i free\n", hunk_low_used, hunk_high_used, hunk_size,
+		hunk_size - hunk_low_used - hunk_high_used);
+	Con_Printf ("zone:  %i of %i\n", mem_zonebytes, mainzone->size);
+	Con_Printf ("cache: %i\n", mem_cachebytes);
+	Con_Printf ("frame: %i of %i, %i peak\n", Frame_Used (), frame_size, frame_peak);
+}
+
+/*
+========================
+Z_BenchRun
+
+churns a working set of small zone allocations, with every 16th one kept
+alive until the end like strzone'd strings, returns the time taken
+========================
+*/
+#define ZBENCH_SLOTS	4096
+
+static double Z_BenchRun (void **slots, int iterations)
+{
+	unsigned int	seed = 0x5eed;
+	double			start = Sys_DoubleTime ();
+	int				i, slot, size, kept = ZBENCH_SLOTS;
+
+	for (i = 0; i < iterations; i++)
+	{
+		seed = seed * 1103515245 + 12345;
+		slot = (seed >> 8) % ZBENCH_SLOTS;
+		size = 4 + (seed >> 20) % 200;	// strzone'd strings, console text
+		if (slots[slot])
+		{
+			if (!(i & 15) && kept < 2 * ZBENCH_SLOTS)
+				slots[kept++] = slots[slot];
+			else
+				Z_Free (slots[slot]);
+			slots[slot] = NULL;
+		}
+		else
+		{
+			Z_CheckHeap ();	// as Z_Malloc does
+			slots[slot] = Z_TagMalloc (size, MEMTAG_MISC + 1);
+		}
+	}
+
+	for (i = 0; i < kept; i++)
+	{
+		Z_Free (slots[i]);
+		slots[i] = NULL;
+	}
+
+	return Sys_DoubleTime () - start;
+}
+
+/*
+========================
+Z_Bench_f
+
+zone_bench [iterations]: compares the slab allocator against first fit only
+========================
+*/
+static void Z_Bench_f (void)
+{
+	void	**slots;
+	int		iterations = (Cmd_Argc () > 1) ? Q_atoi (Cmd_Argv (1)) : 200000;
+	double	firstfit, slabs;
+
+	slots = (void **) calloc (2 * ZBENCH_SLOTS, sizeof(void *));
+	if (!slots)
+		return;
+
+	SDL_LockMutex (zone_lock);
+	z_noslabs = true;
+	firstfit = Z_BenchRun (slots, iterations);
+	z_noslabs = false;
+	slabs = Z_BenchRun (slots, iterations);
+	SDL_UnlockMutex (zone_lock);
+
+	Con_Printf ("%i allocs/frees: first fit %.1f ms, slabs %.1f ms\n", iterations, firstfit * 1000.0, slabs * 1000.0);
+	free (slots);
+}
+
+/*
+========================
+Memory_EndFrame
+
+releases the main thread's scratch memory, starts the next frame's memory
+and appends this frame's totals to the -memlog file
+========================
+*/
+void Memory_EndFrame (void)
+{
+	char	path[MAX_OSPATH];
+	int		i;
+
+	Scratch_FreeToMark (0);
+	Frame_Swap ();
+
+	if (!mem_logpath[0])
+		return;
+
+	if (!mem_logfile)
+	{
+		if (com_gamedir[0] && !strchr (mem_logpath, '/') && !strchr (mem_logpath, '\\'))
+			q_snprintf (path, sizeof(path), "%s/%s", com_gamedir, mem_logpath);
+		else
+			q_strlcpy (path, mem_logpath, sizeof(path));
+		mem_logfile = fopen (path, "w");
+		if (!mem_logfile)
+		{
+			Con_Printf ("couldn't open memory log %s\n", path);
+			mem_logpath[0] = 0;
+			return;
+		}
+		Con_Printf ("logging memory use to %s\n", path);
+		fprintf (mem_logfile, "frame,time,hunk_low,hunk_high,hunk_free,zone,cache");
+		for (i = 0; i < NUM_MEMTAGS; i++)
+			fprintf (mem_logfile, ",%s", memtag_names[i]);
+		fprintf (mem_logfile, "\n");
+	}
+
+	fprintf (mem_logfile, "%i,%.3f,%i,%i,%i,%i,%i", host_framecount, realtime, hunk_low_used, hunk_high_used,
+		hunk_size - hunk_low_used - hunk_high_used, mem_zonebytes, mem_cachebytes);
+	for (i = 0; i < NUM_MEMTAGS; i++)
+		fprintf (mem_logfile, ",%i", mem_stats[i].live);
+	fprintf (mem_logfile, "\n");
+	fflush (mem_logfile);
+}
 
 static void Memory_InitZone (memzone_t *zone, int size)
 {
@@ -974,6 +1739,10 @@ void Memory_Init (void *buf, int size)
 	int p;
 	int zonesize = DYNAMIC_SIZE;
 
+	zone_lock = SDL_CreateMutex ();
+	if (!zone_lock)
+		Sys_Error ("Memory_Init: couldn't create the zone mutex");
+
 	hunk_base = (byte *) buf;
 	hunk_size = size;
 	hunk_low_used = 0;
@@ -988,9 +1757,32 @@ void Memory_Init (void *buf, int size)
 		else
 			Sys_Error ("Memory_Init: you must specify a size in KB after -zone");
 	}
-	mainzone = (memzone_t *) Hunk_AllocName (zonesize, "zone" );
+	mainzone = (memzone_t *) Hunk_AllocTag (zonesize, "zone", MEMTAG_NONE);
 	Memory_InitZone (mainzone, zonesize);
 
+	frame_size = FRAME_MEMORY_SIZE;
+	p = COM_CheckParm ("-framemem");
+	if (p)
+	{
+		if (p < com_argc-1)
+			frame_size = ((Q_atoi (com_argv[p+1]) * 1024) + 15) & ~15;
+		else
+			Sys_Error ("Memory_Init: you must specify a size in KB after -framemem");
+	}
+	frame_arenas[0].base = (byte *) Hunk_AllocTag (frame_size, "framemem", MEMTAG_NONE);
+	frame_arenas[1].base = (byte *) Hunk_AllocTag (frame_size, "framemem", MEMTAG_NONE);
+
+	p = COM_CheckParm ("-memlog");
+	if (p)
+	{
+		if (p < com_argc-1 && com_argv[p+1][0] != '-' && com_argv[p+1][0] != '+')
+			q_strlcpy (mem_logpath, com_argv[p+1], sizeof(mem_logpath));
+		else
+			q_strlcpy (mem_logpath, "memlog.csv", sizeof(mem_logpath));
+	}
+
 	Cmd_AddCommand ("hunk_print", Hunk_Print_f); //johnfitz
+	Cmd_AddCommand ("mem_stats", Memory_Stats_f);
+	Cmd_AddCommand ("zone_bench", Z_Bench_f);
 }
 
@@ -89,13 +89,51 @@ Zone block
 
 */
 
+/*
+Every zone, hunk and cache allocation is charged to the memory tag current on
+the allocating thread. Subsystems set their tag around the code that loads
+their data, see Memory_SetTag. mem_stats prints the totals per tag, and
+-memlog [file] streams them to a CSV file once per frame.
+
+The zone may be used from any thread. The hunk and the cache belong to the
+main thread, debug builds stop with an error when a job thread touches them.
+Short lived buffers on any thread should come from Scratch_Alloc: each
+thread's scratch memory is released after every job it runs, and after
+every frame on the main thread. Frame_Alloc serves data that has to outlive
+the function making it but not the frame, for instance until the command
+buffer recorded with it is submitted: it stays valid until the end of the
+next frame.
+*/
+
+typedef enum
+{
+	MEMTAG_MISC,
+	MEMTAG_MODEL,
+	MEMTAG_TEXTURE,
+	MEMTAG_SOUND,
+	MEMTAG_PROGS,
+	MEMTAG_PARTICLES,
+	MEMTAG_NETWORK,
+	NUM_MEMTAGS
+} memtag_t;
+
 void Memory_Init (void *buf, int size);
+memtag_t Memory_SetTag (memtag_t tag);	// returns the previous tag
+void Memory_EndFrame (void);		// writes the -memlog line
 
 void Z_Free (void *ptr);
 void *Z_Malloc (int size);			// returns 0 filled memory
 void *Z_Realloc (void *ptr, int size);
 char *Z_Strdup (const char *s);
 
+void *Scratch_Alloc (int size);		// 16 byte aligned, not filled
+int Scratch_Mark (void);
+void Scratch_FreeToMark (int mark);
+
+void *Frame_Alloc (int size);		// 16 byte aligned, not filled
+int Frame_Used (void);			// bytes, this frame so far
+int Frame_Peak (void);
+
 void *Hunk_Alloc (int size);		// returns 0 filled memory
 void *Hunk_AllocName (int size, const char *name);
 void *Hunk_HighAllocName (int size, const char *name);